@@ -0,0 +1,286 @@
+/*
+ * Bench.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ObjectStream.hpp>
+#include <Model.hpp>
+#include <Ray.hpp>
+#include <Surface.hpp>
+#include <render.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+namespace sc = std::chrono;
+
+/* boost includes */
+#include <boost/program_options.hpp>
+namespace po = boost::program_options;
+
+const char* usage = "Usage: Bench [options]";
+
+/** keeps the compiler from throwing away the work being measured */
+volatile uint64_t sink = 0;
+
+/**
+ * The timings of a single benchmark. Every repeat runs the operation a fixed
+ * number of times and records the average time of one operation, so the
+ * statistics are over the repeats.
+ */
+struct Result {
+  std::string         name;
+  uint64_t            iterations;
+  std::vector<double> samples;
+
+  double median() const {
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+
+    size_t mid = sorted.size() / 2;
+    return sorted.size() % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2.0;
+  }
+
+  double mean() const {
+    double sum = 0.0;
+    for(double s : samples)
+      sum += s;
+    return sum / samples.size();
+  }
+
+  double variance() const {
+    double avg = mean();
+    double sum = 0.0;
+    for(double s : samples)
+      sum += (s - avg) * (s - avg);
+    return samples.size() > 1 ? sum / (samples.size() - 1) : 0.0;
+  }
+};
+
+/**
+ * Runs a benchmark. The operation is run once before timing starts so that
+ * caches and lazily built state are warm.
+ *
+ * @param name        the name of the benchmark
+ * @param iterations  the number of operations in one call to op
+ * @param repeats     the number of times op is timed
+ * @param op          the operation to time
+ * @param setup       run before every call to op without being timed, for
+ *                    operations that change their input
+ * @return            the timings, in nanoseconds for one operation
+ */
+Result run(const std::string& name, uint64_t iterations, int repeats,
+    const std::function<void()>& op, const std::function<void()>& setup = nullptr)
+{
+  Result ret = { name, iterations, std::vector<double>() };
+
+  if(setup)
+    setup();
+  op();
+
+  for(int i = 0; i < repeats; i++) {
+    if(setup)
+      setup();
+
+    auto begin = sc::steady_clock::now();
+    op();
+    auto end   = sc::steady_clock::now();
+
+    ret.samples.push_back(
+        double(sc::duration_cast<sc::nanoseconds>(end - begin).count()) / iterations);
+  }
+
+  std::cerr << std::left << std::setw(28) << name
+            << std::right << std::setw(16) << std::fixed << std::setprecision(1)
+            << ret.median() << " ns" << std::endl;
+
+  return ret;
+}
+
+/**
+ * Writes the results as a JSON document.
+ */
+void writeJson(std::ostream& ostr, const std::string& model, const std::vector<Result>& results) {
+  ostr << std::setprecision(6) << std::scientific;
+  ostr << "{" << std::endl;
+  ostr << "  \"model\": \"" << model << "\"," << std::endl;
+  ostr << "  \"unit\": \"ns\"," << std::endl;
+  ostr << "  \"benchmarks\": [" << std::endl;
+
+  for(size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    auto minmax = std::minmax_element(r.samples.begin(), r.samples.end());
+
+    ostr << "    {"
+         << "\"name\": \""     << r.name           << "\", "
+         << "\"iterations\": " << r.iterations     << ", "
+         << "\"repeats\": "    << r.samples.size() << ", "
+         << "\"median\": "     << r.median()       << ", "
+         << "\"mean\": "       << r.mean()         << ", "
+         << "\"variance\": "   << r.variance()     << ", "
+         << "\"min\": "        << *minmax.first    << ", "
+         << "\"max\": "        << *minmax.second   << "}"
+         << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+
+  ostr << "  ]" << std::endl;
+  ostr << "}" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("model", po::value<std::string>()->default_value("models/teapot/teapot.obj"),
+          "the model used by every benchmark")
+      ("output", po::value<std::string>(), "write the JSON results here instead of stdout")
+      ("repeats", po::value<int>()->default_value(15), "the number of timed runs of each benchmark")
+      ("sizes", po::value<std::vector<int> >()->multitoken(),
+          "the image sizes for the click benchmarks (default 128 256 512)")
+      ("filter", po::value<std::string>()->default_value(""),
+          "only run the benchmarks whose name contains this");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, visible), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  if(vm.count("help")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string      path    = vm["model"].as<std::string>();
+  std::string      filter  = vm["filter"].as<std::string>();
+  int              repeats = std::max(vm["repeats"].as<int>(), 1);
+  std::vector<int> sizes   = { 128, 256, 512 };
+
+  if(vm.count("sizes"))
+    sizes = vm["sizes"].as<std::vector<int> >();
+
+  auto selected = [&](const std::string& name) {
+    return name.find(filter) != std::string::npos;
+  };
+
+  /* the scene every benchmark works on */
+  auto stream = ray::ObjectStream::loadObject(path);
+
+  ray::Model  model;
+  ray::Camera camera;
+  ray::Model::fromObjectStream(stream, model, camera);
+
+  ray::Box                      bounds = model.getBounds();
+  ray::Matrix<ray::Ray>         rays   = camera.getRays(64, 64);
+  std::vector<ray::Triangle*>   tris;
+  std::vector<ray::render::d_Ray> d_rays;
+
+  for(const ray::Mesh& mesh : model.getMeshes())
+    tris.insert(tris.end(), mesh.triangles.begin(), mesh.triangles.end());
+  tris.resize(std::min(tris.size(), size_t(256)));
+
+  for(int i = 0; i < 256; i++)
+    d_rays.push_back(ray::render::d_Ray(rays[i / 16 * 4][i % 16 * 4]));
+
+  std::vector<Result> results;
+
+  if(selected("box_intersect")) {
+    results.push_back(run("box_intersect", rays.rows() * rays.cols(), repeats, [&]() {
+      uint64_t count = 0;
+      for(uint32_t i = 0; i < rays.rows(); i++)
+        for(uint32_t j = 0; j < rays.cols(); j++)
+          count += bounds.intersect(rays[i][j]);
+      sink += count;
+    }));
+  }
+
+  if(selected("triangle_intersect")) {
+    results.push_back(run("triangle_intersect", uint64_t(tris.size()) * 64, repeats, [&]() {
+      uint64_t count = 0;
+      ray::Intersection inter;
+      for(const ray::Triangle* tri : tris)
+        for(uint32_t j = 0; j < 64; j++)
+          count += tri->getIntersection(rays[32][j], inter);
+      sink += count;
+    }));
+  }
+
+  if(selected("render_trace")) {
+    std::vector<ray::Vector> out(d_rays.size());
+
+    results.push_back(run("render_trace", d_rays.size(), repeats, [&]() {
+      ray::render::Trace(out.data(), d_rays.data(), d_rays.size());
+      sink += uint64_t(out[0].x());
+    }));
+
+    if(ray::RayStats::enabled)
+      std::cerr << ray::render::traceStats() << std::endl;
+  }
+
+  if(selected("tree_build")) {
+    /* a model of its own since building a tree takes over its Triangles */
+    ray::Model scratch;
+    ray::Camera unused;
+    ray::Model::fromObjectStream(stream, scratch, unused);
+
+    std::vector<ray::Triangle*> all;
+    for(const ray::Mesh& mesh : scratch.getMeshes())
+      all.insert(all.end(), mesh.triangles.begin(), mesh.triangles.end());
+
+    /* building a tree sorts the Triangles in place, so every run starts
+     * from a fresh copy of the original order */
+    std::vector<ray::Triangle*> work;
+
+    results.push_back(run("tree_build", all.size(), repeats, [&]() {
+      ray::SurfaceArena arena;
+      arena.reserve(work.size());
+      sink += arena.makeTree(work.begin(), work.end())->id;
+    }, [&]() {
+      work = all;
+    }));
+  }
+
+  if(selected("obj_parse")) {
+    results.push_back(run("obj_parse", 1, repeats, [&]() {
+      sink += ray::ObjectStream::loadObject(path)->polygons().size();
+    }));
+  }
+
+  if(selected("camera_rays")) {
+    results.push_back(run("camera_rays", 512 * 512, repeats, [&]() {
+      sink += camera.getRays(512, 512).rows();
+    }));
+  }
+
+  for(int size : sizes) {
+    std::ostringstream name;
+    name << "click_" << size;
+
+    if(selected(name.str())) {
+      results.push_back(run(name.str(), uint64_t(size) * size, repeats, [&]() {
+        sink += model.click(camera, size, size)[size / 2][size / 2].r();
+      }));
+    }
+  }
+
+  if(vm.count("output")) {
+    std::ofstream ostr(vm["output"].as<std::string>());
+    writeJson(ostr, path, results);
+  } else {
+    writeJson(std::cout, path, results);
+  }
+
+  return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * PagedTracer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ImageFile.hpp>
+#include <MeshFile.hpp>
+#include <Model.hpp>
+#include <ObjectStream.hpp>
+#include <PagedTree.hpp>
+#include <RegionTracer.hpp>
+#include <Timeline.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+namespace sc = std::chrono;
+
+/* boost includes */
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+namespace po = boost::program_options;
+
+using ray::timeline::ms;
+
+const char* usage =
+    "Usage: PagedTracer build [options] <model file> <paged file>\n"
+    "       PagedTracer render [options] <paged file> <output file>";
+
+/**
+ * Writes a scene into a paged file.
+ *
+ * @param input     the scene
+ * @param output    the paged file to write
+ * @param pageSize  the most Triangles in a page
+ * @return          the exit code
+ */
+static int build(const std::string& input, const std::string& output, uint32_t pageSize) {
+  auto begin = sc::steady_clock::now();
+  std::unique_ptr<ray::mesh::Source> source;
+  try {
+    source = ray::mesh::Source::open(input);
+  } catch(std::exception& e) { }
+
+  if(!source) {
+    std::cout << "Could not load " << input << std::endl;
+    return -1;
+  }
+
+  try {
+    ray::PagedTree::write(output, *source, pageSize);
+  } catch(std::exception& e) {
+    std::cout << "Could not write " << output << std::endl;
+    return -1;
+  }
+
+  ray::PagedTree tree(output, 0, 0);
+  std::cout << std::fixed << std::setprecision(2)
+            << "Wrote " << tree.triangles() << " triangles in " << tree.pages()
+            << " pages in " << ms(begin, sc::steady_clock::now()) << " ms" << std::endl;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("page-size", po::value<uint32_t>()->default_value(4096),
+          "build: the most triangles in a page")
+      ("budget", po::value<double>()->default_value(1024),
+          "render: the megabytes of pages kept in memory")
+      ("size", po::value<int>()->default_value(1024),
+          "render: the number of rows and columns in the picture")
+      ("orbit", po::value<std::vector<double> >()->multitoken(),
+          "render: turn the camera around the scene by <x> <y> radians")
+      ("band", po::value<int>()->default_value(64),
+          "render: the number of rows whose Rays are followed at once")
+      ("threads", po::value<int>()->default_value(boost::thread::hardware_concurrency()),
+          "render: the number of threads that trace and read pages");
+
+  po::options_description hidden;
+  hidden.add_options()
+      ("mode",   po::value<std::string>())
+      ("first",  po::value<std::string>())
+      ("second", po::value<std::string>());
+
+  po::options_description all;
+  all.add(visible).add(hidden);
+
+  po::positional_options_description positional;
+  positional.add("mode", 1).add("first", 1).add("second", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).
+        options(all).positional(positional).run(), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string mode = vm.count("mode") ? vm["mode"].as<std::string>() : "";
+
+  if(vm.count("help") || (mode != "build" && mode != "render") ||
+      !vm.count("first") || !vm.count("second")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string first  = vm["first"].as<std::string>();
+  std::string second = vm["second"].as<std::string>();
+
+  /* write a paged file */
+  if(mode == "build")
+    return build(first, second, vm["page-size"].as<uint32_t>());
+
+  /* render a picture */
+  int size = std::max(vm["size"].as<int>(), 1);
+  double orbit[2] = { 0.0, 0.0 };
+
+  if(vm.count("orbit")) {
+    std::vector<double> angles = vm["orbit"].as<std::vector<double> >();
+    if(angles.size() != 2) {
+      std::cout << "--orbit takes two angles" << std::endl;
+      return -1;
+    }
+    orbit[0] = angles[0];
+    orbit[1] = angles[1];
+  }
+
+  auto begin = sc::steady_clock::now();
+  std::unique_ptr<ray::PagedTree> tree;
+
+  try {
+    tree.reset(new ray::PagedTree(first,
+        size_t(std::max(vm["budget"].as<double>(), 0.0) * 1024 * 1024),
+        uint8_t(std::max(vm["threads"].as<int>() - 1, 0))));
+  } catch(std::exception& e) {
+    std::cout << "Could not read " << first << std::endl;
+    return -1;
+  }
+
+  auto loaded = sc::steady_clock::now();
+
+  /* the camera and Lights are made the same way Tracer makes them */
+  ray::Camera camera = ray::Camera::fromBounds(tree->bounds());
+  ray::Vector center = tree->bounds().min() + tree->bounds().len() / 2.0;
+
+  std::vector<ray::Light> lights = tree->lights();
+  lights.push_back(ray::Light(camera._fp(), ray::Vector(255)));
+  lights.push_back(ray::Light(camera._fp(), ray::Vector(255)));
+
+  camera.rotate(orbit[0], ray::Camera::x_axis, center);
+  camera.rotate(orbit[1], ray::Camera::y_axis, center);
+
+  std::vector<ray::Region*> regions(1, tree.get());
+  ray::RegionTracer tracer(regions, lights);
+
+  try {
+    tracer.render(camera, size, size, std::max(vm["band"].as<int>(), 1));
+  } catch(std::exception& e) {
+    std::cout << "Could not read a page of " << first << std::endl;
+    return -1;
+  }
+
+  auto end = sc::steady_clock::now();
+
+  if(!ray::writePPM(second, tracer.picture())) {
+    std::cout << "Could not write " << second << std::endl;
+    return -1;
+  }
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Opened in " << ms(begin, loaded) << " ms, rendered in " << ms(loaded, end)
+            << " ms with " << tracer.waves() << " batches in " << tree->rounds() << " rounds" << std::endl
+            << tree->triangles() << " triangles in " << tree->pages() << " pages, "
+            << tree->reads() << " page reads, " << tree->evicts() << " evictions, "
+            << tree->peak() / (1024.0 * 1024.0) << " MB of pages at most" << std::endl;
+
+  return 0;
+}
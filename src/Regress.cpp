@@ -0,0 +1,376 @@
+/*
+ * Regress.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ImageFile.hpp>
+#include <ObjectStream.hpp>
+#include <Model.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+namespace sc = std::chrono;
+
+/* boost includes */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+namespace pt = boost::property_tree;
+
+const char* usage = "Usage: Regress [options] [scene list]";
+
+/**
+ * A single entry of the scene list. Each line of the list is the name of the
+ * entry, the file to render relative to the list and the size of the picture,
+ * followed by any of:
+ *
+ *   orbit <x> <y>               rotates the camera around the center of the
+ *                               model, in radians, like dragging in ObjView
+ *   move <x|y|z> <distance>     moves the camera
+ *   raster | batch              turns on the rasterizer or batched rays
+ *   samples <n>                 the most samples for a pixel on an edge
+ *   order <morton|hilbert>      the order that the picture is rendered in
+ */
+struct Entry {
+  std::string                          name;
+  fs::path                             file;
+  int                                  size;
+  std::vector<std::pair<int, double> > moves;
+  double                               orbit[2];
+  ray::RenderOptions                   opts;
+};
+
+/** what was measured for an entry */
+struct Measured {
+  double                  ms;
+  std::map<std::string, uint64_t> counters;
+  ray::Matrix<ray::Pixel> image;
+};
+
+/**
+ * Reads the scene list.
+ *
+ * @param fileName  the name of the list
+ * @param entries   return for the entries
+ * @return          false if a line could not be read
+ */
+bool readEntries(const fs::path& fileName, std::vector<Entry>& entries) {
+  std::ifstream istr(fileName.string().c_str());
+  std::string buffer;
+  int lineno = 0;
+
+  if(!istr)
+    return false;
+
+  while(std::getline(istr, buffer)) {
+    std::istringstream line(buffer);
+    std::string file, op;
+    Entry entry;
+
+    lineno++;
+
+    if(!(line >> entry.name) || entry.name[0] == '#')
+      continue;
+
+    bool good = bool(line >> file >> entry.size);
+    entry.file     = fileName.parent_path() / file;
+    entry.orbit[0] = entry.orbit[1] = 0.0;
+
+    while(good && line >> op) {
+      if(op == "orbit") {
+        good = bool(line >> entry.orbit[0] >> entry.orbit[1]);
+      } else if(op == "move") {
+        char   axis;
+        double amount;
+        good = line >> axis >> amount && axis >= 'x' && axis <= 'z';
+        if(good)
+          entry.moves.push_back(std::make_pair(axis - 'x', amount));
+      } else if(op == "raster") {
+        entry.opts.rasterize = true;
+      } else if(op == "batch") {
+        entry.opts.batchRays = true;
+      } else if(op == "samples") {
+        good = bool(line >> entry.opts.maxSamples);
+      } else if(op == "order") {
+        std::string order;
+        good = bool(line >> order) && (order == "morton" || order == "hilbert");
+        entry.opts.order = order == "morton" ? ray::RenderOptions::morton : ray::RenderOptions::hilbert;
+      } else {
+        good = false;
+      }
+    }
+
+    if(!good) {
+      std::cout << "Bad scene line " << fileName.string() << ":" << lineno << ": "
+                << buffer << std::endl;
+      return false;
+    }
+
+    entries.push_back(entry);
+  }
+
+  return true;
+}
+
+/**
+ * Renders an entry several times after a warm up render.
+ *
+ * @param entry    the entry to render
+ * @param repeats  the number of timed renders
+ * @return         the median time and the counters and picture of the last render
+ */
+Measured measure(const Entry& entry, int repeats) {
+  auto stream = ray::ObjectStream::loadObject(entry.file.string());
+  if(!stream)
+    throw std::exception();
+
+  ray::Model  model;
+  ray::Camera camera;
+  ray::Model::fromObjectStream(stream, model, camera);
+
+  ray::Box    bounds = model.getBounds();
+  ray::Vector center = bounds.min() + bounds.len() / 2.0;
+
+  camera.rotate(entry.orbit[0], ray::Camera::x_axis, center);
+  camera.rotate(entry.orbit[1], ray::Camera::y_axis, center);
+  for(const auto& move : entry.moves)
+    camera.move(move.second, ray::Camera::axis(move.first));
+
+  model.options() = entry.opts;
+
+  Measured ret;
+  std::vector<double> times;
+
+  ret.image = model.click(camera, entry.size, entry.size);
+
+  for(int i = 0; i < repeats; i++) {
+    auto begin = sc::steady_clock::now();
+    ret.image = model.click(camera, entry.size, entry.size);
+    auto end   = sc::steady_clock::now();
+
+    times.push_back(sc::duration_cast<sc::microseconds>(end - begin).count() / 1000.0);
+  }
+
+  std::sort(times.begin(), times.end());
+  ret.ms = times[times.size() / 2];
+
+  ret.counters["samples"] = model.samples();
+  ret.counters["shadow"]  = model.shadowStats().rays;
+
+  if(ray::RayStats::enabled) {
+    const ray::RayStats& stats = model.stats();
+    ret.counters["rays"]          = stats.primary + stats.reflection + stats.shadow;
+    ret.counters["boxTests"]      = stats.boxTests;
+    ret.counters["triangleTests"] = stats.triangleTests;
+  }
+
+  return ret;
+}
+
+/**
+ * Counts the pixels of two pictures that differ by more than a tolerance in
+ * any channel.
+ *
+ * @return  the number of pixels, or every pixel when the sizes differ
+ */
+uint64_t countDiffs(const ray::Matrix<ray::Pixel>& a, const ray::Matrix<ray::Pixel>& b, int tolerance) {
+  if(a.rows() != b.rows() || a.cols() != b.cols())
+    return std::max(uint64_t(a.rows()) * a.cols(), uint64_t(b.rows()) * b.cols());
+
+  uint64_t ret = 0;
+  for(uint32_t i = 0; i < a.rows(); i++) {
+    for(uint32_t j = 0; j < a.cols(); j++) {
+      const ray::Pixel& p = a[i][j];
+      const ray::Pixel& q = b[i][j];
+
+      if(std::abs(p.r() - q.r()) > tolerance ||
+         std::abs(p.g() - q.g()) > tolerance ||
+         std::abs(p.b() - q.b()) > tolerance)
+        ret++;
+    }
+  }
+
+  return ret;
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("update", "render every scene and store the timings as the new baseline")
+      ("golden", "render every scene and store the pictures as the new golden images")
+      ("repeats", po::value<int>()->default_value(5), "the number of timed renders of each scene")
+      ("slower", po::value<double>()->default_value(10.0),
+          "the percentage a time or counter can grow by before it fails")
+      ("tolerance", po::value<int>()->default_value(2),
+          "the difference in a color channel that a pixel can drift by")
+      ("max-diff", po::value<double>()->default_value(0.001),
+          "the fraction of pixels that can drift before a picture fails")
+      ("filter", po::value<std::string>()->default_value(""),
+          "only run the scenes whose name contains this");
+
+  po::options_description hidden;
+  hidden.add_options()
+      ("list", po::value<std::string>()->default_value("regress/scenes.txt"));
+
+  po::options_description all;
+  all.add(visible).add(hidden);
+
+  po::positional_options_description positional;
+  positional.add("list", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).
+        options(all).positional(positional).run(), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  if(vm.count("help")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  fs::path    list      = vm["list"].as<std::string>();
+  fs::path    golden    = list.parent_path() / "golden";
+  fs::path    baseline  = list.parent_path() / "baseline.json";
+  bool        update    = vm.count("update") != 0;
+  bool        store     = vm.count("golden") != 0;
+  int         repeats   = std::max(vm["repeats"].as<int>(), 1);
+  double      slower    = 1.0 + vm["slower"].as<double>() / 100.0;
+  int         tolerance = vm["tolerance"].as<int>();
+  double      maxDiff   = vm["max-diff"].as<double>();
+  std::string filter    = vm["filter"].as<std::string>();
+
+  std::vector<Entry> entries;
+  if(!readEntries(list, entries)) {
+    std::cout << "Could not read the scene list " << list.string() << std::endl;
+    return -1;
+  }
+
+  pt::ptree base;
+  if(fs::exists(baseline))
+    pt::read_json(baseline.string(), base);
+
+  if(store)
+    fs::create_directories(golden);
+
+  if(!update && !store && !fs::exists(baseline))
+    std::cout << "No timing baseline in " << baseline.string()
+              << ", only the pictures are checked" << std::endl;
+
+  int failed = 0;
+
+  for(const Entry& entry : entries) {
+    if(entry.name.find(filter) == std::string::npos)
+      continue;
+
+    Measured now;
+    try {
+      now = measure(entry, repeats);
+    } catch(std::exception& error) {
+      std::cout << std::left << std::setw(20) << entry.name
+                << " FAIL could not load " << entry.file.string() << std::endl;
+      failed++;
+      continue;
+    }
+
+    fs::path picture = golden / (entry.name + ".ppm");
+
+    std::cout << std::left << std::setw(20) << entry.name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10) << now.ms << " ms";
+
+    /* store the new baseline or golden image for the entry */
+    if(update || store) {
+      if(update) {
+        pt::ptree node;
+        node.put("ms", now.ms);
+        for(const auto& counter : now.counters)
+          node.put(counter.first, counter.second);
+        base.put_child(pt::ptree::path_type(entry.name, '/'), node);
+      }
+
+      if(store && !ray::writePPM(picture.string(), now.image)) {
+        std::cout << " FAIL could not write " << picture.string() << std::endl;
+        failed++;
+        continue;
+      }
+
+      std::cout << " stored" << std::endl;
+      continue;
+    }
+
+    /* compare against the old baseline */
+    std::vector<std::string> problems;
+    auto old = base.get_child_optional(pt::ptree::path_type(entry.name, '/'));
+    ray::Matrix<ray::Pixel> expected;
+
+    /* without a baseline for the machine only the picture is checked */
+    if(old) {
+      double before = old->get<double>("ms");
+      std::cout << " (baseline " << std::setw(8) << before << " ms, "
+                << std::showpos << (now.ms / before - 1.0) * 100.0 << std::noshowpos << "%)";
+
+      if(now.ms > before * slower)
+        problems.push_back("slower");
+
+      for(const auto& counter : now.counters) {
+        auto count = old->get_optional<uint64_t>(counter.first);
+        if(count && counter.second > *count * slower) {
+          std::ostringstream ostr;
+          ostr << counter.first << " " << *count << " -> " << counter.second;
+          problems.push_back(ostr.str());
+        }
+      }
+    }
+
+    if(!ray::readPPM(picture.string(), expected)) {
+      problems.push_back("no golden image");
+    } else {
+      uint64_t diffs = countDiffs(now.image, expected, tolerance);
+      uint64_t total = uint64_t(now.image.rows()) * now.image.cols();
+
+      if(diffs > maxDiff * total) {
+        std::ostringstream ostr;
+        ostr << "image drifted (" << diffs << " of " << total << " pixels)";
+        problems.push_back(ostr.str());
+      }
+    }
+
+    if(problems.empty()) {
+      std::cout << " ok" << std::endl;
+    } else {
+      std::cout << " FAIL";
+      for(const std::string& problem : problems)
+        std::cout << " [" << problem << "]";
+      std::cout << std::endl;
+      failed++;
+    }
+  }
+
+  if(update)
+    pt::write_json(baseline.string(), base);
+  if(update || store)
+    return failed ? 1 : 0;
+
+  if(failed)
+    std::cout << failed << " scene(s) failed" << std::endl;
+
+  return failed ? 1 : 0;
+}
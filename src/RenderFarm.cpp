@@ -0,0 +1,666 @@
+/*
+ * RenderFarm.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ImageFile.hpp>
+#include <ObjectStream.hpp>
+#include <Model.hpp>
+#include <Socket.hpp>
+#include <Timeline.hpp>
+#include <WorkerPool.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+namespace sc = std::chrono;
+
+/* system includes */
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* boost includes */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+using ray::net::readLine;
+using ray::net::sendAll;
+using ray::timeline::ms;
+
+const char* usage =
+    "Usage: RenderFarm coordinator [options] <model file> <output file>\n"
+    "       RenderFarm worker [options]";
+
+/**
+ * What every worker needs to know to render its part of a frame. This is
+ * sent to each worker as a single line when it connects:
+ *
+ *   frame <rows> <cols> <samples> <orbit x> <orbit y> <model file>
+ *
+ * The model file has to be readable by every worker, at the same path. Each
+ * worker makes the Camera from the model the same way Tracer does and turns
+ * it by the orbit, so every worker ends up with the same Camera.
+ */
+struct Frame {
+  int         rows, cols;
+  uint16_t    samples;
+  double      orbit[2];
+  std::string file;
+
+  std::string line() const {
+    std::ostringstream ostr;
+    ostr << std::setprecision(17) << "frame " << rows << " " << cols << " " << samples
+         << " " << orbit[0] << " " << orbit[1] << " " << file;
+    return ostr.str();
+  }
+
+  bool read(std::istream& istr) {
+    std::string word;
+    if(!(istr >> word >> rows >> cols >> samples >> orbit[0] >> orbit[1] >> std::ws) || word != "frame")
+      return false;
+    return bool(std::getline(istr, file)) && !file.empty();
+  }
+};
+
+/** a rectangle of a frame, sent to a worker as "tile <id> <top> <left> <height> <width>" */
+struct Tile {
+  uint32_t id;
+  int      top, left, height, width;
+};
+
+/* ************************************************************************** */
+/* *** worker *************************************************************** */
+/* ************************************************************************** */
+
+/**
+ * Renders a tile of the frame, which has the same pixels as rendering the
+ * whole frame at once.
+ *
+ * @return  the pixels of the tile, three bytes each in row major order
+ */
+static std::string renderTile(const ray::Model& model, const ray::Camera& cam,
+    const Frame& frame, const Tile& tile)
+{
+  ray::Matrix<ray::Pixel> image = model.click(cam, frame.rows, frame.cols,
+      ray::Rect(tile.top, tile.left, tile.height, tile.width));
+
+  std::string ret(tile.height * tile.width * 3, '\0');
+  for(int i = 0; i < tile.height; i++) {
+    for(int j = 0; j < tile.width; j++) {
+      const ray::Pixel& p = image[i][j];
+      char* out = &ret[(i * tile.width + j) * 3];
+
+      out[0] = char(p.r());
+      out[1] = char(p.g());
+      out[2] = char(p.b());
+    }
+  }
+
+  return ret;
+}
+
+/**
+ * Connects to the coordinator and renders the tiles it sends until it says
+ * the frame is done. The model is only loaded again when a frame names a
+ * different file.
+ *
+ * @param host       the coordinator
+ * @param port       the port the coordinator listens on
+ * @param failAfter  exit without a word after this many tiles, for testing
+ * @return           the exit code of the worker
+ */
+static int worker(const std::string& host, const std::string& port, int failAfter) {
+  int fd = ray::net::connectTo(host, port);
+  if(fd < 0) {
+    std::cout << "Could not connect to " << host << ":" << port << std::endl;
+    return -1;
+  }
+
+  std::unique_ptr<ray::Model> model;
+  ray::Camera  base, camera;
+  std::string  loaded;
+  Frame        frame;
+  std::string  buffer, line;
+  int          tiles = 0;
+
+  auto pool = std::make_shared<ray::WorkerPool>();
+
+  while(readLine(fd, buffer, line)) {
+    std::istringstream istr(line);
+    std::string command;
+    istr >> command;
+
+    if(command == "frame") {
+      std::istringstream again(line);
+      auto begin = sc::steady_clock::now();
+
+      if(!frame.read(again)) {
+        sendAll(fd, "error bad frame\n");
+        break;
+      }
+
+      /* load the model, keeping the last one if it is the same file */
+      if(frame.file != loaded) {
+        model.reset(new ray::Model());
+        try {
+          if(!fs::is_regular_file(frame.file))
+            throw std::exception();
+          auto stream = ray::ObjectStream::loadObject(frame.file);
+          if(!stream)
+            throw std::exception();
+          ray::Model::fromObjectStream(stream, *model, base);
+        } catch(std::exception& error) {
+          sendAll(fd, "error could not load " + frame.file + "\n");
+          break;
+        }
+
+        model->setPool(pool);
+        loaded = frame.file;
+      }
+
+      camera = base;
+
+      ray::Box    bounds = model->getBounds();
+      ray::Vector center = bounds.min() + bounds.len() / 2.0;
+      camera.rotate(frame.orbit[0], ray::Camera::x_axis, center);
+      camera.rotate(frame.orbit[1], ray::Camera::y_axis, center);
+      model->options().maxSamples = frame.samples;
+
+      std::ostringstream reply;
+      reply << "ready " << ms(begin, sc::steady_clock::now()) << "\n";
+      if(!sendAll(fd, reply.str()))
+        break;
+    } else if(command == "tile" && model) {
+      Tile tile;
+      if(!(istr >> tile.id >> tile.top >> tile.left >> tile.height >> tile.width)) {
+        sendAll(fd, "error bad tile\n");
+        break;
+      }
+
+      if(failAfter >= 0 && tiles++ >= failAfter)
+        _exit(1);
+
+      std::string pixels = renderTile(*model, camera, frame, tile);
+      std::ostringstream head;
+      head << "tile " << tile.id << " " << pixels.size() << "\n";
+
+      if(!sendAll(fd, head.str() + pixels))
+        break;
+    } else if(command == "done") {
+      break;
+    } else {
+      sendAll(fd, "error unknown command " + command + "\n");
+      break;
+    }
+  }
+
+  close(fd);
+  return 0;
+}
+
+/* ************************************************************************** */
+/* *** coordinator ********************************************************** */
+/* ************************************************************************** */
+
+/**
+ * A worker connected to the coordinator.
+ */
+struct Remote {
+  int                fd;
+  std::string        in;
+  bool               ready;
+  std::set<uint32_t> tiles;
+  uint32_t           finished;
+};
+
+/**
+ * Hands the tiles of a frame out to workers as they connect and puts the
+ * returned tiles together. Each worker is kept busy with a few tiles at a
+ * time and gets another each time it returns one, so faster workers render
+ * more of the frame. The tiles of a worker that goes away go back to the
+ * front of the queue. Once the queue is empty, idle workers also take tiles
+ * that are still out with another worker, so one slow worker cannot hold up
+ * the end of the frame. Whichever copy of a tile comes back first is kept.
+ */
+class Coordinator {
+  public:
+
+    Coordinator(const Frame& frame, int tileSize, uint32_t depth) :
+        frame(frame), depth(depth), image(frame.rows, frame.cols),
+        tiles(), queue(), done(), copies(), remotes(), remaining(0), nlost(0)
+    {
+      for(int top = 0; top < frame.rows; top += tileSize) {
+        for(int left = 0; left < frame.cols; left += tileSize) {
+          Tile tile = { uint32_t(tiles.size()), top, left,
+              std::min(tileSize, frame.rows - top), std::min(tileSize, frame.cols - left) };
+          tiles.push_back(tile);
+          queue.push_back(tile.id);
+        }
+      }
+
+      done.assign(tiles.size(), false);
+      copies.assign(tiles.size(), 0);
+      remaining = tiles.size();
+    }
+
+    /**
+     * Runs until every tile has come back, or until no worker is left to
+     * render the rest: every worker that connected has gone away, or every
+     * worker process that was started on this machine has exited before
+     * connecting.
+     *
+     * @param listener  the socket that workers connect to
+     * @param children  the worker processes that were started, the ones that
+     *                  exit are taken out
+     * @return          false if the frame could not be finished
+     */
+    bool run(int listener, std::vector<pid_t>& children) {
+      bool waiting = false;
+      bool spawned = !children.empty();
+
+      while(remaining) {
+        for(int i = int(children.size()) - 1; i >= 0; i--)
+          if(waitpid(children[i], nullptr, WNOHANG) != 0)
+            children.erase(children.begin() + i);
+
+        if(remotes.empty() && (nlost != 0 || (spawned && children.empty())))
+          return false;
+
+        std::vector<pollfd> fds(1 + remotes.size());
+        fds[0].fd     = listener;
+        fds[0].events = POLLIN;
+        for(uint32_t i = 0; i < remotes.size(); i++) {
+          fds[i + 1].fd     = remotes[i].fd;
+          fds[i + 1].events = POLLIN;
+        }
+
+        if(remotes.empty() && !waiting)
+          std::cout << "Waiting for workers" << std::endl;
+        waiting = remotes.empty();
+
+        /* a worker process that exits before it connects is only noticed
+         * by checking on it, so wake up now and then while there are some */
+        if(poll(fds.data(), fds.size(), children.empty() ? -1 : 250) < 0)
+          continue;
+
+        /* go backwards so that dropping a worker leaves the others in place */
+        for(int i = int(remotes.size()) - 1; i >= 0; i--)
+          if(fds[i + 1].revents && !receive(remotes[i]))
+            drop(i);
+
+        if(fds[0].revents & POLLIN)
+          accept(listener);
+      }
+
+      for(Remote& remote : remotes) {
+        sendAll(remote.fd, "done\n");
+        close(remote.fd);
+      }
+
+      return true;
+    }
+
+    /** the number of tiles that have not come back */
+    inline uint32_t pending() const { return remaining; }
+
+    inline const ray::Matrix<ray::Pixel>& picture() const { return image; }
+
+    /** how many tiles each worker that stayed to the end rendered */
+    std::vector<uint32_t> counts() const {
+      std::vector<uint32_t> ret;
+      for(const Remote& remote : remotes)
+        ret.push_back(remote.finished);
+      return ret;
+    }
+
+    /** the number of workers that went away before the frame was done */
+    inline uint32_t lost() const { return nlost; }
+
+  private:
+
+    void accept(int listener) {
+      int fd = ::accept(listener, nullptr, nullptr);
+      if(fd < 0)
+        return;
+
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+      Remote remote = { fd, std::string(), false, std::set<uint32_t>(), 0 };
+      if(sendAll(fd, frame.line() + "\n"))
+        remotes.push_back(remote);
+      else
+        close(fd);
+    }
+
+    /**
+     * Reads what a worker has sent and handles every whole message.
+     *
+     * @return  false if the worker has gone away or sent something bad
+     */
+    bool receive(Remote& remote) {
+      char chunk[65536];
+      ssize_t count = ::recv(remote.fd, chunk, sizeof(chunk), 0);
+      if(count <= 0)
+        return false;
+      remote.in.append(chunk, count);
+
+      size_t end;
+      while((end = remote.in.find('\n')) != std::string::npos) {
+        std::istringstream line(remote.in.substr(0, end));
+        std::string command;
+        line >> command;
+
+        if(command == "ready") {
+          remote.ready = true;
+          remote.in.erase(0, end + 1);
+        } else if(command == "tile") {
+          uint32_t id;
+          size_t   bytes;
+
+          if(!(line >> id >> bytes) || id >= tiles.size() ||
+              bytes != size_t(tiles[id].height) * tiles[id].width * 3)
+            return false;
+
+          if(remote.in.size() < end + 1 + bytes)
+            break;
+
+          place(tiles[id], remote.in.data() + end + 1);
+          remote.in.erase(0, end + 1 + bytes);
+          remote.tiles.erase(id);
+          remote.finished++;
+        } else {
+          std::cout << "Worker " << remote.fd << ": " << remote.in.substr(0, end) << std::endl;
+          return false;
+        }
+      }
+
+      return feed(remote);
+    }
+
+    /**
+     * Copies a returned tile into the picture, unless another copy of it came
+     * back first.
+     */
+    void place(const Tile& tile, const char* pixels) {
+      if(done[tile.id])
+        return;
+
+      for(int i = 0; i < tile.height; i++) {
+        for(int j = 0; j < tile.width; j++) {
+          const unsigned char* rgb =
+              reinterpret_cast<const unsigned char*>(pixels + (i * tile.width + j) * 3);
+          image[tile.top + i][tile.left + j] = ray::Pixel(rgb[0], rgb[1], rgb[2]);
+        }
+      }
+
+      done[tile.id] = true;
+      remaining--;
+    }
+
+    /**
+     * Sends tiles to a worker until it has depth of them.
+     */
+    bool feed(Remote& remote) {
+      if(!remote.ready)
+        return true;
+
+      while(remote.tiles.size() < depth) {
+        uint32_t id;
+
+        if(!next(remote, id))
+          break;
+
+        std::ostringstream ostr;
+        const Tile& tile = tiles[id];
+        ostr << "tile " << id << " " << tile.top << " " << tile.left << " "
+             << tile.height << " " << tile.width << "\n";
+
+        remote.tiles.insert(id);
+        copies[id]++;
+
+        if(!sendAll(remote.fd, ostr.str()))
+          return false;
+      }
+
+      return true;
+    }
+
+    /**
+     * Picks the next tile for a worker: the front of the queue, or once the
+     * queue is empty the tile out with other workers that has the fewest
+     * copies out.
+     */
+    bool next(const Remote& remote, uint32_t& id) {
+      while(!queue.empty()) {
+        id = queue.front();
+        queue.pop_front();
+        if(!done[id])
+          return true;
+      }
+
+      bool found = false;
+      for(const Remote& other : remotes) {
+        for(uint32_t tile : other.tiles) {
+          if(!done[tile] && !remote.tiles.count(tile) && copies[tile] < 2 &&
+              (!found || copies[tile] < copies[id])) {
+            id    = tile;
+            found = true;
+          }
+        }
+      }
+
+      return found;
+    }
+
+    /**
+     * Closes a worker and puts the tiles it had back at the front of the
+     * queue.
+     */
+    void drop(uint32_t idx) {
+      Remote remote = remotes[idx];
+      remotes.erase(remotes.begin() + idx);
+      close(remote.fd);
+      nlost++;
+
+      for(uint32_t id : remote.tiles) {
+        copies[id]--;
+        if(!done[id] && copies[id] == 0)
+          queue.push_front(id);
+      }
+
+      std::cout << "Lost a worker, " << remote.tiles.size() << " tile(s) sent again" << std::endl;
+
+      for(Remote& other : remotes)
+        if(!feed(other))
+          other.ready = false;
+    }
+
+    Frame                   frame;
+    uint32_t                depth;
+    ray::Matrix<ray::Pixel> image;
+
+    std::vector<Tile>     tiles;
+    std::deque<uint32_t>  queue;
+    std::vector<bool>     done;
+    std::vector<uint32_t> copies;
+    std::vector<Remote>   remotes;
+    uint32_t              remaining;
+    uint32_t              nlost;
+};
+
+/**
+ * Starts a worker process on this machine.
+ */
+static pid_t spawn(const char* self, const std::string& port) {
+  pid_t pid = fork();
+
+  if(pid == 0) {
+    execl(self, self, "worker", "--connect", ("127.0.0.1:" + port).c_str(), (char*)nullptr);
+    _exit(127);
+  }
+
+  return pid;
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("port", po::value<int>()->default_value(0),
+          "coordinator: the TCP port workers connect to, 0 picks a free one")
+      ("spawn", po::value<int>()->default_value(0),
+          "coordinator: start this many workers on this machine")
+      ("size", po::value<int>()->default_value(1024),
+          "coordinator: the number of rows and columns in the picture")
+      ("samples", po::value<uint16_t>()->default_value(1),
+          "coordinator: most samples taken for a pixel on an edge")
+      ("orbit", po::value<std::vector<double> >()->multitoken(),
+          "coordinator: turn the camera around the model by <x> <y> radians")
+      ("tile", po::value<int>()->default_value(64),
+          "coordinator: the number of rows and columns in each tile")
+      ("depth", po::value<uint32_t>()->default_value(2),
+          "coordinator: the number of tiles each worker is given at once")
+      ("connect", po::value<std::string>(),
+          "worker: the <host>:<port> of the coordinator")
+      ("fail-after", po::value<int>()->default_value(-1),
+          "worker: exit without finishing after this many tiles, for testing");
+
+  po::options_description hidden;
+  hidden.add_options()
+      ("mode",   po::value<std::string>())
+      ("model",  po::value<std::string>())
+      ("output", po::value<std::string>());
+
+  po::options_description all;
+  all.add(visible).add(hidden);
+
+  po::positional_options_description positional;
+  positional.add("mode", 1).add("model", 1).add("output", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).
+        options(all).positional(positional).run(), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string mode = vm.count("mode") ? vm["mode"].as<std::string>() : "";
+
+  if(vm.count("help") || (mode != "coordinator" && mode != "worker")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  /* run a worker */
+  if(mode == "worker") {
+    std::string address = vm.count("connect") ? vm["connect"].as<std::string>() : "";
+    size_t colon = address.rfind(':');
+
+    if(colon == std::string::npos) {
+      std::cout << "A worker needs --connect <host>:<port>" << std::endl;
+      return -1;
+    }
+
+    return worker(address.substr(0, colon), address.substr(colon + 1),
+        vm["fail-after"].as<int>());
+  }
+
+  /* run the coordinator */
+  if(!vm.count("model") || !vm.count("output")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  Frame frame;
+  frame.rows     = frame.cols = std::max(vm["size"].as<int>(), 1);
+  frame.samples  = std::max(vm["samples"].as<uint16_t>(), uint16_t(1));
+  frame.file     = fs::absolute(vm["model"].as<std::string>()).string();
+  frame.orbit[0] = frame.orbit[1] = 0.0;
+
+  if(vm.count("orbit")) {
+    std::vector<double> orbit = vm["orbit"].as<std::vector<double> >();
+    if(orbit.size() != 2) {
+      std::cout << "--orbit takes two angles" << std::endl;
+      return -1;
+    }
+    frame.orbit[0] = orbit[0];
+    frame.orbit[1] = orbit[1];
+  }
+
+  if(!fs::is_regular_file(frame.file)) {
+    std::cout << usage << std::endl;
+    return -1;
+  }
+
+  /* listen for workers */
+  std::string port;
+  int listener = ray::net::listenOn(vm["port"].as<int>(), port);
+  if(listener < 0) {
+    std::cout << "Could not listen: " << std::strerror(errno) << std::endl;
+    return -1;
+  }
+
+  std::cout << "Listening on port " << port << std::endl;
+
+  std::vector<pid_t> children;
+  for(int i = 0; i < vm["spawn"].as<int>(); i++)
+    children.push_back(spawn(argv[0], port));
+
+  auto begin = sc::steady_clock::now();
+
+  Coordinator coordinator(frame, std::max(vm["tile"].as<int>(), 1),
+      std::max(vm["depth"].as<uint32_t>(), uint32_t(1)));
+  bool finished = coordinator.run(listener, children);
+
+  double elapsed = ms(begin, sc::steady_clock::now());
+  close(listener);
+
+  for(pid_t child : children) {
+    if(!finished)
+      kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+  }
+
+  if(!finished) {
+    std::cout << "No workers are left, " << coordinator.pending()
+              << " tile(s) were not rendered" << std::endl;
+    return -1;
+  }
+
+  if(!ray::writePPM(vm["output"].as<std::string>(), coordinator.picture())) {
+    std::cout << "Could not write " << vm["output"].as<std::string>() << std::endl;
+    return -1;
+  }
+
+  std::cout << "Rendered in " << std::fixed << std::setprecision(2) << elapsed << " ms, tiles per worker:";
+  for(uint32_t count : coordinator.counts())
+    std::cout << " " << count;
+  std::cout << " (" << coordinator.lost() << " worker(s) lost)" << std::endl;
+
+  return 0;
+}
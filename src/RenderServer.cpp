@@ -0,0 +1,494 @@
+/*
+ * RenderServer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ImageFile.hpp>
+#include <ObjectStream.hpp>
+#include <Model.hpp>
+#include <Socket.hpp>
+#include <Timeline.hpp>
+#include <WorkerPool.hpp>
+
+/* std includes */
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+namespace sc = std::chrono;
+
+/* system includes */
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* boost includes */
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+using ray::timeline::ms;
+
+const char* usage = "Usage: RenderServer [options]";
+
+/** the most pixels a render request can ask for, 8192x8192 */
+static const uint64_t maxPixels = uint64_t(8192) * 8192;
+
+/**
+ * A Model that stays loaded between jobs, with the Camera that was made for
+ * it when it was loaded.
+ */
+struct Resident {
+  typedef std::shared_ptr<Resident> ptr;
+
+  std::string file;
+  ray::Model  model;
+  ray::Camera camera;
+  ray::Vector center;
+};
+
+/**
+ * Every resident Model by the ID that jobs use for it. A Model is built
+ * once when it is loaded and shared with every job that renders it, jobs
+ * that are queued keep their Model alive even if it is unloaded.
+ */
+class Residents {
+  public:
+
+    Residents(ray::WorkerPool::ptr pool) : lock(), loading(), models(), pool(pool) { }
+
+    /**
+     * Loads and builds a Model, replacing any Model with the same ID. The
+     * obj and scene parsers keep their state in globals, so only one Model
+     * is parsed at a time, while the other requests are still answered.
+     *
+     * @param id    the ID of the Model
+     * @param file  the file to load it from
+     * @return      false if the file could not be loaded
+     */
+    bool load(const std::string& id, const std::string& file) {
+      Resident::ptr res = std::make_shared<Resident>();
+
+      if(!fs::is_regular_file(file))
+        return false;
+
+      try {
+        std::lock_guard<std::mutex> parsing(loading);
+        auto stream = ray::ObjectStream::loadObject(file);
+        if(!stream)
+          return false;
+        ray::Model::fromObjectStream(stream, res->model, res->camera);
+      } catch(std::exception& error) {
+        return false;
+      }
+
+      res->file = file;
+      res->model.setPool(pool);
+
+      ray::Box bounds = res->model.getBounds();
+      res->center = bounds.min() + bounds.len() / 2.0;
+
+      std::lock_guard<std::mutex> guard(lock);
+      models[id] = res;
+      return true;
+    }
+
+    bool unload(const std::string& id) {
+      std::lock_guard<std::mutex> guard(lock);
+      return models.erase(id) != 0;
+    }
+
+    /** the Model with an ID, null if there is none */
+    Resident::ptr get(const std::string& id) const {
+      std::lock_guard<std::mutex> guard(lock);
+      auto iter = models.find(id);
+      return iter == models.end() ? Resident::ptr() : iter->second;
+    }
+
+    std::string list() const {
+      std::lock_guard<std::mutex> guard(lock);
+      std::ostringstream ostr;
+      for(const auto& model : models)
+        ostr << " " << model.first;
+      return ostr.str();
+    }
+
+  private:
+
+    mutable std::mutex                   lock;
+    std::mutex                           loading;
+    std::map<std::string, Resident::ptr> models;
+    ray::WorkerPool::ptr                 pool;
+};
+
+/**
+ * A client of the server. Responses to a client can come from the thread
+ * that reads its requests and from the thread that renders, so each
+ * response is sent whole while holding a lock.
+ */
+class Connection {
+  public:
+
+    typedef std::shared_ptr<Connection> ptr;
+
+    Connection(int fd, uint64_t id) : fd(fd), id(id), writing(), buffer() { }
+    ~Connection() { close(fd); }
+
+    Connection(const Connection& conn) = delete;
+    const Connection& operator =(const Connection& conn) = delete;
+
+    /**
+     * Sends a response line followed by any raw data.
+     *
+     * @param line  the response, without the newline
+     * @param data  bytes sent after the line
+     * @return      false if the client has gone away
+     */
+    bool send(const std::string& line, const std::string& data = "") {
+      std::lock_guard<std::mutex> guard(writing);
+      return ray::net::sendAll(fd, line + "\n") && ray::net::sendAll(fd, data);
+    }
+
+    /**
+     * Reads the next request line.
+     *
+     * @param line  return for the line, without the newline
+     * @return      false once the client has closed the connection
+     */
+    bool readLine(std::string& line) {
+      return ray::net::readLine(fd, buffer, line);
+    }
+
+    const int      fd;
+    const uint64_t id;
+
+  private:
+
+    std::mutex  writing;
+    std::string buffer;
+};
+
+/**
+ * A picture that a client asked for.
+ */
+struct Job {
+  typedef std::shared_ptr<Job> ptr;
+
+  Connection::ptr client;
+  std::string     id;
+  Resident::ptr   resident;
+  ray::Camera     camera;
+  int             rows, cols;
+  uint16_t        samples;
+  std::string     output;
+
+  sc::steady_clock::time_point queued;
+};
+
+/**
+ * The queue of jobs waiting to be rendered. Each client has its own queue
+ * and the clients take turns, so a client that sends many jobs at once
+ * cannot hold up the others for longer than one job each. Jobs run one at a
+ * time and each one uses every thread of the shared WorkerPool.
+ */
+class Scheduler {
+  public:
+
+    Scheduler() : lock(), ready(), queues(), last(0) { }
+
+    void push(Job::ptr job) {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        queues[job->client->id].push_back(job);
+      }
+      ready.notify_one();
+    }
+
+    /**
+     * Waits for a job, taking it from the client after the one that was
+     * served last.
+     */
+    Job::ptr pop() {
+      std::unique_lock<std::mutex> guard(lock);
+      ready.wait(guard, [this]() { return !queues.empty(); });
+
+      auto iter = queues.upper_bound(last);
+      if(iter == queues.end())
+        iter = queues.begin();
+
+      Job::ptr job = iter->second.front();
+      iter->second.pop_front();
+      last = iter->first;
+
+      if(iter->second.empty())
+        queues.erase(iter);
+
+      return job;
+    }
+
+    /** renders jobs forever */
+    void run() {
+      for(;;)
+        render(pop());
+    }
+
+  private:
+
+    void render(Job::ptr job) {
+      auto start = sc::steady_clock::now();
+
+      ray::Model& model = job->resident->model;
+      model.options().maxSamples = job->samples;
+
+      /* a render that fails is answered, it must not take down the server */
+      ray::Matrix<ray::Pixel> image;
+      try {
+        image = model.click(job->camera, job->rows, job->cols);
+      } catch(std::exception& error) {
+        job->client->send("error render " + job->id + " could not render");
+        return;
+      }
+      auto rendered = sc::steady_clock::now();
+
+      std::string data;
+      bool written;
+      try {
+        if(job->output == "-") {
+          std::ostringstream ostr;
+          written = ray::writePPM(ostr, image);
+          data = ostr.str();
+        } else {
+          written = ray::writePPM(job->output, image);
+        }
+      } catch(std::exception& error) {
+        written = false;
+        data.clear();
+      }
+      auto done = sc::steady_clock::now();
+
+      std::ostringstream line;
+      if(!written) {
+        line << "error render " << job->id << " could not write " << job->output;
+      } else {
+        line << std::fixed << std::setprecision(3)
+             << "ok render " << job->id
+             << " queued " << ms(job->queued, start)
+             << " render " << ms(start, rendered)
+             << " write "  << ms(rendered, done)
+             << " total "  << ms(job->queued, done);
+        if(!data.empty())
+          line << " bytes " << data.size();
+      }
+
+      job->client->send(line.str(), data);
+    }
+
+    std::mutex                                   lock;
+    std::condition_variable                      ready;
+    std::map<uint64_t, std::deque<Job::ptr> >    queues;
+    uint64_t                                     last;
+};
+
+/**
+ * Reads the camera of a render request. The Camera starts as the one made
+ * for the Model when it was loaded.
+ *
+ *   orbit <x> <y>        turns the Camera around the center of the Model
+ *   camera <fp> <vrp> <up>  nine numbers, replaces the Camera
+ *   samples <n>          the most samples for a pixel on an edge
+ *
+ * @return  false if the request could not be read
+ */
+static bool readJob(std::istream& line, Job& job) {
+  std::string word;
+
+  job.camera  = job.resident->camera;
+  job.samples = 1;
+
+  while(line >> word) {
+    if(word == "orbit") {
+      double x, y;
+      if(!(line >> x >> y))
+        return false;
+      job.camera.rotate(x, ray::Camera::x_axis, job.resident->center);
+      job.camera.rotate(y, ray::Camera::y_axis, job.resident->center);
+    } else if(word == "camera") {
+      double v[9];
+      for(double& d : v)
+        if(!(line >> d))
+          return false;
+      job.camera = ray::Camera(
+          ray::Vector(v[0], v[1], v[2]),
+          ray::Vector(v[3], v[4], v[5]),
+          ray::Vector(v[6], v[7], v[8]));
+    } else if(word == "samples") {
+      if(!(line >> job.samples) || job.samples == 0)
+        return false;
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Answers the requests of one client until it disconnects. Renders are
+ * queued and answered by the Scheduler in the order they were sent, every
+ * other request is answered straight away.
+ */
+static void serve(Connection::ptr client, Residents* residents, Scheduler* scheduler) {
+  std::string buffer;
+
+  while(client->readLine(buffer)) {
+    std::istringstream line(buffer);
+    std::string command, id;
+
+    if(!(line >> command))
+      continue;
+
+    if(command == "render") {
+      Job::ptr job = std::make_shared<Job>();
+      job->client = client;
+      job->queued = sc::steady_clock::now();
+
+      if(!(line >> job->id >> job->rows >> job->cols >> job->output) ||
+          job->rows <= 0 || job->cols <= 0) {
+        client->send("error render: expected <id> <rows> <cols> <output>");
+      } else if(uint64_t(job->rows) * job->cols > maxPixels) {
+        client->send("error render " + job->id + " is bigger than " + std::to_string(maxPixels) + " pixels");
+      } else if(!(job->resident = residents->get(job->id))) {
+        client->send("error render " + job->id + " is not loaded");
+      } else if(!readJob(line, *job)) {
+        client->send("error render " + job->id + " bad camera");
+      } else {
+        scheduler->push(job);
+      }
+    } else if(command == "load") {
+      std::string file;
+      auto begin = sc::steady_clock::now();
+
+      if(!(line >> id >> file)) {
+        client->send("error load: expected <id> <file>");
+      } else if(!residents->load(id, file)) {
+        client->send("error load " + id + " could not load " + file);
+      } else {
+        std::ostringstream ostr;
+        ostr << std::fixed << std::setprecision(3)
+             << "ok load " << id << " " << ms(begin, sc::steady_clock::now());
+        client->send(ostr.str());
+      }
+    } else if(command == "unload") {
+      line >> id;
+      client->send(residents->unload(id) ? "ok unload " + id : "error unload " + id + " is not loaded");
+    } else if(command == "list") {
+      client->send("ok list" + residents->list());
+    } else {
+      client->send("error unknown command " + command);
+    }
+  }
+}
+
+/** the path of the socket, removed when the server is stopped */
+static std::string socketPath;
+
+static void stop(int) {
+  unlink(socketPath.c_str());
+  _exit(0);
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("socket", po::value<std::string>()->default_value("/tmp/raytracer.sock"),
+          "the unix domain socket to listen on")
+      ("threads", po::value<int>()->default_value(boost::thread::hardware_concurrency()),
+          "the number of render threads shared by every job")
+      ("model", po::value<std::vector<std::string> >(),
+          "load a model before listening, as <id>=<file>, may be repeated");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, visible), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  if(vm.count("help")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  auto pool = std::make_shared<ray::WorkerPool>(std::max(vm["threads"].as<int>(), 0));
+  Residents residents(pool);
+  Scheduler scheduler;
+
+  if(vm.count("model")) {
+    for(const std::string& arg : vm["model"].as<std::vector<std::string> >()) {
+      size_t eq = arg.find('=');
+      if(eq == std::string::npos || !residents.load(arg.substr(0, eq), arg.substr(eq + 1))) {
+        std::cout << "Could not load " << arg << std::endl;
+        return -1;
+      }
+    }
+  }
+
+  /* listen on the socket */
+  socketPath = vm["socket"].as<std::string>();
+
+  sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(socketPath.size() >= sizeof(addr.sun_path)) {
+    std::cout << "The socket path is too long: " << socketPath << std::endl;
+    return -1;
+  }
+  std::strcpy(addr.sun_path, socketPath.c_str());
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  unlink(socketPath.c_str());
+  if(listener < 0 ||
+      bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+      listen(listener, 16) < 0) {
+    std::cout << "Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+    return -1;
+  }
+
+  std::signal(SIGINT,  stop);
+  std::signal(SIGTERM, stop);
+
+  boost::thread renderer(boost::bind(&Scheduler::run, &scheduler));
+
+  std::cout << "Listening on " << socketPath << std::endl;
+
+  for(uint64_t id = 1;; id++) {
+    int fd = accept(listener, nullptr, nullptr);
+    if(fd < 0)
+      continue;
+
+    boost::thread client(boost::bind(&serve,
+        std::make_shared<Connection>(fd, id), &residents, &scheduler));
+    client.detach();
+  }
+
+  return 0;
+}
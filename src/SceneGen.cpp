@@ -0,0 +1,774 @@
+/*
+ * SceneGen.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <MeshFile.hpp>
+#include <Model.hpp>
+#include <ObjectStream.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+/* boost includes */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+const char* usage = "Usage: SceneGen [options] <teapots|sphere|soup|lights|mirrors> <output>";
+
+/**
+ * A small random number generator (splitmix64). The standard distributions
+ * are free to differ between standard libraries, this is not, so a seed will
+ * make the same scene everywhere.
+ */
+class Random {
+  public:
+
+    Random(uint64_t seed) : state(seed) { }
+
+    uint64_t next() {
+      uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      return z ^ (z >> 31);
+    }
+
+    double uniform(double lo, double hi) {
+      return lo + (hi - lo) * (double(next() >> 11) / double(1ull << 53));
+    }
+
+  private:
+
+    uint64_t state;
+};
+
+/**
+ * Where the generated geometry is written. Everything has to be written in
+ * the order of a binary mesh file: Materials, vertices, normals and then
+ * polygons.
+ */
+class Sink {
+  public:
+
+    virtual ~Sink() { }
+
+    virtual void material(const ray::Material& mat) = 0;
+    virtual void vertex  (const ray::Vector& v) = 0;
+    virtual void normal  (const ray::Vector& n) = 0;
+    virtual void polygon (const std::vector<int32_t>& vertices,
+                          const std::vector<int32_t>& normals,
+                          uint16_t material) = 0;
+    virtual void close() = 0;
+
+    static std::unique_ptr<Sink> open(const fs::path& path);
+};
+
+/**
+ * Writes an obj file and the mtl file that goes with it. The Materials are
+ * named so that the loader keeps them in the order they were written.
+ */
+class ObjSink : public Sink {
+  public:
+
+    ObjSink(const fs::path& path) :
+        obj(path.string().c_str()),
+        mtl(fs::path(path).replace_extension(".mtl").string().c_str()),
+        nmaterials(0), current(-1)
+    {
+      if(!obj || !mtl)
+        throw std::exception();
+
+      obj << std::setprecision(9);
+      obj << "mtllib " << fs::path(path).replace_extension(".mtl").filename().string() << "\n";
+    }
+
+    virtual void material(const ray::Material& mat) {
+      const ray::Matrix<double>& d = mat.diffuse();
+
+      mtl << "newmtl " << name(nmaterials++) << "\n"
+          << "Ka 0 0 0\n"
+          << "Kd " << d[0][0] << " " << d[1][1] << " " << d[2][2] << "\n"
+          << "Ks " << mat.ks() << " " << mat.ks() << " " << mat.ks() << "\n"
+          << "Ns " << mat.alpha() << "\n"
+          << "illum 2\n\n";
+    }
+
+    virtual void vertex(const ray::Vector& v) {
+      obj << "v " << v.x() << " " << v.y() << " " << v.z() << "\n";
+    }
+
+    virtual void normal(const ray::Vector& n) {
+      obj << "vn " << n.x() << " " << n.y() << " " << n.z() << "\n";
+    }
+
+    virtual void polygon(const std::vector<int32_t>& vertices,
+        const std::vector<int32_t>& normals, uint16_t material)
+    {
+      if(material != current) {
+        obj << "usemtl " << name(material) << "\n";
+        current = material;
+      }
+
+      /* a vertex without a normal is written without one, which reads back
+       * as -1 */
+      obj << "f";
+      for(size_t i = 0; i < vertices.size(); i++) {
+        obj << " " << vertices[i] + 1;
+        if(normals[i] >= 0)
+          obj << "//" << normals[i] + 1;
+      }
+      obj << "\n";
+    }
+
+    virtual void close() {
+      obj.close();
+      mtl.close();
+    }
+
+  private:
+
+    static std::string name(int idx) {
+      std::ostringstream ostr;
+      ostr << "mat" << std::setw(5) << std::setfill('0') << idx;
+      return ostr.str();
+    }
+
+    std::ofstream obj, mtl;
+    int nmaterials;
+    int current;
+};
+
+/**
+ * Writes a binary mesh file.
+ */
+class MeshSink : public Sink {
+  public:
+
+    MeshSink(const fs::path& path) : writer(path.string()) { }
+
+    virtual void material(const ray::Material& mat) { writer.material(mat); }
+    virtual void vertex  (const ray::Vector& v)     { writer.vertex(v);     }
+    virtual void normal  (const ray::Vector& n)     { writer.normal(n);     }
+    virtual void polygon (const std::vector<int32_t>& vertices,
+                          const std::vector<int32_t>& normals,
+                          uint16_t material)
+    { writer.polygon(vertices, normals, material); }
+    virtual void close() { writer.close(); }
+
+  private:
+
+    ray::mesh::MeshWriter writer;
+};
+
+/**
+ * Opens the Sink for a file based on the suffix of its name.
+ *
+ * @param path  the file to write
+ * @return      the Sink, null if the suffix is unknown
+ */
+std::unique_ptr<Sink> Sink::open(const fs::path& path) {
+  if(path.extension() == ray::mesh::MeshLoader::suffix)
+    return std::unique_ptr<Sink>(new MeshSink(path));
+  if(path.extension() == ".obj")
+    return std::unique_ptr<Sink>(new ObjSink(path));
+  return std::unique_ptr<Sink>();
+}
+
+/**
+ * One piece of generated geometry. A piece is written in several passes, one
+ * for each part of the file, so that nothing has to be held in memory no
+ * matter how many triangles it has.
+ */
+class Part {
+  public:
+
+    Part(uint16_t material) : material(material) { }
+    virtual ~Part() { }
+
+    virtual uint64_t nvertices() const = 0;
+    virtual uint64_t  nnormals() const = 0;
+
+    virtual void vertices(Sink& sink) const = 0;
+    virtual void  normals(Sink& sink) const = 0;
+
+    /**
+     * Writes the polygons of the Part.
+     *
+     * @param sink   where the polygons go
+     * @param vbase  the index of the first vertex of the Part
+     * @param nbase  the index of the first normal of the Part
+     */
+    virtual void polygons(Sink& sink, int32_t vbase, int32_t nbase) const = 0;
+
+  protected:
+
+    static void triangle(Sink& sink, uint16_t material,
+        int32_t a, int32_t b, int32_t c, int32_t na, int32_t nb, int32_t nc)
+    {
+      sink.polygon({ a, b, c }, { na, nb, nc }, material);
+    }
+
+    uint16_t material;
+};
+
+/**
+ * A tessellated sphere made of rings of vertices between the two poles. The
+ * normal of each vertex points away from the center so the sphere is smooth.
+ */
+class Sphere : public Part {
+  public:
+
+    /**
+     * @param center     the center of the sphere
+     * @param radius     the radius of the sphere
+     * @param triangles  about how many triangles the sphere should have
+     * @param material   the index of the Material of the sphere
+     */
+    Sphere(const ray::Vector& center, double radius, uint64_t triangles, uint16_t material) :
+        Part(material), center(center), radius(radius),
+        rings(std::max<uint64_t>(2, uint64_t(std::sqrt(triangles / 4.0) + 0.5))),
+        segments(2 * rings) { }
+
+    virtual uint64_t nvertices() const { return 2 + (rings - 1) * segments; }
+    virtual uint64_t  nnormals() const { return nvertices(); }
+
+    virtual void vertices(Sink& sink) const {
+      each([&](const ray::Vector& n) { sink.vertex(center + n * radius); });
+    }
+
+    virtual void normals(Sink& sink) const {
+      each([&](const ray::Vector& n) { sink.normal(n); });
+    }
+
+    virtual void polygons(Sink& sink, int32_t vbase, int32_t nbase) const {
+      auto ring = [&](uint64_t r, uint64_t s) -> int32_t {
+        return 1 + (r - 1) * segments + s % segments;
+      };
+      auto tri = [&](int32_t a, int32_t b, int32_t c) {
+        triangle(sink, material, vbase + a, vbase + b, vbase + c, nbase + a, nbase + b, nbase + c);
+      };
+
+      int32_t bottom = nvertices() - 1;
+
+      for(uint64_t s = 0; s < segments; s++)
+        tri(0, ring(1, s + 1), ring(1, s));
+
+      for(uint64_t r = 1; r < rings - 1; r++) {
+        for(uint64_t s = 0; s < segments; s++) {
+          tri(ring(r, s), ring(r, s + 1), ring(r + 1, s + 1));
+          tri(ring(r, s), ring(r + 1, s + 1), ring(r + 1, s));
+        }
+      }
+
+      for(uint64_t s = 0; s < segments; s++)
+        tri(bottom, ring(rings - 1, s), ring(rings - 1, s + 1));
+    }
+
+  private:
+
+    /** calls op with the direction of every vertex from the center */
+    template<typename Op>
+    void each(Op op) const {
+      op(ray::Vector(0, 1, 0));
+      for(uint64_t r = 1; r < rings; r++) {
+        double theta = M_PI * r / rings;
+        for(uint64_t s = 0; s < segments; s++) {
+          double phi = 2.0 * M_PI * s / segments;
+          op(ray::Vector(
+              std::sin(theta) * std::cos(phi),
+              std::cos(theta),
+              std::sin(theta) * std::sin(phi)));
+        }
+      }
+      op(ray::Vector(0, -1, 0));
+    }
+
+    ray::Vector center;
+    double      radius;
+    uint64_t    rings, segments;
+};
+
+/**
+ * An axis aligned box. The faces can point in or out, and any of the faces
+ * can be left off so that the inside of the box can be seen.
+ */
+class Cuboid : public Part {
+  public:
+
+    /**
+     * @param lo        the minimum corner of the box
+     * @param hi        the maximum corner of the box
+     * @param inward    if the faces should point into the box
+     * @param open      the faces to leave off, bit 2 * axis + (1 for max side)
+     * @param material  the index of the Material of the box
+     */
+    Cuboid(const ray::Vector& lo, const ray::Vector& hi, bool inward, int open, uint16_t material) :
+        Part(material), lo(lo), hi(hi), inward(inward), open(open) { }
+
+    virtual uint64_t nvertices() const { return 8; }
+    virtual uint64_t  nnormals() const { return 6; }
+
+    virtual void vertices(Sink& sink) const {
+      for(int i = 0; i < 8; i++)
+        sink.vertex(ray::Vector(
+            (i & 1 ? hi : lo).x(),
+            (i & 2 ? hi : lo).y(),
+            (i & 4 ? hi : lo).z()));
+    }
+
+    virtual void normals(Sink& sink) const {
+      double sign = inward ? -1.0 : 1.0;
+      for(int face = 0; face < 6; face++) {
+        double dir = sign * (face & 1 ? 1.0 : -1.0);
+        sink.normal(ray::Vector(
+            face / 2 == 0 ? dir : 0.0,
+            face / 2 == 1 ? dir : 0.0,
+            face / 2 == 2 ? dir : 0.0));
+      }
+    }
+
+    virtual void polygons(Sink& sink, int32_t vbase, int32_t nbase) const {
+      for(int face = 0; face < 6; face++) {
+        if(open & (1 << face))
+          continue;
+
+        int axis = face / 2;
+        int u    = 1 << ((axis + 1) % 3);
+        int v    = 1 << ((axis + 2) % 3);
+        int base = face & 1 ? 1 << axis : 0;
+        int32_t corners[4] = { base, base + u, base + u + v, base + v };
+
+        /* wind the face so that it agrees with its normal */
+        if(bool(face & 1) == inward)
+          std::swap(corners[1], corners[3]);
+
+        for(int32_t& c : corners)
+          c += vbase;
+
+        triangle(sink, material, corners[0], corners[1], corners[2],
+            nbase + face, nbase + face, nbase + face);
+        triangle(sink, material, corners[0], corners[2], corners[3],
+            nbase + face, nbase + face, nbase + face);
+      }
+    }
+
+  private:
+
+    ray::Vector lo, hi;
+    bool        inward;
+    int         open;
+};
+
+/**
+ * Triangles of random size and orientation scattered through a cube. Every
+ * triangle has a normal of its own.
+ */
+class Soup : public Part {
+  public:
+
+    /**
+     * @param triangles  the number of triangles
+     * @param seed       the seed of the random numbers
+     * @param extent     the length of a side of the cube
+     * @param size       the largest distance from a vertex to its triangle center
+     * @param material   the index of the Material of the triangles
+     */
+    Soup(uint64_t triangles, uint64_t seed, double extent, double size, uint16_t material) :
+        Part(material), triangles(triangles), seed(seed), extent(extent), size(size) { }
+
+    virtual uint64_t nvertices() const { return 3 * triangles; }
+    virtual uint64_t  nnormals() const { return triangles; }
+
+    virtual void vertices(Sink& sink) const {
+      each([&](const ray::Vector& a, const ray::Vector& b, const ray::Vector& c) {
+        sink.vertex(a);
+        sink.vertex(b);
+        sink.vertex(c);
+      });
+    }
+
+    virtual void normals(Sink& sink) const {
+      each([&](const ray::Vector& a, const ray::Vector& b, const ray::Vector& c) {
+        sink.normal(ray::cross(b - a, c - a).normalize());
+      });
+    }
+
+    virtual void polygons(Sink& sink, int32_t vbase, int32_t nbase) const {
+      for(int32_t i = 0; i < int32_t(triangles); i++)
+        triangle(sink, material, vbase + 3 * i, vbase + 3 * i + 1, vbase + 3 * i + 2,
+            nbase + i, nbase + i, nbase + i);
+    }
+
+  private:
+
+    /** calls op with the corners of every triangle, the same ones every time */
+    template<typename Op>
+    void each(Op op) const {
+      Random rand(seed);
+
+      for(uint64_t i = 0; i < triangles; i++) {
+        ray::Vector center(
+            rand.uniform(0, extent), rand.uniform(0, extent), rand.uniform(0, extent));
+        ray::Vector corners[3];
+
+        for(ray::Vector& corner : corners)
+          corner = center + ray::Vector(
+              rand.uniform(-size, size), rand.uniform(-size, size), rand.uniform(-size, size));
+
+        op(corners[0], corners[1], corners[2]);
+      }
+    }
+
+    uint64_t triangles, seed;
+    double   extent, size;
+};
+
+/**
+ * A copy of a loaded mesh moved by a transform, used to flatten instances.
+ */
+class Copy : public Part {
+  public:
+
+    /**
+     * @param mesh       the loaded mesh
+     * @param transform  the transform of the copy
+     * @param material   the index of the first Material of the mesh
+     */
+    Copy(ray::ObjectStream::ptr mesh, const ray::Matrix<double>& transform, uint16_t material) :
+        Part(material), mesh(mesh), transform(transform),
+        nverts(mesh->vertices().size()), nnorms(mesh->normals().size()) { }
+
+    virtual uint64_t nvertices() const { return nverts; }
+    virtual uint64_t  nnormals() const { return nnorms; }
+
+    virtual void vertices(Sink& sink) const {
+      for(const ray::Vector& v : mesh->vertices())
+        sink.vertex(apply(v, 1.0));
+    }
+
+    virtual void normals(Sink& sink) const {
+      for(const ray::Vector& n : mesh->normals())
+        sink.normal(apply(n, 0.0).normalize());
+    }
+
+    virtual void polygons(Sink& sink, int32_t vbase, int32_t nbase) const {
+      for(const ray::ObjectStream::Polygon& p : mesh->polygons()) {
+        std::vector<int32_t> verts, norms;
+        for(size_t i = 0; i < p.vertices.size(); i++) {
+          verts.push_back(vbase + p.vertices[i]);
+          norms.push_back(p.normals[i] < 0 ? -1 : nbase + p.normals[i]);
+        }
+        sink.polygon(verts, norms, material + p.matidx);
+      }
+    }
+
+  private:
+
+    /** applies the transform, w is 0 for directions and 1 for points */
+    ray::Vector apply(const ray::Vector& v, double w) const {
+      double out[3];
+      for(int r = 0; r < 3; r++)
+        out[r] = transform[r][0] * v.x() + transform[r][1] * v.y() +
+                 transform[r][2] * v.z() + transform[r][3] * w;
+      return ray::Vector(out[0], out[1], out[2]);
+    }
+
+    ray::ObjectStream::ptr mesh;
+    ray::Matrix<double>    transform;
+    uint64_t               nverts, nnorms;
+};
+
+/**
+ * Everything that makes up a generated scene. The geometry is in the Parts,
+ * the instances place meshes that already exist on disk.
+ */
+struct Scene {
+  struct Placed {
+    std::string path;
+    ray::Vector offset;
+  };
+
+  std::vector<ray::Material>         materials;
+  std::vector<std::shared_ptr<Part>> parts;
+  std::vector<Placed>                placed;
+  std::vector<ray::Light>            lights;
+
+  uint16_t material(double r, double g, double b, double ks, double alpha) {
+    ray::Matrix<double> diffuse = ray::eye<double>(4);
+    diffuse[0][0] = r;
+    diffuse[1][1] = g;
+    diffuse[2][2] = b;
+
+    materials.push_back(ray::Material(ks, 0, alpha, diffuse));
+    return materials.size() - 1;
+  }
+};
+
+/**
+ * Writes the geometry of a Scene.
+ *
+ * @param scene  the Scene
+ * @param sink   where the geometry goes
+ */
+void writeGeometry(const Scene& scene, Sink& sink) {
+  uint64_t nverts = 0, nnorms = 0;
+
+  for(const ray::Material& mat : scene.materials)
+    sink.material(mat);
+  for(auto& part : scene.parts) {
+    part->vertices(sink);
+    nverts += part->nvertices();
+  }
+  for(auto& part : scene.parts) {
+    part->normals(sink);
+    nnorms += part->nnormals();
+  }
+
+  if(nverts > uint64_t(INT32_MAX) || nnorms > uint64_t(INT32_MAX))
+    throw std::exception();
+
+  int32_t vbase = 0, nbase = 0;
+  for(auto& part : scene.parts) {
+    part->polygons(sink, vbase, nbase);
+    vbase += part->nvertices();
+    nbase += part->nnormals();
+  }
+
+  sink.close();
+}
+
+/**
+ * Writes a scene file. The generated geometry is written beside the scene
+ * file and placed once, followed by the meshes that are placed as instances
+ * and the Lights.
+ *
+ * @param scene   the Scene
+ * @param path    the scene file
+ * @param format  the suffix of the geometry file
+ */
+void writeScene(const Scene& scene, const fs::path& path, const std::string& format) {
+  std::ofstream ostr(path.string().c_str());
+  fs::path directory = fs::absolute(path).parent_path();
+
+  if(!ostr)
+    throw std::exception();
+
+  ostr << "# generated by SceneGen" << std::endl;
+
+  if(!scene.parts.empty()) {
+    fs::path geometry = fs::path(path).replace_extension(format);
+    std::unique_ptr<Sink> sink = Sink::open(geometry);
+    if(!sink)
+      throw std::exception();
+    writeGeometry(scene, *sink);
+
+    ostr << "mesh world " << geometry.filename().string() << std::endl;
+    ostr << "instance world" << std::endl;
+  }
+
+  std::map<std::string, int> names;
+  for(const Scene::Placed& p : scene.placed) {
+    if(!names.count(p.path)) {
+      names.insert(std::make_pair(p.path, int(names.size())));
+      ostr << "mesh m" << names[p.path] << " "
+           << fs::relative(fs::absolute(p.path), directory).string() << std::endl;
+    }
+
+    ostr << "instance m" << names[p.path] << " translate "
+         << p.offset.x() << " " << p.offset.y() << " " << p.offset.z() << std::endl;
+  }
+
+  for(const ray::Light& light : scene.lights) {
+    ostr << "light "
+         << light.local().x() << " " << light.local().y() << " " << light.local().z() << " "
+         << light.illum().x() << " " << light.illum().y() << " " << light.illum().z()
+         << std::endl;
+  }
+}
+
+/**
+ * A grid of copies of a mesh. The copies are placed as instances of the mesh
+ * unless they are flattened into one mesh.
+ */
+void teapots(Scene& scene, const std::string& path, uint64_t count, bool flatten) {
+  ray::ObjectStream::ptr mesh = ray::ObjectStream::loadObject(path);
+  if(!mesh)
+    throw std::exception();
+
+  ray::Vector lo(HUGE_VAL), hi(-HUGE_VAL);
+  for(const ray::Vector& v : mesh->vertices()) {
+    lo = ray::min(lo, v);
+    hi = ray::max(hi, v);
+  }
+
+  uint16_t base = scene.materials.size();
+  if(flatten) {
+    std::vector<ray::Material> mats = mesh->materials();
+    scene.materials.insert(scene.materials.end(), mats.begin(), mats.end());
+  }
+
+  uint64_t    side    = uint64_t(std::ceil(std::sqrt(double(count))));
+  ray::Vector spacing = (hi - lo) * 1.25;
+
+  for(uint64_t i = 0; i < count; i++) {
+    ray::Vector offset((i % side) * spacing.x(), (i / side) * spacing.y(), 0.0);
+
+    if(flatten) {
+      ray::Matrix<double> transform = ray::eye<double>(4);
+      transform[0][3] = offset.x();
+      transform[1][3] = offset.y();
+      transform[2][3] = offset.z();
+      scene.parts.push_back(std::make_shared<Copy>(mesh, transform, base));
+    } else {
+      scene.placed.push_back(Scene::Placed{ path, offset });
+    }
+  }
+}
+
+/**
+ * A sphere on a floor lit by a grid of Lights whose total illumination does
+ * not depend on how many there are.
+ */
+void lights(Scene& scene, uint64_t count, uint64_t triangles) {
+  uint16_t floor = scene.material(0.3, 0.3, 0.3, 0.0, 1.0);
+  uint16_t ball  = scene.material(0.5, 0.1, 0.1, 0.4, 32.0);
+
+  scene.parts.push_back(std::make_shared<Cuboid>(
+      ray::Vector(-4, -0.25, -4), ray::Vector(4, 0, 4), false, 0, floor));
+  scene.parts.push_back(std::make_shared<Sphere>(
+      ray::Vector(0, 1.5, 0), 1.5, triangles, ball));
+
+  uint64_t side  = uint64_t(std::ceil(std::sqrt(double(count))));
+  double   power = std::min(255.0, 1020.0 / count);
+
+  for(uint64_t i = 0; i < count; i++) {
+    double x = side > 1 ? -4.0 + 8.0 * (i % side) / (side - 1) : 0.0;
+    double z = side > 1 ? -4.0 + 8.0 * (i / side) / (side - 1) : 0.0;
+    scene.lights.push_back(ray::Light(ray::Vector(x, 5, z), ray::Vector(power)));
+  }
+}
+
+/**
+ * A box of mirrors, open toward the camera, with a sphere inside of it. Rays
+ * bounce between the walls until they run out of depth.
+ */
+void mirrors(Scene& scene, double reflect, uint64_t triangles) {
+  uint16_t walls = scene.material(0.05, 0.05, 0.05, reflect, 200.0);
+  uint16_t ball  = scene.material(0.1, 0.2, 0.5, 0.2, 32.0);
+
+  scene.parts.push_back(std::make_shared<Cuboid>(
+      ray::Vector(-3, 0, -3), ray::Vector(3, 6, 3), true, 1 << 5, walls));
+  scene.parts.push_back(std::make_shared<Sphere>(
+      ray::Vector(0, 1.5, 0), 1.5, triangles, ball));
+
+  scene.lights.push_back(ray::Light(ray::Vector(0, 5.5, 0), ray::Vector(255)));
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("count", po::value<uint64_t>(),
+          "the number of teapots (default 16) or lights (default 64)")
+      ("triangles", po::value<uint64_t>(),
+          "about how many triangles in a sphere (default 100000, 2000 in other scenes) "
+          "or in a soup (default 100000)")
+      ("seed", po::value<uint64_t>()->default_value(1), "the seed of a soup")
+      ("reflect", po::value<double>()->default_value(0.95), "the reflectance of the mirrors")
+      ("mesh", po::value<std::string>()->default_value("models/teapot/teapot.obj"),
+          "the mesh placed by teapots")
+      ("flatten", "copy every teapot into one mesh instead of using instances")
+      ("format", po::value<std::string>()->default_value("rmesh"),
+          "the format of the geometry written beside a .scene file, obj or rmesh");
+
+  po::options_description hidden;
+  hidden.add_options()
+      ("kind", po::value<std::string>())
+      ("output", po::value<std::string>());
+
+  po::options_description all;
+  all.add(visible).add(hidden);
+
+  po::positional_options_description pos;
+  pos.add("kind", 1).add("output", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(all).positional(pos).run(), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  if(vm.count("help") || !vm.count("kind") || !vm.count("output")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string kind   = vm["kind"].as<std::string>();
+  fs::path    output = vm["output"].as<std::string>();
+  std::string format = "." + vm["format"].as<std::string>();
+  bool        scene  = output.extension() == ".scene";
+
+  auto count = [&](uint64_t def) {
+    return vm.count("count") ? vm["count"].as<uint64_t>() : def;
+  };
+  auto triangles = [&](uint64_t def) {
+    return vm.count("triangles") ? vm["triangles"].as<uint64_t>() : def;
+  };
+
+  if(format != ".obj" && format != ray::mesh::MeshLoader::suffix) {
+    std::cout << "Unknown format: " << format << std::endl;
+    return -1;
+  }
+
+  Scene gen;
+
+  if(kind == "teapots") {
+    teapots(gen, vm["mesh"].as<std::string>(), count(16), vm.count("flatten") || !scene);
+  } else if(kind == "sphere") {
+    gen.parts.push_back(std::make_shared<Sphere>(ray::Vector(0.0), 3.0,
+        triangles(100000), gen.material(0.3, 0.3, 0.3, 0.3, 32.0)));
+  } else if(kind == "soup") {
+    gen.parts.push_back(std::make_shared<Soup>(triangles(100000), vm["seed"].as<uint64_t>(),
+        10.0, 0.25, gen.material(0.2, 0.4, 0.1, 0.2, 16.0)));
+  } else if(kind == "lights") {
+    lights(gen, count(64), triangles(2000));
+  } else if(kind == "mirrors") {
+    mirrors(gen, vm["reflect"].as<double>(), triangles(2000));
+  } else {
+    std::cout << "Unknown scene: " << kind << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  if(!scene && !gen.lights.empty())
+    std::cout << "Warning: only a .scene file can hold the lights of " << kind << std::endl;
+
+  if(scene) {
+    writeScene(gen, output, format);
+  } else {
+    std::unique_ptr<Sink> sink = Sink::open(output);
+    if(!sink) {
+      std::cout << "Unknown output type: " << output.string() << std::endl;
+      return -1;
+    }
+    writeGeometry(gen, *sink);
+  }
+
+  return 0;
+}
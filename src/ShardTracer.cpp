@@ -0,0 +1,728 @@
+/*
+ * ShardTracer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ImageFile.hpp>
+#include <LightTree.hpp>
+#include <MeshFile.hpp>
+#include <ObjectStream.hpp>
+#include <Model.hpp>
+#include <RegionTracer.hpp>
+#include <Socket.hpp>
+#include <Timeline.hpp>
+#include <WorkerPool.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+namespace sc = std::chrono;
+
+/* system includes */
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* boost includes */
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+using ray::net::connectTo;
+using ray::net::recvAll;
+using ray::net::sendAll;
+using ray::timeline::ms;
+
+const char* usage =
+    "Usage: ShardTracer split [options] <model file> <manifest>\n"
+    "       ShardTracer render [options] <manifest> <output file>\n"
+    "       ShardTracer shard [options] <manifest> <index>";
+
+/**
+ * The list of shards that a scene was split into. Each line is one of:
+ *
+ *   shard <file>                    a mesh holding one part of the scene,
+ *                                   relative to the manifest
+ *   light <x> <y> <z> <r> <g> <b>   a Light of the scene
+ */
+struct Manifest {
+  std::vector<fs::path>   shards;
+  std::vector<ray::Light> lights;
+
+  bool read(const fs::path& fileName) {
+    std::ifstream istr(fileName.string().c_str());
+    std::string buffer;
+
+    if(!istr)
+      return false;
+
+    while(std::getline(istr, buffer)) {
+      std::istringstream line(buffer);
+      std::string word;
+
+      if(!(line >> word) || word[0] == '#')
+        continue;
+
+      if(word == "shard") {
+        std::string file;
+        if(!(line >> file))
+          return false;
+        shards.push_back(fileName.parent_path() / file);
+      } else if(word == "light") {
+        double l[6];
+        if(!(line >> l[0] >> l[1] >> l[2] >> l[3] >> l[4] >> l[5]))
+          return false;
+        lights.push_back(ray::Light(ray::Vector(l[0], l[1], l[2]), ray::Vector(l[3], l[4], l[5])));
+      } else {
+        return false;
+      }
+    }
+
+    return !shards.empty();
+  }
+};
+
+/* ************************************************************************** */
+/* *** split **************************************************************** */
+/* ************************************************************************** */
+
+/**
+ * Divides the polygons between the shards. The centers of the polygons are
+ * split at the median along the longest side of their bounds, with each side
+ * getting a share of the polygons that matches its share of the shards, until
+ * every shard has its own region of the scene.
+ *
+ * @param begin    the first polygon of the region
+ * @param end      one past the last polygon of the region
+ * @param centers  the center of every polygon
+ * @param first    the first shard for the region
+ * @param count    the number of shards for the region
+ * @param owner    return for the shard of every polygon
+ */
+static void partition(
+    std::vector<uint32_t>::iterator begin,
+    std::vector<uint32_t>::iterator end,
+    const std::vector<ray::Vector>& centers,
+    uint32_t first,
+    uint32_t count,
+    std::vector<uint32_t>& owner)
+{
+  if(count == 1 || begin == end) {
+    for(auto iter = begin; iter != end; iter++)
+      owner[*iter] = first;
+    return;
+  }
+
+  ray::Vector lo = centers[*begin], hi = centers[*begin];
+  for(auto iter = begin; iter != end; iter++) {
+    lo = ray::min(lo, centers[*iter]);
+    hi = ray::max(hi, centers[*iter]);
+  }
+
+  ray::Vector len  = hi - lo;
+  int         axis = len.x() > len.y() ? (len.x() > len.z() ? 0 : 2) : (len.y() > len.z() ? 1 : 2);
+  uint32_t    left = count / 2;
+  auto        middle = begin + uint64_t(end - begin) * left / count;
+
+  std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+    return centers[a][axis] < centers[b][axis];
+  });
+
+  partition(begin, middle, centers, first, left, owner);
+  partition(middle, end, centers, first + left, count - left, owner);
+}
+
+/**
+ * Splits a scene into shards and writes a binary mesh for each of them and
+ * the manifest that lists them. Every shard keeps all of the Materials so
+ * that the Materials of the scene keep their indices.
+ *
+ * A binary mesh is read a polygon at a time, once to find the center of
+ * every polygon and twice more for each shard to write it, so only the
+ * centers and the shard of every polygon are kept in memory. Any other kind
+ * of scene is loaded whole first.
+ *
+ * @param input     the scene to split
+ * @param manifest  the manifest to write, the meshes are written beside it
+ * @param nshards   the number of shards
+ * @return          the exit code
+ */
+static int split(const fs::path& input, const fs::path& manifest, uint32_t nshards) {
+  std::unique_ptr<ray::mesh::Source> source;
+  try {
+    source = ray::mesh::Source::open(input.string());
+  } catch(std::exception& error) { }
+
+  if(!source) {
+    std::cout << "Could not load " << input.string() << std::endl;
+    return -1;
+  }
+
+  std::ofstream ostr(manifest.string().c_str());
+  if(!ostr) {
+    std::cout << "Could not write " << manifest.string() << std::endl;
+    return -1;
+  }
+
+  try {
+    const ray::ObjectStream::Polygon* p;
+
+    std::vector<ray::Vector> centers(source->npolygons());
+    std::vector<uint32_t>    order(source->npolygons());
+    std::vector<uint32_t>    owner(source->npolygons());
+
+    source->rewind();
+    for(uint32_t i = 0; (p = source->next()); i++) {
+      ray::Vector sum(0, 0, 0);
+
+      for(int v : p->vertices)
+        sum = sum + source->vertex(v);
+
+      centers[i] = p->vertices.empty() ? sum : sum / double(p->vertices.size());
+      order[i]   = i;
+    }
+
+    partition(order.begin(), order.end(), centers, 0, nshards, owner);
+
+    ostr << std::setprecision(17);
+    ostr << "# split from " << input.filename().string() << " into " << nshards << " shard(s)" << std::endl;
+
+    std::vector<int32_t> vmap(source->nvertices(), -1);
+    std::vector<int32_t> nmap(source->nnormals(),  -1);
+
+    for(uint32_t s = 0; s < nshards; s++) {
+      std::string file = manifest.stem().string() + "." + std::to_string(s) + ray::mesh::MeshLoader::suffix;
+      std::vector<int32_t> vused, nused;
+      uint64_t ntriangles = 0;
+
+      /* number the vertices and normals that the shard uses in the order they are used */
+      source->rewind();
+      for(uint32_t i = 0; (p = source->next()); i++) {
+        if(owner[i] != s)
+          continue;
+
+        for(int v : p->vertices) {
+          if(vmap.at(v) < 0) {
+            vmap[v] = vused.size();
+            vused.push_back(v);
+          }
+        }
+        for(int n : p->normals) {
+          if(n >= 0 && nmap.at(n) < 0) {
+            nmap[n] = nused.size();
+            nused.push_back(n);
+          }
+        }
+        if(p->vertices.size() > 2)
+          ntriangles += p->vertices.size() - 2;
+      }
+
+      ray::mesh::MeshWriter writer((manifest.parent_path() / file).string());
+
+      for(const ray::Material& mat : source->materials())
+        writer.material(mat);
+      for(int32_t v : vused)
+        writer.vertex(source->vertex(v));
+      for(int32_t n : nused)
+        writer.normal(source->normal(n));
+
+      source->rewind();
+      for(uint32_t i = 0; (p = source->next()); i++) {
+        if(owner[i] != s)
+          continue;
+
+        std::vector<int32_t> verts, norms;
+        for(int v : p->vertices)
+          verts.push_back(vmap[v]);
+        for(int n : p->normals)
+          norms.push_back(n < 0 ? -1 : nmap[n]);
+        writer.polygon(verts, norms, p->matidx);
+      }
+
+      writer.close();
+
+      for(int32_t v : vused)
+        vmap[v] = -1;
+      for(int32_t n : nused)
+        nmap[n] = -1;
+
+      ostr << "shard " << file << std::endl;
+      std::cout << "Shard " << s << ": " << ntriangles << " triangles, "
+                << vused.size() << " vertices -> " << file << std::endl;
+    }
+  } catch(std::exception& error) {
+    std::cout << "Could not split " << input.string() << std::endl;
+    return -1;
+  }
+
+  for(const ray::Light& light : source->lights()) {
+    ray::Vector l = light.local(), i = light.illum();
+    ostr << "light " << l.x() << " " << l.y() << " " << l.z() << " "
+         << i.x() << " " << i.y() << " " << i.z() << std::endl;
+  }
+
+  return 0;
+}
+
+/* ************************************************************************** */
+/* *** shard **************************************************************** */
+/* ************************************************************************** */
+
+/**
+ * Loads one shard of a scene and answers the Rays the coordinator sends it
+ * until the coordinator closes the connection. When it connects the shard
+ * tells the coordinator about itself:
+ *
+ *   shard <index> <triangles>
+ *   bounds <min x> <min y> <min z> <length x> <length y> <length z>
+ *   material <ks> <kt> <alpha> <rows> <cols> <diffuse ...>     for each Material
+ *   ready
+ *
+ * After that every batch from the coordinator is a count followed by that
+ * many RayQueries, and is answered with the same number of RayAnswers.
+ *
+ * @param manifest  the shards of the scene
+ * @param index     the shard to load
+ * @param address   the <host>:<port> of the coordinator
+ * @param nthreads  the number of threads that answer a batch
+ * @return          the exit code
+ */
+static int shard(const Manifest& manifest, uint32_t index, const std::string& address, uint8_t nthreads) {
+  if(index >= manifest.shards.size()) {
+    std::cout << "There is no shard " << index << std::endl;
+    return -1;
+  }
+
+  ray::Model  model;
+  ray::Camera camera;
+
+  try {
+    auto stream = ray::ObjectStream::loadObject(manifest.shards[index].string());
+    if(!stream)
+      throw std::exception();
+    ray::Model::fromObjectStream(stream, model, camera);
+  } catch(std::exception& error) {
+    std::cout << "Could not load " << manifest.shards[index].string() << std::endl;
+    return -1;
+  }
+
+  /* the Surfaces that Rays can leave from, by id */
+  std::map<int32_t, std::pair<const ray::Surface*, const ray::Surface*> > sources;
+  uint64_t ntriangles = 0;
+
+  for(const ray::Instance* inst : model.getInstances()) {
+    for(const ray::Mesh& mesh : model.getMeshes()) {
+      if(mesh.root != inst->root())
+        continue;
+      for(const ray::Triangle* tri : mesh.triangles)
+        sources[tri->id] = std::make_pair(tri, inst);
+      ntriangles += mesh.triangles.size();
+    }
+  }
+
+  int fd = connectTo(address);
+  if(fd < 0) {
+    std::cout << "Could not connect to " << address << std::endl;
+    return -1;
+  }
+
+  std::ostringstream hello;
+  ray::Box bounds = model.getBounds();
+
+  hello << std::setprecision(17);
+  hello << "shard " << index << " " << ntriangles << "\n";
+  hello << "bounds " << bounds.min().x() << " " << bounds.min().y() << " " << bounds.min().z() << " "
+        << bounds.len().x() << " " << bounds.len().y() << " " << bounds.len().z() << "\n";
+  for(const ray::Material& mat : model.getMaterials()) {
+    const ray::Matrix<double>& d = mat.diffuse();
+    hello << "material " << mat.ks() << " " << mat.kt() << " " << mat.alpha() << " "
+          << d.rows() << " " << d.cols();
+    for(uint32_t r = 0; r < d.rows(); r++)
+      for(uint32_t c = 0; c < d.cols(); c++)
+        hello << " " << d[r][c];
+    hello << "\n";
+  }
+  hello << "ready\n";
+
+  std::string text = hello.str();
+  if(!sendAll(fd, text.data(), text.size())) {
+    close(fd);
+    return -1;
+  }
+
+  ray::WorkerPool pool(nthreads);
+  std::vector<ray::RayQuery>  queries;
+  std::vector<ray::RayAnswer> answers;
+  uint32_t count;
+
+  auto answer = [&](const ray::RayQuery& q, ray::RayAnswer& a) {
+    auto src = q.source >= 0 ? sources.find(q.source) : sources.end();
+    ray::Ray r(ray::Vector(q.L[0], q.L[1], q.L[2]), ray::Vector(q.U[0], q.U[1], q.U[2]),
+        src != sources.end() ? src->second.first  : nullptr,
+        src != sources.end() ? src->second.second : nullptr);
+    ray::Intersection inter;
+
+    std::memset(&a, 0, sizeof(a));
+    a.surface = -1;
+
+    if(!model.intersect(r, inter))
+      return;
+    if(q.shadow && inter.distance() >= q.distance)
+      return;
+
+    a.surface  = inter.source()->id;
+    a.material = inter.source()->material();
+    a.distance = inter.distance();
+    for(int k = 0; k < 3; k++) {
+      a.i[k] = inter.i()[k];
+      a.n[k] = inter.n()[k];
+      a.v[k] = inter.v()[k];
+    }
+  };
+
+  while(recvAll(fd, &count, sizeof(count))) {
+    queries.resize(count);
+    answers.resize(count);
+
+    if(!recvAll(fd, queries.data(), count * sizeof(ray::RayQuery)))
+      break;
+
+    uint8_t parts = pool.size() + 1;
+    pool.run(parts, [&](uint8_t part) {
+      uint32_t begin = uint64_t(count) * part / parts;
+      uint32_t end   = uint64_t(count) * (part + 1) / parts;
+
+      for(uint32_t k = begin; k < end; k++)
+        answer(queries[k], answers[k]);
+    });
+
+    if(!sendAll(fd, answers.data(), count * sizeof(ray::RayAnswer)))
+      break;
+  }
+
+  close(fd);
+  return 0;
+}
+
+/* ************************************************************************** */
+/* *** render *************************************************************** */
+/* ************************************************************************** */
+
+/**
+ * A shard connected to the coordinator. A batch is sent to the shard as a
+ * count followed by that many RayQueries, and the shard answers with the same
+ * number of RayAnswers. Both are sent as they are laid out in memory, so the
+ * coordinator and the shards have to run on machines with the same byte
+ * order.
+ */
+struct Remote : public ray::Region {
+  Remote() : fd(-1), triangles(0), box(), phong(), queries(0), waiting(0) { }
+
+  virtual const ray::Box&                bounds()    const { return box;   }
+  virtual const std::vector<ray::Phong>& materials() const { return phong; }
+
+  virtual bool send(const std::vector<ray::RayQuery>& batch) {
+    waiting  = batch.size();
+    queries += waiting;
+    return sendAll(fd, &waiting, sizeof(waiting)) &&
+           sendAll(fd, batch.data(), waiting * sizeof(ray::RayQuery));
+  }
+
+  virtual bool receive(std::vector<ray::RayAnswer>& answers) {
+    answers.resize(waiting);
+    return recvAll(fd, answers.data(), waiting * sizeof(ray::RayAnswer));
+  }
+
+  int                     fd;
+  uint64_t                triangles;
+  ray::Box                box;
+  std::vector<ray::Phong> phong;
+
+  /** the number of Rays the shard has been asked about */
+  uint64_t                queries;
+
+  /** the size of the batch the shard is working on */
+  uint32_t                waiting;
+};
+
+/**
+ * Reads what a shard says about itself when it connects.
+ *
+ * @param fd      the connection to the shard
+ * @param index   return for the index of the shard
+ * @param remote  return for the shard
+ * @return        false if the shard went away or sent something bad
+ */
+static bool greet(int fd, uint32_t& index, Remote& remote) {
+  std::string buffer, line, word;
+
+  remote.fd      = fd;
+  remote.queries = 0;
+
+  while(ray::net::readLine(fd, buffer, line)) {
+    std::istringstream istr(line);
+    istr >> word;
+
+    if(word == "shard") {
+      if(!(istr >> index >> remote.triangles))
+        return false;
+    } else if(word == "bounds") {
+      double b[6];
+      if(!(istr >> b[0] >> b[1] >> b[2] >> b[3] >> b[4] >> b[5]))
+        return false;
+      remote.box = ray::Box(ray::Vector(b[0], b[1], b[2]), ray::Vector(b[3], b[4], b[5]));
+    } else if(word == "material") {
+      double   ks, kt, alpha;
+      uint32_t rows, cols;
+      if(!(istr >> ks >> kt >> alpha >> rows >> cols))
+        return false;
+
+      ray::Matrix<double> diffuse(rows, cols);
+      for(uint32_t r = 0; r < rows; r++)
+        for(uint32_t c = 0; c < cols; c++)
+          if(!(istr >> diffuse[r][c]))
+            return false;
+
+      remote.phong.push_back(ray::Phong(ray::Material(ks, kt, alpha, diffuse)));
+    } else if(word == "ready") {
+      /* the shard sends nothing more until it is sent Rays */
+      return buffer.empty();
+    } else {
+      return false;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Starts a shard process on this machine.
+ */
+static pid_t spawn(const char* self, const std::string& manifest, uint32_t index, const std::string& port) {
+  pid_t pid = fork();
+
+  if(pid == 0) {
+    execl(self, self, "shard", manifest.c_str(), std::to_string(index).c_str(),
+        "--connect", ("127.0.0.1:" + port).c_str(), (char*)nullptr);
+    _exit(127);
+  }
+
+  return pid;
+}
+
+int main(int argc, char** argv) {
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("shards", po::value<uint32_t>()->default_value(2),
+          "split: the number of shards to split the scene into")
+      ("port", po::value<int>()->default_value(0),
+          "render: the TCP port shards connect to, 0 picks a free one")
+      ("spawn", "render: start a process for every shard on this machine")
+      ("size", po::value<int>()->default_value(1024),
+          "render: the number of rows and columns in the picture")
+      ("orbit", po::value<std::vector<double> >()->multitoken(),
+          "render: turn the camera around the scene by <x> <y> radians")
+      ("band", po::value<int>()->default_value(64),
+          "render: the number of rows whose Rays are followed at once")
+      ("connect", po::value<std::string>(),
+          "shard: the <host>:<port> of the coordinator")
+      ("threads", po::value<int>()->default_value(boost::thread::hardware_concurrency()),
+          "shard: the number of threads that trace each batch");
+
+  po::options_description hidden;
+  hidden.add_options()
+      ("mode",   po::value<std::string>())
+      ("first",  po::value<std::string>())
+      ("second", po::value<std::string>());
+
+  po::options_description all;
+  all.add(visible).add(hidden);
+
+  po::positional_options_description positional;
+  positional.add("mode", 1).add("first", 1).add("second", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).
+        options(all).positional(positional).run(), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string mode = vm.count("mode") ? vm["mode"].as<std::string>() : "";
+
+  if(vm.count("help") || (mode != "split" && mode != "render" && mode != "shard") ||
+      !vm.count("first") || !vm.count("second")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
+  std::string first  = vm["first"].as<std::string>();
+  std::string second = vm["second"].as<std::string>();
+
+  /* split a scene */
+  if(mode == "split")
+    return split(first, second, std::max(vm["shards"].as<uint32_t>(), uint32_t(1)));
+
+  Manifest manifest;
+  if(!manifest.read(first)) {
+    std::cout << "Could not read the manifest " << first << std::endl;
+    return -1;
+  }
+
+  /* run a shard */
+  if(mode == "shard") {
+    if(!vm.count("connect")) {
+      std::cout << "A shard needs --connect <host>:<port>" << std::endl;
+      return -1;
+    }
+
+    size_t        used  = 0;
+    unsigned long index = 0;
+    try {
+      index = std::stoul(second, &used);
+    } catch(std::exception& error) {
+      used = 0;
+    }
+
+    if(used == 0 || used != second.size() || second[0] == '-' || index > std::numeric_limits<uint32_t>::max()) {
+      std::cout << usage << std::endl << visible << std::endl;
+      return -1;
+    }
+
+    return shard(manifest, uint32_t(index), vm["connect"].as<std::string>(),
+        uint8_t(std::max(vm["threads"].as<int>() - 1, 0)));
+  }
+
+  /* render a picture */
+  int size = std::max(vm["size"].as<int>(), 1);
+  double orbit[2] = { 0.0, 0.0 };
+
+  if(vm.count("orbit")) {
+    std::vector<double> angles = vm["orbit"].as<std::vector<double> >();
+    if(angles.size() != 2) {
+      std::cout << "--orbit takes two angles" << std::endl;
+      return -1;
+    }
+    orbit[0] = angles[0];
+    orbit[1] = angles[1];
+  }
+
+  std::string port;
+  int listener = ray::net::listenOn(vm["port"].as<int>(), port);
+  if(listener < 0) {
+    std::cout << "Could not listen: " << std::strerror(errno) << std::endl;
+    return -1;
+  }
+
+  std::cout << "Listening on port " << port << ", waiting for "
+            << manifest.shards.size() << " shard(s)" << std::endl;
+
+  std::vector<pid_t> children;
+  if(vm.count("spawn"))
+    for(uint32_t i = 0; i < manifest.shards.size(); i++)
+      children.push_back(spawn(argv[0], fs::absolute(first).string(), i, port));
+
+  /* wait for every shard to load */
+  auto begin = sc::steady_clock::now();
+  std::vector<Remote> shards(manifest.shards.size());
+  std::vector<bool>   connected(shards.size(), false);
+
+  for(uint32_t remaining = shards.size(); remaining;) {
+    int fd = ::accept(listener, nullptr, nullptr);
+    if(fd < 0)
+      continue;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    uint32_t index;
+    Remote   remote;
+    if(!greet(fd, index, remote) || index >= shards.size() || connected[index]) {
+      std::cout << "A shard sent a bad greeting" << std::endl;
+      close(fd);
+      continue;
+    }
+
+    shards[index]    = remote;
+    connected[index] = true;
+    remaining--;
+  }
+
+  close(listener);
+  auto loaded = sc::steady_clock::now();
+
+  /* the camera is made from the bounds of the whole scene the same way Tracer makes it */
+  ray::Box bounds;
+  bool     any = false;
+  for(const Remote& remote : shards) {
+    if(remote.triangles) {
+      bounds = any ? ray::Box(bounds, remote.box) : remote.box;
+      any    = true;
+    }
+  }
+
+  ray::Camera camera = ray::Camera::fromBounds(bounds);
+  ray::Vector center = bounds.min() + bounds.len() / 2.0;
+
+  std::vector<ray::Light> lights = manifest.lights;
+  lights.push_back(ray::Light(camera._fp(), ray::Vector(255)));
+  lights.push_back(ray::Light(camera._fp(), ray::Vector(255)));
+
+  camera.rotate(orbit[0], ray::Camera::x_axis, center);
+  camera.rotate(orbit[1], ray::Camera::y_axis, center);
+
+  std::vector<ray::Region*> regions;
+  for(Remote& remote : shards)
+    regions.push_back(&remote);
+
+  ray::RegionTracer coordinator(regions, lights);
+  bool good = coordinator.render(camera, size, size, std::max(vm["band"].as<int>(), 1));
+  auto end  = sc::steady_clock::now();
+
+  for(const Remote& remote : shards)
+    close(remote.fd);
+  for(pid_t child : children)
+    waitpid(child, nullptr, 0);
+
+  if(!good) {
+    std::cout << "Lost a shard, the picture could not be finished" << std::endl;
+    return -1;
+  }
+
+  if(!ray::writePPM(second, coordinator.picture())) {
+    std::cout << "Could not write " << second << std::endl;
+    return -1;
+  }
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Loaded in " << ms(begin, loaded) << " ms, rendered in " << ms(loaded, end)
+            << " ms with " << coordinator.waves() << " batches" << std::endl;
+  for(uint32_t k = 0; k < shards.size(); k++)
+    std::cout << "Shard " << k << ": " << shards[k].triangles << " triangles, "
+              << shards[k].queries << " rays" << std::endl;
+
+  return 0;
+}
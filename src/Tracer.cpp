@@ -6,23 +6,39 @@
  */
 
 /* local includes */
+#include <CameraPath.hpp>
+#include <CostMap.hpp>
+#include <ImageFile.hpp>
+#include <MeshOptimizer.hpp>
 #include <ObjectStream.hpp>
 #include <Model.hpp>
+#include <Timeline.hpp>
 #include <Vector.hpp>
 #include <Debug.hpp>
 
 /* std includes */
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+namespace sc = std::chrono;
 
 /* boost includes */
 #include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/thread/thread.hpp>
 namespace fs = boost::filesystem;
+namespace po = boost::program_options;
 
 /* other */
 #include <gtkmm.h>
 #include <gdk/gdk.h>
 
-const char* usage = "Usage: Tracer <model file> <output file>";
+const char* usage = "Usage: Tracer [options] <model file> <output file>";
 
 Glib::RefPtr<Gdk::Pixbuf> copyOut(const ray::Matrix<ray::Pixel> img) {
   Glib::RefPtr<Gdk::Pixbuf> ret = Gdk::Pixbuf::create(
@@ -42,18 +58,341 @@ Glib::RefPtr<Gdk::Pixbuf> copyOut(const ray::Matrix<ray::Pixel> img) {
   return ret;
 }
 
+/**
+ * Saves a picture in the format given by the extension of its file name.
+ */
+void save(const ray::Matrix<ray::Pixel>& img, const fs::path& p_out) {
+  try {
+    copyOut(img)->save(
+      p_out.string(), p_out.extension().string().substr(1));
+  } catch(Gdk::PixbufError& error) {
+    std::cout << error.what() << std::endl;
+  }
+}
+
+/**
+ * The name of a frame of an animation, the number of the frame is put
+ * before the extension of the output: out.png becomes out0000.png.
+ */
+fs::path frameName(const fs::path& p_out, size_t frame) {
+  std::ostringstream ostr;
+  ostr << p_out.stem().string() << std::setw(4) << std::setfill('0') << frame
+       << p_out.extension().string();
+  return p_out.parent_path() / ostr.str();
+}
+
+/**
+ * Saves pictures on its own thread so that a picture is encoded and written
+ * while the next one renders, either the frames of an animation or the bands
+ * of a single picture. At most one picture waits to be saved, so push blocks
+ * when rendering gets ahead of saving.
+ */
+class Encoder {
+  public:
+
+    typedef std::function<void(const ray::Matrix<ray::Pixel>&)> Save;
+
+    Encoder() :
+        lock(), changed(), pending(), write(),
+        waiting(false), stopping(false), spent(0.0),
+        thread(&Encoder::work, this) { }
+
+    /** waits for the last picture to be saved */
+    ~Encoder() {
+      finish();
+    }
+
+    Encoder(const Encoder& enc) = delete;
+    const Encoder& operator =(const Encoder& enc) = delete;
+
+    /**
+     * Hands a picture to the thread, waiting for the picture before it to be
+     * picked up first.
+     *
+     * @param img   the picture
+     * @param save  saves the picture, called on the thread
+     */
+    void push(const ray::Matrix<ray::Pixel>& img, const Save& save) {
+      std::unique_lock<std::mutex> guard(lock);
+      changed.wait(guard, [this]() { return !waiting; });
+
+      pending = img;
+      write   = save;
+      waiting = true;
+      changed.notify_all();
+    }
+
+    /** saves the last picture and stops the thread */
+    void finish() {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+      }
+
+      changed.notify_all();
+      if(thread.joinable())
+        thread.join();
+    }
+
+    /** the milliseconds spent encoding and writing, read after finish */
+    inline double encodeMs() const { return spent; }
+
+  private:
+
+    void work() {
+      std::unique_lock<std::mutex> guard(lock);
+
+      for(uint32_t frame = 0;; frame++) {
+        changed.wait(guard, [this]() { return waiting || stopping; });
+        if(!waiting)
+          return;
+
+        ray::Matrix<ray::Pixel> img = pending;
+        Save job = write;
+        waiting = false;
+        changed.notify_all();
+        guard.unlock();
+
+        auto begin = sc::steady_clock::now();
+        {
+          TIMELINE_SCOPE_ARG("encode", frame);
+          job(img);
+        }
+        spent += sc::duration_cast<sc::microseconds>(
+            sc::steady_clock::now() - begin).count() / 1000.0;
+
+        guard.lock();
+      }
+    }
+
+    std::mutex              lock;
+    std::condition_variable changed;
+    ray::Matrix<ray::Pixel> pending;
+    Save                    write;
+    bool                    waiting;
+    bool                    stopping;
+    double                  spent;
+    boost::thread           thread;
+};
+
+/**
+ * Renders every frame of a CameraPath with one Model. The Model renders with
+ * a WorkerPool that is kept for the whole path, and each frame is saved by an
+ * Encoder while the next one renders.
+ *
+ * @param model  the model to render
+ * @param path   the Camera for each frame
+ * @param p_out  the output, numbered for each frame with frameName
+ * @param size   the number of rows and columns of each frame
+ */
+void renderPath(ray::Model& model, const ray::CameraPath& path, const fs::path& p_out, int size) {
+  model.setPool(std::make_shared<ray::WorkerPool>());
+
+  Encoder encoder;
+  double  traceMs = 0.0;
+  auto    begin   = sc::steady_clock::now();
+
+  for(size_t i = 0; i < path.size(); i++) {
+    auto start = sc::steady_clock::now();
+    ray::Matrix<ray::Pixel> image;
+    {
+      TIMELINE_SCOPE_ARG("render", i);
+      image = model.click(path[i], size, size);
+    }
+    traceMs += sc::duration_cast<sc::microseconds>(
+        sc::steady_clock::now() - start).count() / 1000.0;
+
+    fs::path name = frameName(p_out, i);
+    encoder.push(image, [name](const ray::Matrix<ray::Pixel>& img) { save(img, name); });
+  }
+
+  encoder.finish();
+
+  double wallMs = sc::duration_cast<sc::microseconds>(
+      sc::steady_clock::now() - begin).count() / 1000.0;
+  double frames = double(path.size());
+
+  std::cout << "Frames: " << path.size() << " (" << std::fixed << std::setprecision(2)
+            << wallMs / frames << " ms per frame, render " << traceMs / frames
+            << " ms, encode " << encoder.encodeMs() / frames << " ms)" << std::endl;
+  std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * What was counted while rendering a picture, added up over its bands.
+ */
+struct Counts {
+  Counts() : samples(0), shadows(), stats(), cost() { }
+
+  /** adds what the Model counted in its last call to click */
+  void add(const ray::Model& model) {
+    samples += model.samples();
+    shadows += model.shadowStats();
+    stats   += model.stats();
+  }
+
+  uint64_t              samples;
+  ray::ShadowStats      shadows;
+  ray::RayStats         stats;
+  ray::Matrix<uint64_t> cost;
+};
+
+/**
+ * Renders a single picture a band of rows at a time, each band written by an
+ * Encoder while the next one renders, so that only a band of the picture is
+ * kept in memory and the picture is written by the time the last band is
+ * done. Each band is rendered as a rectangle of the picture, so the picture
+ * matches one rendered at once.
+ *
+ * @param model   the model to render
+ * @param camera  the Camera for the picture
+ * @param p_out   the output, a ppm, pfm or png
+ * @param size    the number of rows and columns of the picture
+ * @param band    the number of rows in a band
+ * @param counts  return for what was counted
+ * @return        false if the picture could not be written
+ */
+bool renderBands(ray::Model& model, const ray::Camera& camera, const fs::path& p_out,
+    int size, int band, Counts& counts)
+{
+  ray::ImageWriter::ptr writer = ray::ImageWriter::open(p_out.string(), size, size);
+  if(!writer)
+    return false;
+
+  model.setPool(std::make_shared<ray::WorkerPool>());
+
+  Encoder  encoder;
+  bool     written = true;
+  uint32_t nbands  = 0;
+  double   traceMs = 0.0;
+
+  for(int top = 0; top < size; top += band, nbands++) {
+    int rows = std::min(band, size - top);
+
+    auto start = sc::steady_clock::now();
+    ray::Matrix<ray::Pixel> image;
+    {
+      TIMELINE_SCOPE_ARG("render", top);
+      image = model.click(camera, size, size, ray::Rect(top, 0, rows, size));
+    }
+    traceMs += sc::duration_cast<sc::microseconds>(
+        sc::steady_clock::now() - start).count() / 1000.0;
+    counts.add(model);
+
+    encoder.push(image, [&](const ray::Matrix<ray::Pixel>& img) {
+      written = writer->write(img) && written;
+    });
+  }
+
+  encoder.finish();
+  written = writer->close() && written;
+
+  std::cout << "Bands: " << nbands << " of " << band << " rows (" << std::fixed
+            << std::setprecision(2) << traceMs / nbands << " ms render, "
+            << encoder.encodeMs() / nbands << " ms encode per band)" << std::endl;
+  std::cout.unsetf(std::ios::floatfield);
+
+  return written;
+}
+
+/**
+ * Reads rectangles of the picture, each written as "<top>,<left>,<height>,<width>".
+ *
+ * @param values  the rectangles
+ * @param size    the number of rows and columns of the picture
+ * @param rects   return for the rectangles
+ * @return        false if a rectangle is not four numbers or is not inside of
+ *                the picture
+ */
+bool toRects(const std::vector<std::string>& values, int size, std::vector<ray::Rect>& rects) {
+  if(values.empty())
+    return false;
+
+  for(const std::string& value : values) {
+    std::istringstream istr(value);
+    ray::Rect rect;
+    char sep[3];
+
+    if(!(istr >> rect.top >> sep[0] >> rect.left >> sep[1] >> rect.height >> sep[2] >> rect.width) ||
+        !(istr >> std::ws).eof() || sep[0] != ',' || sep[1] != ',' || sep[2] != ',')
+      return false;
+
+    if(rect.top < 0 || rect.left < 0 || rect.height <= 0 || rect.width <= 0 ||
+        rect.top + rect.height > size || rect.left + rect.width > size)
+      return false;
+    rects.push_back(rect);
+  }
+
+  return true;
+}
+
 int main(int argc, char** argv) {
   Glib::RefPtr<Gtk::Application> app =
       Gtk::Application::create(argc, argv, "Tracer.Obj");
 
-  if(argc != 3) {
-    std::cout << usage << std::endl;
+  po::options_description visible("Options");
+  visible.add_options()
+      ("help,h", "print this message")
+      ("optimize", "weld, clean and reorder the mesh before rendering")
+      ("weld", po::value<double>()->default_value(1.0e-6),
+          "distance under which --optimize welds vertices")
+      ("raster", "find the first hit of the camera rays with the rasterizer")
+      ("samples", po::value<uint16_t>()->default_value(1),
+          "most samples taken for a pixel on an edge, 1 turns anti-aliasing off")
+      ("batch", "follow the reflections of each tile together, sorted by direction and origin")
+      ("order", po::value<std::string>()->default_value("scanline"),
+          "order of the tiles and pixels: scanline, morton or hilbert")
+      ("no-shadow-cache", "trace every shadow ray instead of testing the last occluder first")
+      ("stats", "print the work done while rendering, needs a build with DEF=-DSTATS")
+      ("heatmap", po::value<std::string>(),
+          "write a false color picture of the cost of each pixel and print a histogram")
+      ("trace", po::value<std::string>(),
+          "write a timeline of every phase of the render as Chrome trace JSON")
+      ("size", po::value<int>()->default_value(1024),
+          "the number of rows and columns in the picture")
+      ("band", po::value<int>(),
+          "render and write the picture this many rows at a time, to a ppm, pfm or png")
+      ("crop", po::value<std::string>(),
+          "render and write only the rectangle <top>,<left>,<height>,<width> of the picture")
+      ("region", po::value<std::vector<std::string> >(),
+          "render only this rectangle of the picture, written as for --crop, may be repeated")
+      ("over", po::value<std::string>(),
+          "a ppm of the whole picture that --region renders over instead of black")
+      ("orbit", po::value<uint32_t>(),
+          "render this many frames turning the camera once around the model")
+      ("path", po::value<std::string>(),
+          "render a frame for every camera of a file of keyframes");
+
+  po::options_description hidden;
+  hidden.add_options()
+      ("model",  po::value<std::string>())
+      ("output", po::value<std::string>());
+
+  po::options_description all;
+  all.add(visible).add(hidden);
+
+  po::positional_options_description positional;
+  positional.add("model", 1).add("output", 1);
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).
+        options(all).positional(positional).run(), vm);
+    po::notify(vm);
+  } catch(po::error& error) {
+    std::cout << error.what() << std::endl;
+    std::cout << usage << std::endl << visible << std::endl;
     return -1;
   }
-  
+
+  if(vm.count("help") || !vm.count("model") || !vm.count("output")) {
+    std::cout << usage << std::endl << visible << std::endl;
+    return -1;
+  }
+
   /* validate inputs */
-  fs::path m_in  = argv[1];
-  fs::path p_out = argv[2];
+  fs::path m_in  = vm["model"].as<std::string>();
+  fs::path p_out = vm["output"].as<std::string>();
   
   if(!fs::is_regular_file(m_in)) {
     std::cout << usage << std::endl;
@@ -64,20 +403,167 @@ int main(int argc, char** argv) {
     p_out = p_out / "out.png";
   }
 
+  if(vm.count("band") && (vm.count("orbit") || vm.count("path"))) {
+    std::cout << "--band renders a single picture, not --orbit or --path" << std::endl;
+    return -1;
+  }
+
+  if(vm.count("band") + vm.count("crop") + vm.count("region") > 1 ||
+      ((vm.count("crop") || vm.count("region")) && (vm.count("orbit") || vm.count("path")))) {
+    std::cout << "--band, --crop and --region render a single picture in different ways" << std::endl;
+    return -1;
+  }
+
+  if(vm.count("band") && !ray::ImageWriter::supports(p_out.string())) {
+    std::cout << "--band writes ppm, pfm or png pictures" << std::endl;
+    return -1;
+  }
+
+  /* the colors of a heatmap are scaled to the costs of the whole picture, so
+   * it would need the cost of every pixel that --band avoids keeping */
+  if(vm.count("band") && vm.count("heatmap")) {
+    std::cout << "--heatmap needs the whole picture, not --band" << std::endl;
+    return -1;
+  }
+
+  if(vm.count("trace"))
+    ray::timeline::start();
+
   /* load the model */
   auto stream = ray::ObjectStream::loadObject(m_in.string());
 
+  if(vm.count("optimize")) {
+    auto optimized = std::make_shared<ray::MeshOptimizer>(
+        stream, vm["weld"].as<double>());
+    std::cout << "Optimized mesh: " << optimized->report() << std::endl;
+    stream = optimized;
+  }
+
   ray::Model  model;
   ray::Camera camera;
 
   ray::Model::fromObjectStream(stream, model, camera);
 
+  model.options().rasterize = vm.count("raster") != 0;
+
+  model.options().maxSamples = std::max(vm["samples"].as<uint16_t>(), uint16_t(1));
+  model.options().shadowCache = vm.count("no-shadow-cache") == 0;
+  model.options().batchRays   = vm.count("batch") != 0;
+  model.options().measureCost = vm.count("heatmap") != 0;
+
+  std::string order = vm["order"].as<std::string>();
+  if(order == "morton") {
+    model.options().order = ray::RenderOptions::morton;
+  } else if(order == "hilbert") {
+    model.options().order = ray::RenderOptions::hilbert;
+  } else if(order != "scanline") {
+    std::cout << "unknown order: " << order << std::endl;
+    return -1;
+  }
+
+  int size = std::max(vm["size"].as<int>(), 1);
+
+  /* the parts of the picture to render, all of it if there are none */
+  std::vector<ray::Rect> rects;
+  const char* rectOption = vm.count("crop") ? "crop" : vm.count("region") ? "region" : nullptr;
+
+  if(rectOption) {
+    std::vector<std::string> values = vm.count("crop") ?
+        std::vector<std::string>(1, vm["crop"].as<std::string>()) :
+        vm["region"].as<std::vector<std::string> >();
+
+    if(!toRects(values, size, rects)) {
+      std::cout << "--" << rectOption << " takes a rectangle <top>,<left>,<height>,<width>"
+                << " inside of the picture" << std::endl;
+      return -1;
+    }
+  }
+
+  double pixels = rects.empty() ? double(size) * size : 0.0;
+  for(const ray::Rect& rect : rects)
+    pixels += double(rect.height) * rect.width;
+
+  /* find the camera for every frame of an animation */
+  ray::CameraPath path;
+  if(vm.count("path")) {
+    try {
+      path = ray::CameraPath::fromFile(vm["path"].as<std::string>());
+    } catch(std::exception& error) {
+      std::cout << "Could not read the camera path " << vm["path"].as<std::string>() << std::endl;
+      return -1;
+    }
+  } else if(vm.count("orbit")) {
+    ray::Box bounds = model.getBounds();
+    path = ray::CameraPath::orbit(camera, bounds.min() + bounds.len() / 2.0,
+        vm["orbit"].as<uint32_t>());
+  }
+
   /* render the image */
-  try {
-    copyOut(model.click(camera, 1024, 1024))->save(
-      p_out.string(), p_out.extension().string().substr(1));
-  } catch(Gdk::PixbufError& error) {
-    std::cout << error.what() << std::endl;
+  Counts counts;
+
+  if(!path.empty()) {
+    renderPath(model, path, p_out, size);
+    counts.add(model);
+    counts.cost = model.cost();
+  } else if(vm.count("band")) {
+    if(!renderBands(model, camera, p_out, size, std::max(vm["band"].as<int>(), 1), counts)) {
+      std::cout << "Could not write " << p_out.string() << std::endl;
+      return -1;
+    }
+  } else {
+    ray::Matrix<ray::Pixel> image;
+
+    if(vm.count("over") && (!ray::readPPM(vm["over"].as<std::string>(), image) ||
+        int(image.rows()) != size || int(image.cols()) != size)) {
+      std::cout << "--over needs a " << size << "x" << size << " ppm" << std::endl;
+      return -1;
+    }
+
+    {
+      TIMELINE_SCOPE("render");
+      if(vm.count("crop")) {
+        image = model.click(camera, size, size, rects[0]);
+      } else if(vm.count("region")) {
+        model.click(camera, size, size, rects, image);
+      } else {
+        image = model.click(camera, size, size);
+      }
+    }
+
+    TIMELINE_SCOPE("encode");
+    save(image, p_out);
+    counts.add(model);
+    counts.cost = model.cost();
+  }
+
+  std::cout << "Samples: " << counts.samples << " ("
+            << double(counts.samples) / pixels << " per pixel)" << std::endl;
+
+  const ray::ShadowStats& shadows = counts.shadows;
+  std::cout << "Shadow rays: " << shadows.rays << " (occluder cache "
+            << shadows.hits << "/" << shadows.tests << " hits, "
+            << int(shadows.hitRate() * 100) << "%)" << std::endl;
+
+  if(vm.count("heatmap")) {
+    fs::path h_out = vm["heatmap"].as<std::string>();
+    ray::CostMap cost(counts.cost);
+
+    save(cost.heatmap(), h_out);
+
+    cost.histogram(std::cout);
+  }
+
+  if(vm.count("stats")) {
+    if(ray::RayStats::enabled)
+      std::cout << counts.stats << std::endl;
+    else
+      std::cout << "Counters are off, rebuild with make DEF=-DSTATS" << std::endl;
+  }
+
+  if(vm.count("trace")) {
+    ray::timeline::stop();
+    if(!ray::timeline::write(vm["trace"].as<std::string>()))
+      std::cout << "Could not write the trace to " << vm["trace"].as<std::string>() << std::endl;
   }
 
   return 0;
@@ -25,6 +25,9 @@ namespace ray {
     const uint16_t width  = 1024;
     const uint16_t height = 1024;
 
+    /** radians that the camera orbits for each pixel the mouse moves */
+    const double orbitSpeed = 0.005;
+
     ObjViewer::ObjViewer() :
         window(nullptr),
         image(nullptr),
@@ -38,7 +41,10 @@ namespace ray {
             height)),
         model(),
         camera(),
-        isButtonPressed(false)
+        cache(),
+        isButtonPressed(false),
+        lastX(0),
+        lastY(0)
     {
       builder->get_widget("ObjView", window);
       builder->get_widget("Image",   image);
@@ -91,7 +97,7 @@ namespace ray {
               ObjectStream::loadObject(dialog.get_filename()),
               model,
               camera);
-          copyOut(model.click(camera, height, width));
+          render(true);
 
           break;
         }
@@ -106,30 +112,59 @@ namespace ray {
 
     bool ObjViewer::onPress(GdkEventButton* drag) {
       isButtonPressed = true;
+      lastX = drag->x;
+      lastY = drag->y;
       return true;
     }
 
+    /**
+     * Orbits the camera around the center of the model while the mouse is
+     * dragged. The frames rendered while dragging reuse the last frame.
+     */
     bool ObjViewer::onMouse(GdkEventMotion* drag) {
       if(isButtonPressed) {
-        std::cout << "[" << drag->x << ", " << drag->y << "]" << std::flush;
+        Box    bounds = model.getBounds();
+        Vector center = bounds.min() + (bounds.len() / 2.0);
+
+        camera.rotate((drag->x - lastX) * orbitSpeed, Camera::x_axis, center);
+        camera.rotate((drag->y - lastY) * orbitSpeed, Camera::y_axis, center);
+
+        lastX = drag->x;
+        lastY = drag->y;
+
+        render(false);
       }
       return true;
     }
 
     bool ObjViewer::onRelease(GdkEventButton* drag) {
       isButtonPressed = false;
+      render(true);
+      return true;
+    }
+
+    /**
+     * Renders the model and shows the result.
+     *
+     * @param full  true to ignore the last frame and render every pixel
+     */
+    void ObjViewer::render(bool full) {
+      if(full)
+        cache.invalidate();
 
       auto begin = sc::high_resolution_clock::now();
-      auto out   = model.click(camera, height, width);
+      auto out   = model.click(camera, height, width, cache);
       auto end   = sc::high_resolution_clock::now();
 
       copyOut(out);
+      image->queue_draw();
 
       std::cout << "Render time:["
           << (sc::duration_cast<sc::milliseconds>(end - begin)).count()
-          << "ms]" << std::endl;
+          << "ms] reused:[" << int(cache.reused() * 100) << "%]" << std::endl;
 
-      return true;
+      if(RayStats::enabled)
+        std::cout << model.stats() << std::endl;
     }
 
     void ObjViewer::copyOut(const Matrix<Pixel>& in) {
@@ -8,6 +8,7 @@
 #pragma once
 
 /* local includes */
+#include <FrameCache.hpp>
 #include <Model.hpp>
 
 /* gtk includes */
@@ -30,6 +31,7 @@ namespace ray {
         void onQuit();
 
         void copyOut(const Matrix<Pixel>& in);
+        void render(bool full);
 
         bool onPress  (GdkEventButton* drag);
         bool onMouse  (GdkEventMotion* drag);
@@ -41,10 +43,12 @@ namespace ray {
         Glib::RefPtr<Gtk::Builder> builder;
         Glib::RefPtr<Gdk::Pixbuf>  imgbuffer;
 
-        ray::Model  model;
-        ray::Camera camera;
+        ray::Model      model;
+        ray::Camera     camera;
+        ray::FrameCache cache;
 
-        bool isButtonPressed;
+        bool   isButtonPressed;
+        double lastX, lastY;
     };
 
   }
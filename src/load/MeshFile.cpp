@@ -0,0 +1,498 @@
+/*
+ * MeshFile.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <MeshFile.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <cstring>
+
+/* system includes */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ray {
+  namespace mesh {
+
+    const std::string MeshLoader::suffix  = ".rmesh";
+    const uint32_t    MeshLoader::version = 1;
+
+    static const char magic[4] = { 'R', 'M', 'S', 'H' };
+
+    template<typename T>
+    static inline void get(std::istream& istr, T& out) {
+      istr.read(reinterpret_cast<char*>(&out), sizeof(T));
+    }
+
+    template<typename T>
+    static inline void put(std::ostream& ostr, const T& in) {
+      ostr.write(reinterpret_cast<const char*>(&in), sizeof(T));
+    }
+
+    static Vector getVector(std::istream& istr) {
+      double xyz[3];
+      istr.read(reinterpret_cast<char*>(xyz), sizeof(xyz));
+      return Vector(xyz[0], xyz[1], xyz[2]);
+    }
+
+    static void putVector(std::ostream& ostr, const Vector& v) {
+      double xyz[3] = { v.x(), v.y(), v.z() };
+      ostr.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+    }
+
+    /**
+     * Loads a binary mesh file.
+     *
+     * @param fileName  the name of the file
+     */
+    MeshLoader::MeshLoader(std::string fileName) :
+        _materials(), _vertices(), _normals(), _polygons()
+    {
+      std::ifstream istr(fileName.c_str(), std::ios::binary);
+      char     head[4];
+      uint32_t vers, counts[4];
+
+      if(!istr)
+        throw std::exception();
+
+      istr.seekg(0, std::ios::end);
+      uint64_t size = istr.tellg();
+      istr.seekg(0, std::ios::beg);
+
+      istr.read(head, sizeof(head));
+      get(istr, vers);
+      if(!istr || std::memcmp(head, magic, sizeof(magic)) != 0 || vers != version)
+        throw std::exception();
+
+      for(uint32_t& count : counts)
+        get(istr, count);
+
+      /* the counts are checked against the size of the file before anything
+       * is allocated for them: a Material is 12 doubles, a vertex or normal 3
+       * and the smallest polygon is its count and Material index */
+      if(!istr || uint64_t(counts[0]) * 12 * sizeof(double) +
+          (uint64_t(counts[1]) + counts[2]) * 3 * sizeof(double) +
+          uint64_t(counts[3]) * (sizeof(uint32_t) + sizeof(uint16_t)) > size)
+        throw std::exception();
+
+      _materials.reserve(counts[0]);
+      for(uint32_t i = 0; i < counts[0]; i++) {
+        double params[3];
+        Matrix<double> diffuse = ray::eye<double>(4);
+
+        istr.read(reinterpret_cast<char*>(params), sizeof(params));
+        for(int r = 0; r < 3; r++)
+          for(int c = 0; c < 3; c++)
+            get(istr, diffuse[r][c]);
+
+        _materials.push_back(Material(params[0], params[1], params[2], diffuse));
+      }
+
+      _vertices.reserve(counts[1]);
+      for(uint32_t i = 0; i < counts[1]; i++)
+        _vertices.push_back(getVector(istr));
+
+      _normals.reserve(counts[2]);
+      for(uint32_t i = 0; i < counts[2]; i++)
+        _normals.push_back(getVector(istr));
+
+      if(!istr)
+        throw std::exception();
+      uint64_t left = size - uint64_t(istr.tellg());
+
+      _polygons.reserve(counts[3]);
+      for(uint32_t i = 0; i < counts[3]; i++) {
+        uint32_t n;
+        get(istr, n);
+
+        uint64_t bytes = sizeof(n) + uint64_t(n) * 2 * sizeof(int32_t) + sizeof(uint16_t);
+        if(!istr || bytes > left)
+          throw std::exception();
+        left -= bytes;
+
+        std::vector<int> verts(n), norms(n);
+        istr.read(reinterpret_cast<char*>(verts.data()), n * sizeof(int32_t));
+        istr.read(reinterpret_cast<char*>(norms.data()), n * sizeof(int32_t));
+
+        for(uint32_t j = 0; j < n; j++)
+          if(verts[j] < 0 || uint32_t(verts[j]) >= counts[1] ||
+             norms[j] < -1 || (norms[j] >= 0 && uint32_t(norms[j]) >= counts[2]))
+            throw std::exception();
+
+        _polygons.push_back(Polygon(verts, std::vector<int>(n, -1), norms, ""));
+        get(istr, _polygons.back().matidx);
+      }
+
+      if(!istr)
+        throw std::exception();
+    }
+
+    std::vector<Light> MeshLoader::lights() const {
+      return std::vector<Light>();
+    }
+
+    std::vector<Material> MeshLoader::materials() const {
+      return _materials;
+    }
+
+    std::vector<ObjectStream::Polygon> MeshLoader::polygons() const {
+      return _polygons;
+    }
+
+    std::vector<Vector> MeshLoader::vertices() const {
+      return _vertices;
+    }
+
+    std::vector<Vector> MeshLoader::textures() const {
+      return std::vector<Vector>();
+    }
+
+    std::vector<Vector> MeshLoader::normals() const {
+      return _normals;
+    }
+
+    /**
+     * Starts a binary mesh file. The header is written with every count at
+     * zero and is fixed by close.
+     *
+     * @param fileName  the name of the file
+     */
+    MeshWriter::MeshWriter(std::string fileName) :
+        ostr(fileName.c_str(), std::ios::binary | std::ios::trunc),
+        curr(0),
+        counts()
+    {
+      if(!ostr)
+        throw std::exception();
+
+      ostr.write(magic, sizeof(magic));
+      put(ostr, MeshLoader::version);
+      for(uint32_t count : counts)
+        put(ostr, count);
+    }
+
+    MeshWriter::~MeshWriter() {
+      if(ostr.is_open())
+        close();
+    }
+
+    /**
+     * Moves on to a part of the file, the parts can only be written in order.
+     *
+     * @param next  the part of the file that is about to be written
+     */
+    void MeshWriter::section(int next) {
+      if(next < curr || !ostr.is_open())
+        throw std::exception();
+      curr = next;
+      counts[next]++;
+    }
+
+    void MeshWriter::material(const Material& mat) {
+      section(0);
+
+      put(ostr, mat.ks());
+      put(ostr, mat.kt());
+      put(ostr, mat.alpha());
+      for(int r = 0; r < 3; r++)
+        for(int c = 0; c < 3; c++)
+          put(ostr, mat.diffuse()[r][c]);
+    }
+
+    void MeshWriter::vertex(const Vector& v) {
+      section(1);
+      putVector(ostr, v);
+    }
+
+    void MeshWriter::normal(const Vector& n) {
+      section(2);
+      putVector(ostr, n);
+    }
+
+    /**
+     * Writes a polygon.
+     *
+     * @param vertices  the index of each of the vertices of the polygon
+     * @param normals   the index of the normal at each vertex
+     * @param material  the index of the Material of the polygon
+     */
+    void MeshWriter::polygon(
+        const std::vector<int32_t>& vertices,
+        const std::vector<int32_t>& normals,
+        uint16_t material)
+    {
+      section(3);
+
+      if(vertices.size() != normals.size())
+        throw std::exception();
+
+      put(ostr, uint32_t(vertices.size()));
+      ostr.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(int32_t));
+      ostr.write(reinterpret_cast<const char*>(normals.data()),  normals.size()  * sizeof(int32_t));
+      put(ostr, material);
+    }
+
+    /**
+     * Fills in the counts in the header and closes the file.
+     */
+    void MeshWriter::close() {
+      ostr.seekp(sizeof(magic) + sizeof(uint32_t));
+      for(uint32_t count : counts)
+        put(ostr, count);
+      ostr.close();
+    }
+
+    /**
+     * Writes every mesh of an object into a binary mesh file.
+     *
+     * @param fileName  the name of the file
+     * @param stream    the object to write
+     */
+    void MeshWriter::write(std::string fileName, const ObjectStream& stream) {
+      MeshWriter writer(fileName);
+
+      for(const Material& mat : stream.materials())
+        writer.material(mat);
+      for(const Vector& v : stream.vertices())
+        writer.vertex(v);
+      for(const Vector& n : stream.normals())
+        writer.normal(n);
+      for(const ObjectStream::Polygon& p : stream.polygons())
+        writer.polygon(
+            std::vector<int32_t>(p.vertices.begin(), p.vertices.end()),
+            std::vector<int32_t>(p.normals.begin(),  p.normals.end()),
+            p.matidx);
+
+      writer.close();
+    }
+
+    /**
+     * Copies an object and everything that it instances into world space.
+     *
+     * @param stream     the object
+     * @param transform  the object to world transform for the object
+     * @param flat       return for the geometry
+     */
+    void flatten(const ObjectStream& stream, const Matrix<double>& transform, Flat& flat) {
+      bool identity = true;
+      for(int r = 0; r < 4; r++)
+        for(int c = 0; c < 4; c++)
+          identity = identity && transform[r][c] == (r == c ? 1.0 : 0.0);
+
+      auto apply = [&](const Vector& v) {
+        double out[3];
+        for(int r = 0; r < 3; r++)
+          out[r] = transform[r][0] * v.x() + transform[r][1] * v.y() +
+                   transform[r][2] * v.z() + transform[r][3];
+        return Vector(out[0], out[1], out[2]);
+      };
+
+      /* normals go through the inverse transpose, the same as Instance does, so a
+       * scale that is not the same on every axis keeps them perpendicular */
+      Matrix<double> inv = identity ? transform : transform.inv();
+      auto applyNormal = [&](const Vector& n) {
+        return Vector(
+            inv[0][0] * n.x() + inv[1][0] * n.y() + inv[2][0] * n.z(),
+            inv[0][1] * n.x() + inv[1][1] * n.y() + inv[2][1] * n.z(),
+            inv[0][2] * n.x() + inv[1][2] * n.y() + inv[2][2] * n.z()).normalize();
+      };
+
+      int32_t  vbase = flat.vertices.size();
+      int32_t  nbase = flat.normals.size();
+      uint16_t mbase = flat.materials.size();
+
+      for(const Material& mat : stream.materials())
+        flat.materials.push_back(mat);
+      for(const Vector& v : stream.vertices())
+        flat.vertices.push_back(identity ? v : apply(v));
+      for(const Vector& n : stream.normals())
+        flat.normals.push_back(identity ? n : applyNormal(n));
+
+      for(ObjectStream::Polygon p : stream.polygons()) {
+        for(int& v : p.vertices)
+          v += vbase;
+        for(int& n : p.normals)
+          if(n >= 0)
+            n += nbase;
+        p.matidx += mbase;
+        flat.polygons.push_back(p);
+      }
+
+      for(const ObjectStream::Instance& inst : stream.instances())
+        flatten(*inst.mesh, transform * inst.transform, flat);
+    }
+
+    /**
+     * Opens a scene as a Source. A binary mesh file is read where it is,
+     * anything else is loaded and flattened.
+     *
+     * @param fileName  the name of the file
+     * @return          the scene, null if it is not a kind of file that can
+     *                  be loaded
+     */
+    std::unique_ptr<Source> Source::open(std::string fileName) {
+      const std::string& suffix = MeshLoader::suffix;
+
+      if(fileName.size() >= suffix.size() &&
+          fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0)
+        return std::unique_ptr<Source>(new MeshReader(fileName));
+
+      auto stream = ObjectStream::loadObject(fileName);
+      if(!stream)
+        return std::unique_ptr<Source>();
+      return std::unique_ptr<Source>(new FlatSource(*stream));
+    }
+
+    FlatSource::FlatSource(const ObjectStream& stream) :
+        flat(), _lights(stream.lights()), curr(0)
+    {
+      flatten(stream, ray::eye<double>(4), flat);
+    }
+
+    const ObjectStream::Polygon* FlatSource::next() {
+      return curr < flat.polygons.size() ? &flat.polygons[curr++] : nullptr;
+    }
+
+    template<typename T>
+    static inline void get(const char* data, size_t& at, T& out) {
+      std::memcpy(&out, data + at, sizeof(T));
+      at += sizeof(T);
+    }
+
+    /**
+     * Maps a binary mesh file and reads its header and Materials.
+     *
+     * @param fileName  the name of the file
+     */
+    MeshReader::MeshReader(std::string fileName) :
+        data(nullptr),
+        size(0),
+        _materials(),
+        _lights(),
+        counts(),
+        vertices(0),
+        normals(0),
+        polygons(0),
+        curr(0),
+        read(0),
+        polygon(std::vector<int>(), std::vector<int>(), std::vector<int>(), "")
+    {
+      const size_t header = sizeof(magic) + 5 * sizeof(uint32_t);
+      struct stat info;
+
+      int fd = ::open(fileName.c_str(), O_RDONLY);
+      if(fd < 0)
+        throw std::exception();
+      if(fstat(fd, &info) < 0 || size_t(info.st_size) < header) {
+        ::close(fd);
+        throw std::exception();
+      }
+
+      void* map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if(map == MAP_FAILED)
+        throw std::exception();
+
+      data = static_cast<const char*>(map);
+      size = info.st_size;
+
+      size_t   at = sizeof(magic);
+      uint32_t vers;
+
+      get(data, at, vers);
+      for(uint32_t& count : counts)
+        get(data, at, count);
+
+      vertices = at + size_t(counts[0]) * 12 * sizeof(double);
+      normals  = vertices + size_t(counts[1]) * 3 * sizeof(double);
+      polygons = normals  + size_t(counts[2]) * 3 * sizeof(double);
+
+      if(std::memcmp(data, magic, sizeof(magic)) != 0 || vers != MeshLoader::version || polygons > size) {
+        munmap(map, size);
+        throw std::exception();
+      }
+
+      _materials.reserve(counts[0]);
+      for(uint32_t i = 0; i < counts[0]; i++) {
+        double params[3];
+        Matrix<double> diffuse = ray::eye<double>(4);
+
+        for(double& param : params)
+          get(data, at, param);
+        for(int r = 0; r < 3; r++)
+          for(int c = 0; c < 3; c++)
+            get(data, at, diffuse[r][c]);
+
+        _materials.push_back(Material(params[0], params[1], params[2], diffuse));
+      }
+
+      rewind();
+    }
+
+    MeshReader::~MeshReader() {
+      munmap(const_cast<char*>(data), size);
+    }
+
+    Vector MeshReader::vertex(uint32_t i) const {
+      double xyz[3];
+
+      if(i >= counts[1])
+        throw std::exception();
+      std::memcpy(xyz, data + vertices + size_t(i) * sizeof(xyz), sizeof(xyz));
+      return Vector(xyz[0], xyz[1], xyz[2]);
+    }
+
+    Vector MeshReader::normal(uint32_t i) const {
+      double xyz[3];
+
+      if(i >= counts[2])
+        throw std::exception();
+      std::memcpy(xyz, data + normals + size_t(i) * sizeof(xyz), sizeof(xyz));
+      return Vector(xyz[0], xyz[1], xyz[2]);
+    }
+
+    void MeshReader::rewind() {
+      curr = polygons;
+      read = 0;
+    }
+
+    /**
+     * Reads the next polygon. The polygon that is returned is reused by the
+     * next call.
+     *
+     * @return  the polygon, null after the last one
+     */
+    const ObjectStream::Polygon* MeshReader::next() {
+      uint32_t n;
+
+      if(read == counts[3])
+        return nullptr;
+      if(size - curr < sizeof(n) + sizeof(uint16_t))
+        throw std::exception();
+
+      std::memcpy(&n, data + curr, sizeof(n));
+      if((size - curr - sizeof(n) - sizeof(uint16_t)) / (2 * sizeof(int32_t)) < n)
+        throw std::exception();
+      curr += sizeof(n);
+
+      polygon.vertices.resize(n);
+      polygon.normals.resize(n);
+      std::memcpy(polygon.vertices.data(), data + curr, n * sizeof(int32_t));
+      curr += n * sizeof(int32_t);
+      std::memcpy(polygon.normals.data(),  data + curr, n * sizeof(int32_t));
+      curr += n * sizeof(int32_t);
+      get(data, curr, polygon.matidx);
+
+      read++;
+      return &polygon;
+    }
+
+  }
+}
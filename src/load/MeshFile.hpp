@@ -0,0 +1,225 @@
+/*
+ * MeshFile.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Model.hpp>
+#include <ObjectStream.hpp>
+
+/* std includes */
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace ray {
+  namespace mesh {
+
+    /**
+     * All of the geometry of an object and everything that it instances moved
+     * into world space, with every Instance copied. This is how a scene is
+     * written into files that have no Instances.
+     */
+    struct Flat {
+      std::vector<Material>              materials;
+      std::vector<Vector>                vertices;
+      std::vector<Vector>                normals;
+      std::vector<ObjectStream::Polygon> polygons;
+    };
+
+    void flatten(const ObjectStream& stream, const Matrix<double>& transform, Flat& flat);
+
+    /**
+     * A binary mesh file. This holds the same things as an obj file but is
+     * read without parsing any text, which matters for very large meshes. All
+     * values are stored in the byte order of the machine that wrote the file:
+     *
+     *   char     magic[4]     "RMSH"
+     *   uint32_t version      1
+     *   uint32_t nmaterials, nvertices, nnormals, npolygons
+     *   nmaterials x { double ks, kt, alpha, diffuse[3][3] }
+     *   nvertices  x { double x, y, z }
+     *   nnormals   x { double x, y, z }
+     *   npolygons  x { uint32_t n, int32_t vertices[n], int32_t normals[n],
+     *                  uint16_t material }
+     */
+    class MeshLoader : public ObjectStream {
+      public:
+
+        static const std::string suffix;
+        static const uint32_t    version;
+
+        MeshLoader(std::string fileName);
+
+        MeshLoader(const MeshLoader& obj) = delete;
+        const MeshLoader& operator =(const MeshLoader& obj) = delete;
+
+        virtual ~MeshLoader() { }
+
+        virtual std::vector<Light>       lights() const;
+        virtual std::vector<Material> materials() const;
+        virtual std::vector<Polygon>   polygons() const;
+        virtual std::vector<Vector>    vertices() const;
+        virtual std::vector<Vector>    textures() const;
+        virtual std::vector<Vector>     normals() const;
+
+      private:
+
+        std::vector<Material> _materials;
+        std::vector<Vector>   _vertices;
+        std::vector<Vector>   _normals;
+        std::vector<Polygon>  _polygons;
+    };
+
+    /**
+     * Writes a binary mesh file one element at a time so that a mesh never
+     * needs to be held in memory to be written. The elements have to be
+     * written in the order of the file: every Material, then every vertex,
+     * then every normal and last every polygon. The counts in the header are
+     * filled in by close.
+     */
+    class MeshWriter {
+      public:
+
+        MeshWriter(std::string fileName);
+        ~MeshWriter();
+
+        MeshWriter(const MeshWriter& obj) = delete;
+        const MeshWriter& operator =(const MeshWriter& obj) = delete;
+
+        void material(const Material& mat);
+        void vertex  (const Vector& v);
+        void normal  (const Vector& n);
+        void polygon (const std::vector<int32_t>& vertices,
+                      const std::vector<int32_t>& normals,
+                      uint16_t material);
+        void close();
+
+        static void write(std::string fileName, const ObjectStream& stream);
+
+      private:
+
+        void section(int next);
+
+        std::ofstream ostr;
+
+        /** the part of the file that is being written */
+        int curr;
+
+        /** the number of each kind of element written so far */
+        uint32_t counts[4];
+    };
+
+    /**
+     * The geometry of a scene in world space, read a polygon at a time so
+     * that splitting or paging a scene does not need every polygon in memory.
+     * The polygons can be read as many times as needed, each time in the
+     * same order. The vertices and normals of a polygon are indices that are
+     * looked up with vertex and normal.
+     */
+    class Source {
+      public:
+
+        virtual ~Source() { }
+
+        virtual const std::vector<Material>& materials() const = 0;
+        virtual const std::vector<Light>&       lights() const = 0;
+
+        virtual uint32_t nvertices() const = 0;
+        virtual uint32_t  nnormals() const = 0;
+        virtual uint32_t npolygons() const = 0;
+
+        virtual Vector vertex(uint32_t i) const = 0;
+        virtual Vector normal(uint32_t i) const = 0;
+
+        /** starts reading the polygons from the first again */
+        virtual void rewind() = 0;
+
+        /** the next polygon, null after the last one until rewind */
+        virtual const ObjectStream::Polygon* next() = 0;
+
+        static std::unique_ptr<Source> open(std::string fileName);
+    };
+
+    /**
+     * A scene that was loaded and flattened, for every kind of file that has
+     * to be parsed and so is held in memory anyway.
+     */
+    class FlatSource : public Source {
+      public:
+
+        FlatSource(const ObjectStream& stream);
+
+        virtual const std::vector<Material>& materials() const { return flat.materials; }
+        virtual const std::vector<Light>&       lights() const { return _lights;        }
+
+        virtual uint32_t nvertices() const { return flat.vertices.size(); }
+        virtual uint32_t  nnormals() const { return flat.normals.size();  }
+        virtual uint32_t npolygons() const { return flat.polygons.size(); }
+
+        virtual Vector vertex(uint32_t i) const { return flat.vertices.at(i); }
+        virtual Vector normal(uint32_t i) const { return flat.normals.at(i);  }
+
+        virtual void rewind() { curr = 0; }
+        virtual const ObjectStream::Polygon* next();
+
+      private:
+
+        Flat               flat;
+        std::vector<Light> _lights;
+        size_t             curr;
+    };
+
+    /**
+     * Reads a binary mesh file where it is instead of loading it. The file is
+     * mapped into memory, so only the parts that are being read take up
+     * memory and a mesh bigger than the memory of the machine can be read.
+     * The polygons have no texture coordinates.
+     */
+    class MeshReader : public Source {
+      public:
+
+        MeshReader(std::string fileName);
+        virtual ~MeshReader();
+
+        MeshReader(const MeshReader& obj) = delete;
+        const MeshReader& operator =(const MeshReader& obj) = delete;
+
+        virtual const std::vector<Material>& materials() const { return _materials; }
+        virtual const std::vector<Light>&       lights() const { return _lights;    }
+
+        virtual uint32_t nvertices() const { return counts[1]; }
+        virtual uint32_t  nnormals() const { return counts[2]; }
+        virtual uint32_t npolygons() const { return counts[3]; }
+
+        virtual Vector vertex(uint32_t i) const;
+        virtual Vector normal(uint32_t i) const;
+
+        virtual void rewind();
+        virtual const ObjectStream::Polygon* next();
+
+      private:
+
+        const char* data;
+        size_t      size;
+
+        std::vector<Material> _materials;
+        std::vector<Light>    _lights;
+        uint32_t              counts[4];
+
+        /** where the vertices, normals and polygons start in the file */
+        size_t vertices, normals, polygons;
+
+        /** where the next polygon is and the number of polygons read */
+        size_t   curr;
+        uint32_t read;
+
+        ObjectStream::Polygon polygon;
+    };
+
+  }
+}
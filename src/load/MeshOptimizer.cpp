@@ -0,0 +1,343 @@
+/*
+ * MeshOptimizer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <MeshOptimizer.hpp>
+#include <Model.hpp>
+#include <Morton.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+namespace ray {
+
+  /** a cell in the uniform grid used to find vertices that should be welded */
+  struct WeldCell {
+    int64_t x, y, z;
+
+    inline bool operator==(const WeldCell& o) const
+    { return x == o.x && y == o.y && z == o.z; }
+  };
+
+  struct WeldCellHash {
+    inline size_t operator()(const WeldCell& c) const
+    { return size_t(c.x * 73856093) ^ size_t(c.y * 19349663) ^ size_t(c.z * 83492791); }
+  };
+
+  /** a single triangle while the mesh is being processed */
+  struct WeldTriangle {
+    uint32_t v[3];
+    int32_t  t[3];
+    int32_t  n[3];
+    uint32_t poly;
+    uint32_t code;
+  };
+
+  /**
+   * Welds together all of the Vectors that are within a tolerance of each
+   * other. The first Vector found in a group is used as the representative
+   * for the entire group.
+   *
+   * @param in    the Vectors to weld
+   * @param tol   the maximum distance between two welded Vectors
+   * @param out   return for the representative Vectors
+   * @return      mapping from the index in the input to the index in out
+   */
+  static std::vector<uint32_t> weld(
+      const std::vector<Vector>& in,
+      double tol,
+      std::vector<Vector>& out)
+  {
+    std::unordered_map<WeldCell, std::vector<uint32_t>, WeldCellHash> grid;
+    std::vector<uint32_t> remap(in.size());
+    double cell = std::max(tol, EPSILON);
+
+    out.clear();
+
+    for(uint32_t i = 0; i < in.size(); i++) {
+      const Vector& v = in[i];
+      WeldCell home = {
+          int64_t(std::floor(v.x() / cell)),
+          int64_t(std::floor(v.y() / cell)),
+          int64_t(std::floor(v.z() / cell)) };
+      bool found = false;
+
+      for(int64_t dx = -1; dx <= 1 && !found; dx++) {
+        for(int64_t dy = -1; dy <= 1 && !found; dy++) {
+          for(int64_t dz = -1; dz <= 1 && !found; dz++) {
+            auto iter = grid.find({ home.x + dx, home.y + dy, home.z + dz });
+            if(iter == grid.end())
+              continue;
+
+            for(uint32_t candidate : iter->second) {
+              if(out[candidate].distance(v) <= tol) {
+                remap[i] = candidate;
+                found = true;
+                break;
+              }
+            }
+          }
+        }
+      }
+
+      if(!found) {
+        remap[i] = out.size();
+        grid[home].push_back(out.size());
+        out.push_back(v);
+      }
+    }
+
+    return remap;
+  }
+
+  /**
+   * Builds the optimized version of a mesh. All of the work is done here so
+   * that the getters simply return the processed data.
+   *
+   * @param source     the ObjectStream that should be optimized
+   * @param tolerance  the distance under which two vertices are welded
+   */
+  MeshOptimizer::MeshOptimizer(ObjectStream::ptr source, double tolerance) :
+      _source(source), _vertices(), _normals(), _polygons(), _instances(), _report()
+  {
+    std::vector<Vector>  verts    = source->vertices();
+    std::vector<Vector>  norms    = source->normals();
+    std::vector<Polygon> polygons = source->polygons();
+
+    std::vector<Vector> welded;
+    std::vector<Vector> weldedNorms;
+    std::vector<uint32_t> vremap = weld(verts, tolerance, welded);
+    std::vector<uint32_t> nremap = weld(norms, tolerance, weldedNorms);
+
+    std::vector<WeldTriangle> tris;
+    std::set<std::array<uint32_t, 4> > seen;
+
+    _report.verticesIn = verts.size();
+    _report.normalsIn  = norms.size();
+
+    /* triangulate, dropping degenerate and duplicate triangles */
+    for(uint32_t i = 0; i < polygons.size(); i++) {
+      const Polygon& p = polygons[i];
+
+      for(int j = 1; j + 1 < int(p.vertices.size()); j++) {
+        int idx[3] = { 0, j, j + 1 };
+        WeldTriangle tri;
+
+        _report.trianglesIn++;
+
+        for(int k = 0; k < 3; k++) {
+          int n = idx[k] < int(p.normals.size())  ? p.normals [idx[k]] : -1;
+          int t = idx[k] < int(p.textures.size()) ? p.textures[idx[k]] : -1;
+
+          tri.v[k] = vremap[p.vertices[idx[k]]];
+          tri.n[k] = n < 0 ? -1 : int32_t(nremap[n]);
+          tri.t[k] = t;
+        }
+
+        tri.poly = i;
+        tri.code = 0;
+
+        const Vector& a = welded[tri.v[0]];
+        const Vector& b = welded[tri.v[1]];
+        const Vector& c = welded[tri.v[2]];
+
+        /* the area is measured against the longest edge so the test does not
+         * depend on the scale of the mesh */
+        double edge = std::max(dot(b - a, b - a), std::max(dot(c - b, c - b), dot(a - c, a - c)));
+
+        if(tri.v[0] == tri.v[1] || tri.v[1] == tri.v[2] || tri.v[0] == tri.v[2] ||
+           cross(b - a, c - a).length() <= EPSILON * edge) {
+          _report.degenerate++;
+          continue;
+        }
+
+        /* rotate the smallest index to the front instead of sorting, so the
+         * same triangle wound the other way is a different face */
+        std::array<uint32_t, 4> key = {{ tri.v[0], tri.v[1], tri.v[2], p.matidx }};
+        std::rotate(key.begin(), std::min_element(key.begin(), key.begin() + 3), key.begin() + 3);
+        if(!seen.insert(key).second) {
+          _report.duplicate++;
+          continue;
+        }
+
+        tris.push_back(tri);
+      }
+    }
+
+    /* sort the triangles along a Morton curve through their centroids */
+    if(!tris.empty()) {
+      Vector cmin( std::numeric_limits<double>::max());
+      Vector cmax(-std::numeric_limits<double>::max());
+
+      for(const WeldTriangle& tri : tris) {
+        Vector c = (welded[tri.v[0]] + welded[tri.v[1]] + welded[tri.v[2]]) / 3.0;
+        cmin = ray::min(cmin, c);
+        cmax = ray::max(cmax, c);
+      }
+
+      Vector scale = Vector(1023.0) / ray::max(cmax - cmin, EPSILON);
+
+      for(WeldTriangle& tri : tris) {
+        Vector c = (welded[tri.v[0]] + welded[tri.v[1]] + welded[tri.v[2]]) / 3.0;
+        Vector q = (c - cmin) * scale;
+        tri.code = morton3(uint32_t(q.x()), uint32_t(q.y()), uint32_t(q.z()));
+      }
+
+      std::stable_sort(tris.begin(), tris.end(),
+          [](const WeldTriangle& l, const WeldTriangle& r) { return l.code < r.code; });
+    }
+
+    /* renumber vertices and normals in the order that they are first used */
+    std::vector<int32_t> vorder(welded.size(),      -1);
+    std::vector<int32_t> norder(weldedNorms.size(), -1);
+
+    for(const WeldTriangle& tri : tris) {
+      std::vector<int> pv(3), pt(3), pn(3);
+
+      for(int k = 0; k < 3; k++) {
+        if(vorder[tri.v[k]] < 0) {
+          vorder[tri.v[k]] = _vertices.size();
+          _vertices.push_back(welded[tri.v[k]]);
+        }
+
+        if(tri.n[k] >= 0 && norder[tri.n[k]] < 0) {
+          norder[tri.n[k]] = _normals.size();
+          _normals.push_back(weldedNorms[tri.n[k]]);
+        }
+
+        pv[k] = vorder[tri.v[k]];
+        pt[k] = tri.t[k];
+        pn[k] = tri.n[k] < 0 ? -1 : norder[tri.n[k]];
+      }
+
+      const Polygon& src = polygons[tri.poly];
+      Polygon poly(pv, pt, pn, src.material);
+      poly.matidx = src.matidx;
+
+      _polygons.push_back(poly);
+    }
+
+    _report.verticesOut  = _vertices.size();
+    _report.normalsOut   = _normals.size();
+    _report.trianglesOut = _polygons.size();
+
+    /* optimize the meshes that are placed by the source as well, each shared
+     * mesh only once so that its Instances keep sharing the geometry */
+    std::map<ObjectStream*, ObjectStream::ptr> optimized;
+
+    for(const Instance& inst : source->instances()) {
+      ObjectStream::ptr& mesh = optimized[inst.mesh.get()];
+
+      if(!mesh) {
+        auto placed = std::make_shared<MeshOptimizer>(inst.mesh, tolerance);
+        _report += placed->report();
+        mesh = placed;
+      }
+
+      _instances.push_back(Instance(mesh, inst.transform));
+    }
+  }
+
+  /**
+   * Get the Lights for the object, these are passed through from the source.
+   *
+   * @return  the vector of Lights
+   */
+  std::vector<Light> MeshOptimizer::lights() const {
+    return _source->lights();
+  }
+
+  /**
+   * Get the Materials for the object, these are passed through from the source.
+   *
+   * @return  the vector of Materials
+   */
+  std::vector<Material> MeshOptimizer::materials() const {
+    return _source->materials();
+  }
+
+  /**
+   * Get the cleaned and reordered triangles for the object.
+   *
+   * @return  the vector of Polygons
+   */
+  std::vector<ObjectStream::Polygon> MeshOptimizer::polygons() const {
+    return _polygons;
+  }
+
+  /**
+   * Get the welded vertices for the object.
+   *
+   * @return  the vector of vertices
+   */
+  std::vector<Vector> MeshOptimizer::vertices() const {
+    return _vertices;
+  }
+
+  /**
+   * Get the texture coordinates for the object, these are not welded.
+   *
+   * @return  the vector of texture coordinates
+   */
+  std::vector<Vector> MeshOptimizer::textures() const {
+    return _source->textures();
+  }
+
+  /**
+   * Get the welded normals for the object.
+   *
+   * @return  the vector of normals
+   */
+  std::vector<Vector> MeshOptimizer::normals() const {
+    return _normals;
+  }
+
+  /**
+   * Get the Instances placed by the source, each pointing at an optimized
+   * copy of the mesh that it places.
+   *
+   * @return  the vector of Instances
+   */
+  std::vector<ObjectStream::Instance> MeshOptimizer::instances() const {
+    return _instances;
+  }
+
+  /**
+   * Adds the counts of another report, used to fold the reports of the
+   * instanced meshes into the report of the scene.
+   *
+   * @param rhs  the report to add
+   * @return     this report
+   */
+  MeshOptimizer::Report& MeshOptimizer::Report::operator +=(const Report& rhs) {
+    verticesIn   += rhs.verticesIn;
+    verticesOut  += rhs.verticesOut;
+    normalsIn    += rhs.normalsIn;
+    normalsOut   += rhs.normalsOut;
+    trianglesIn  += rhs.trianglesIn;
+    trianglesOut += rhs.trianglesOut;
+    degenerate   += rhs.degenerate;
+    duplicate    += rhs.duplicate;
+    return *this;
+  }
+
+  std::ostream& operator<<(std::ostream& ostr, const MeshOptimizer::Report& rep) {
+    ostr << "vertices: "  << rep.verticesIn  << " -> " << rep.verticesOut  << ", "
+         << "normals: "   << rep.normalsIn   << " -> " << rep.normalsOut   << ", "
+         << "triangles: " << rep.trianglesIn << " -> " << rep.trianglesOut
+         << " (" << rep.degenerate << " degenerate, "
+         << rep.duplicate << " duplicate)";
+    return ostr;
+  }
+
+}
@@ -0,0 +1,79 @@
+/*
+ * MeshOptimizer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <ObjectStream.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <iostream>
+#include <stdint.h>
+
+namespace ray {
+
+  /**
+   * Preprocessing pass that sits between an ObjectStream and the construction
+   * of a Model. The source mesh has its vertices welded, its degenerate and
+   * duplicate triangles removed, and its triangles and vertices reordered
+   * along a Morton curve so that neighboring surfaces are close in memory.
+   * The meshes placed by the Instances of the source are optimized the same
+   * way.
+   */
+  class MeshOptimizer : public ObjectStream {
+    public:
+
+      struct Report {
+        Report() :
+          verticesIn(0), verticesOut(0),
+          normalsIn(0), normalsOut(0),
+          trianglesIn(0), trianglesOut(0),
+          degenerate(0), duplicate(0) { }
+
+        Report& operator +=(const Report& rhs);
+
+        uint32_t verticesIn;
+        uint32_t verticesOut;
+        uint32_t normalsIn;
+        uint32_t normalsOut;
+        uint32_t trianglesIn;
+        uint32_t trianglesOut;
+        uint32_t degenerate;
+        uint32_t duplicate;
+      };
+
+      MeshOptimizer(ObjectStream::ptr source, double tolerance = 1.0e-6);
+
+      MeshOptimizer(const MeshOptimizer& obj) = delete;
+      const MeshOptimizer& operator =(const MeshOptimizer& obj) = delete;
+
+      virtual ~MeshOptimizer() { }
+
+      virtual std::vector<Light>       lights() const;
+      virtual std::vector<Material> materials() const;
+      virtual std::vector<Polygon>   polygons() const;
+      virtual std::vector<Vector>    vertices() const;
+      virtual std::vector<Vector>    textures() const;
+      virtual std::vector<Vector>     normals() const;
+      virtual std::vector<Instance> instances() const;
+
+      inline const Report& report() const { return _report; }
+
+    private:
+
+      ObjectStream::ptr     _source;
+      std::vector<Vector>   _vertices;
+      std::vector<Vector>   _normals;
+      std::vector<Polygon>  _polygons;
+      std::vector<Instance> _instances;
+      Report                _report;
+  };
+
+  std::ostream& operator<<(std::ostream& ostr, const MeshOptimizer::Report& rep);
+
+}
@@ -25,6 +25,8 @@ extern std::vector<ray::Vector> verts;
 extern std::vector<ray::Vector> texts;
 extern std::vector<ray::Vector> norms;
 
+extern std::string mtln;
+
 std::vector<std::string> objLibs;
 ray::obj::ObjLoader*     objDest;
 
@@ -39,6 +41,9 @@ namespace ray {
       verts.clear();
       texts.clear();
       norms.clear();
+      objLibs.clear();
+
+      mtln = "default_model_material";
 
       objDest = this;
 
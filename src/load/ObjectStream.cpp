@@ -7,7 +7,10 @@
 
 /* local includes */
 #include <ObjectStream.hpp>
+#include <MeshFile.hpp>
 #include <ObjLoader.hpp>
+#include <SceneLoader.hpp>
+#include <Timeline.hpp>
 
 namespace ray {
 
@@ -24,7 +27,7 @@ namespace ray {
       return false;
 
     for(auto stri = str.rbegin(), stre = end.rbegin();
-        stre != end.rbegin(); stri++, stre++) {
+        stre != end.rend(); stri++, stre++) {
       if(*stri != *stre)
         return false;
     }
@@ -40,9 +43,14 @@ namespace ray {
    * @return       a ObjectStream pointer
    */
   ObjectStream::ptr ObjectStream::loadObject(std::string fname) {
+    TIMELINE_SCOPE("parse");
 
     if(stringEndsWith(fname, obj::ObjLoader::suffix))
       return std::make_shared<obj::ObjLoader>(fname);
+    if(stringEndsWith(fname, scene::SceneLoader::suffix))
+      return std::make_shared<scene::SceneLoader>(fname);
+    if(stringEndsWith(fname, mesh::MeshLoader::suffix))
+      return std::make_shared<mesh::MeshLoader>(fname);
 
     return ObjectStream::ptr(nullptr);
   }
@@ -7,6 +7,9 @@
 
 #pragma once
 
+/* local includes */
+#include <Matrix.tpp>
+
 /* std includes */
 #include <memory>
 #include <stdint.h>
@@ -43,6 +46,15 @@ namespace ray {
 
       typedef std::shared_ptr<ObjectStream> ptr;
 
+      struct Instance {
+        Instance(ObjectStream::ptr mesh, Matrix<double> transform) :
+              mesh     (mesh),
+              transform(transform) { }
+
+        ObjectStream::ptr mesh;
+        Matrix<double>    transform;
+      };
+
       ObjectStream() { }
       virtual ~ObjectStream() { }
 
@@ -53,6 +65,15 @@ namespace ray {
       virtual std::vector<Vector>    textures() const = 0;
       virtual std::vector<Vector>     normals() const = 0;
 
+      /**
+       * Get the other objects that are placed by this object. The geometry of
+       * an instanced object is shared between all of its Instances.
+       *
+       * @return  the vector of Instances, empty for most objects
+       */
+      virtual std::vector<Instance> instances() const
+      { return std::vector<Instance>(); }
+
       static ObjectStream::ptr loadObject(std::string fname);
   };
 
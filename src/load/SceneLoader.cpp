@@ -0,0 +1,215 @@
+/*
+ * SceneLoader.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <SceneLoader.hpp>
+
+/* std includes */
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+/* boost includes */
+#include <boost/filesystem.hpp>
+namespace fs = boost::filesystem;
+
+namespace ray {
+  namespace scene {
+
+    const std::string SceneLoader::suffix = ".scene";
+
+    /**
+     * Builds a rotation around one of the major axes.
+     *
+     * @param axis     the axis, one of 'x', 'y' or 'z'
+     * @param degrees  the amount to rotate by
+     * @return         the rotation as a 4x4 Matrix
+     */
+    static Matrix<double> rotation(char axis, double degrees) {
+      Matrix<double> ret = ray::eye<double>(4);
+      double rad = degrees * M_PI / 180.0;
+      int a = axis == 'x' ? 1 : axis == 'y' ? 2 : 0;
+      int b = axis == 'x' ? 2 : axis == 'y' ? 0 : 1;
+
+      ret[a][a] =  std::cos(rad);
+      ret[a][b] = -std::sin(rad);
+      ret[b][a] =  std::sin(rad);
+      ret[b][b] =  std::cos(rad);
+
+      return ret;
+    }
+
+    /**
+     * Reads the transform operations at the end of an instance line.
+     *
+     * @param line  the stream positioned after the name of the mesh
+     * @param out   return for the transform
+     * @return      false if the operations could not be read
+     */
+    static bool readTransform(std::istringstream& line, Matrix<double>& out) {
+      std::string op;
+
+      out = ray::eye<double>(4);
+
+      while(line >> op) {
+        Matrix<double> next = ray::eye<double>(4);
+
+        if(op == "translate") {
+          if(!(line >> next[0][3] >> next[1][3] >> next[2][3]))
+            return false;
+        } else if(op == "rotate") {
+          char   axis;
+          double degrees;
+          if(!(line >> axis >> degrees) || (axis != 'x' && axis != 'y' && axis != 'z'))
+            return false;
+          next = rotation(axis, degrees);
+        } else if(op == "scale") {
+          std::vector<double> vals;
+          double val;
+          while(vals.size() < 3 && line >> val)
+            vals.push_back(val);
+          if(vals.size() != 1 && vals.size() != 3)
+            return false;
+          line.clear();
+          for(int i = 0; i < 3; i++)
+            next[i][i] = vals[vals.size() == 1 ? 0 : i];
+        } else if(op == "matrix") {
+          for(int i = 0; i < 16; i++)
+            if(!(line >> next[i / 4][i % 4]))
+              return false;
+        } else {
+          return false;
+        }
+
+        out = next * out;
+      }
+
+      return true;
+    }
+
+    /**
+     * Loads a scene file. Every mesh that is referenced by the scene is loaded
+     * exactly once no matter how many times it is placed.
+     *
+     * @param fileName  the name of the scene file
+     */
+    SceneLoader::SceneLoader(std::string fileName) :
+        _meshes(), _instances(), _lights()
+    {
+      fs::path directory = fs::path(fileName).parent_path();
+      std::ifstream istr(fileName.c_str());
+      std::string buffer;
+      int lineno = 0;
+
+      if(!istr)
+        throw std::exception();
+
+      while(std::getline(istr, buffer)) {
+        std::istringstream line(buffer);
+        std::string cmd;
+
+        lineno++;
+
+        if(!(line >> cmd) || cmd[0] == '#')
+          continue;
+
+        if(cmd == "mesh") {
+          std::string name, file;
+          if(line >> name >> file) {
+            fs::path path = fs::path(file).is_absolute() ? fs::path(file) : directory / file;
+            ObjectStream::ptr mesh = ObjectStream::loadObject(path.string());
+            if(!mesh)
+              throw std::exception();
+            _meshes[name] = mesh;
+            continue;
+          }
+        } else if(cmd == "instance") {
+          std::string name;
+          Matrix<double> transform;
+          if(line >> name && _meshes.count(name) && readTransform(line, transform)) {
+            _instances.push_back(Instance(_meshes[name], transform));
+            continue;
+          }
+        } else if(cmd == "light") {
+          double x, y, z, r, g, b;
+          if(line >> x >> y >> z >> r >> g >> b) {
+            _lights.push_back(Light(Vector(x, y, z), Vector(r, g, b)));
+            continue;
+          }
+        }
+
+        std::cout << "Bad scene line " << fileName << ":" << lineno << ": "
+                  << buffer << std::endl;
+      }
+    }
+
+    /**
+     * Get the Lights for the scene
+     *
+     * @return  the vector of Lights
+     */
+    std::vector<Light> SceneLoader::lights() const {
+      return _lights;
+    }
+
+    /**
+     * A scene has no Materials of its own, they belong to the meshes.
+     *
+     * @return  an empty vector
+     */
+    std::vector<Material> SceneLoader::materials() const {
+      return std::vector<Material>();
+    }
+
+    /**
+     * A scene has no Polygons of its own, they belong to the meshes.
+     *
+     * @return  an empty vector
+     */
+    std::vector<ObjectStream::Polygon> SceneLoader::polygons() const {
+      return std::vector<Polygon>();
+    }
+
+    /**
+     * A scene has no vertices of its own, they belong to the meshes.
+     *
+     * @return  an empty vector
+     */
+    std::vector<Vector> SceneLoader::vertices() const {
+      return std::vector<Vector>();
+    }
+
+    /**
+     * A scene has no texture coordinates of its own.
+     *
+     * @return  an empty vector
+     */
+    std::vector<Vector> SceneLoader::textures() const {
+      return std::vector<Vector>();
+    }
+
+    /**
+     * A scene has no normals of its own, they belong to the meshes.
+     *
+     * @return  an empty vector
+     */
+    std::vector<Vector> SceneLoader::normals() const {
+      return std::vector<Vector>();
+    }
+
+    /**
+     * Get the meshes that are placed by this scene.
+     *
+     * @return  the vector of Instances
+     */
+    std::vector<ObjectStream::Instance> SceneLoader::instances() const {
+      return _instances;
+    }
+
+  }
+}
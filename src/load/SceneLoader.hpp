@@ -0,0 +1,66 @@
+/*
+ * SceneLoader.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Model.hpp>
+#include <ObjectStream.hpp>
+
+/* std includes */
+#include <map>
+#include <string>
+
+namespace ray {
+  namespace scene {
+
+    /**
+     * Loads a small scene description that places meshes into the world. Each
+     * line of the file is one of the following, and lines starting with '#'
+     * are ignored:
+     *
+     *   mesh <name> <file>             loads a mesh, relative to the scene file
+     *   instance <name> [<op> ...]     places a mesh, see below
+     *   light <x> <y> <z> <r> <g> <b>  adds a point light
+     *
+     * The transform of an instance is built from the operations that follow
+     * the name of the mesh, applied in the order that they are written:
+     *
+     *   translate <x> <y> <z>
+     *   rotate <x|y|z> <degrees>
+     *   scale <s> | scale <x> <y> <z>
+     *   matrix <16 values, row major>
+     */
+    class SceneLoader : public ObjectStream {
+      public:
+
+        static const std::string suffix;
+
+        SceneLoader(std::string fileName);
+
+        SceneLoader(const SceneLoader& obj) = delete;
+        const SceneLoader& operator =(const SceneLoader& obj) = delete;
+
+        virtual ~SceneLoader() { }
+
+        virtual std::vector<Light>       lights() const;
+        virtual std::vector<Material> materials() const;
+        virtual std::vector<Polygon>   polygons() const;
+        virtual std::vector<Vector>    vertices() const;
+        virtual std::vector<Vector>    textures() const;
+        virtual std::vector<Vector>     normals() const;
+        virtual std::vector<Instance> instances() const;
+
+      private:
+
+        std::map<std::string, ObjectStream::ptr> _meshes;
+        std::vector<Instance>                    _instances;
+        std::vector<Light>                       _lights;
+    };
+
+  }
+}
@@ -8,13 +8,19 @@
 /* local includes */
 #include <Camera.hpp>
 #include <Model.hpp>
+#include <Timeline.hpp>
+
+/* std includes */
+#include <vector>
 
 namespace ray {
 
   Camera::Camera() :
       fl(),
       umin(-1), umax(1),
-      vmin(-1), vmax(1) { }
+      vmin(-1), vmax(1),
+      top(0), left(0),
+      ubase(0), vbase(0), xstep(0), ystep(0) { }
 
   Camera::Camera(Vector fp, Vector vrp, Vector up) :
       fp(fp),
@@ -24,7 +30,9 @@ namespace ray {
       v(cross(n, u)),
       fl(-(vrp - fp).length()),
       umin(-1), umax(1),
-      vmin(-1), vmax(1) { }
+      vmin(-1), vmax(1),
+      top(0), left(0),
+      ubase(0), vbase(0), xstep(0), ystep(0) { }
 
   /**
    * Changes the location of the camera in the world. This moves the
@@ -88,6 +96,40 @@ namespace ray {
     vrp = fp + (n * fl);
   }
 
+  /**
+   * Makes a Camera that sees only part of the picture taken by this one. A
+   * picture of height rows and width columns from the new Camera is the same
+   * as that part of a picture of rows and cols from this one. The window
+   * keeps where the whole picture starts and the step between its pixels, so
+   * its Rays are worked out exactly the same way as the whole picture's.
+   *
+   * @param top     the first row of the part
+   * @param left    the first column of the part
+   * @param height  the number of rows in the part
+   * @param width   the number of columns in the part
+   * @param rows    the number of rows in the whole picture
+   * @param cols    the number of columns in the whole picture
+   * @return        the Camera for the part
+   */
+  Camera Camera::window(int top, int left, int height, int width, int rows, int cols) const {
+    Camera ret = *this;
+    double xinc = xstep ? xstep : (umax - umin) / double(cols);
+    double yinc = ystep ? ystep : (vmax - vmin) / double(rows);
+
+    ret.umin  = umin + left * xinc;
+    ret.umax  = umin + (left + width) * xinc;
+    ret.vmin  = vmin + top * yinc;
+    ret.vmax  = vmin + (top + height) * yinc;
+    ret.top   = this->top  + top;
+    ret.left  = this->left + left;
+    ret.ubase = xstep ? ubase : umin;
+    ret.vbase = ystep ? vbase : vmin;
+    ret.xstep = xinc;
+    ret.ystep = yinc;
+
+    return ret;
+  }
+
   /**
    * Get the Rays that are cast by this Camera. The size of the resulting Matrix
    * should match the size of the picture that is being rendered.
@@ -97,27 +139,69 @@ namespace ray {
    * @return      A Matrix of Rays that will work for the Camera
    */
   Matrix<Ray> Camera::getRays(int rows, int cols) const {
+    TIMELINE_SCOPE("getRays");
+
     Vector U, L;
     double xv, yv;
     double xinc = (umax - umin) / double(cols);
     double yinc = (vmax - vmin) / double(rows);
 
     Matrix<Ray> ret(rows, cols);
+    std::vector<Vector> xs(cols);
+    double xstart = umin, ystart = vmin;
 
-    xv = umin;
-    for(int x = 0; x < cols; x++, xv += xinc) {
-      yv = vmin;
-      for(int y = 0; y < rows; y++, yv += yinc) {
-        L = vrp + (u * xv) - (v * yv);
+    /* a window steps from the start of the whole picture to its first pixel */
+    if(xstep) {
+      xinc   = xstep;
+      yinc   = ystep;
+      xstart = ubase;
+      ystart = vbase;
+      for(int x = 0; x < left; x++)
+        xstart += xinc;
+      for(int y = 0; y < top; y++)
+        ystart += yinc;
+    }
+
+    /* fill in row order, the offsets are accumulated the same way for every row */
+    xv = xstart;
+    for(int x = 0; x < cols; x++, xv += xinc)
+      xs[x] = u * xv;
+
+    yv = ystart;
+    for(int y = 0; y < rows; y++, yv += yinc) {
+      Ray* out = ret[y];
+
+      for(int x = 0; x < cols; x++) {
+        L = vrp + xs[x] - (v * yv);
         U = (L - fp).normalize();
 
-        ret[y][x] = Ray(L, U, nullptr);
+        out[x] = Ray(L, U, nullptr);
       }
     }
 
     return ret;
   }
 
+  /**
+   * Get a single Ray through any point on the image. Whole numbers land on the
+   * same places as the Rays from getRays.
+   *
+   * @param row   the row on the image, may be between pixels
+   * @param col   the column on the image, may be between pixels
+   * @param rows  the number of rows in the image
+   * @param cols  the number of columns in the image
+   * @return      the Ray through that point
+   */
+  Ray Camera::getRay(double row, double col, int rows, int cols) const {
+    double xv = umin + col * (umax - umin) / double(cols);
+    double yv = vmin + row * (vmax - vmin) / double(rows);
+
+    Vector L = vrp + (u * xv) - (v * yv);
+    Vector U = (L - fp).normalize();
+
+    return Ray(L, U, nullptr);
+  }
+
   /**
    * Gets the projection Matrix for the Camera
    *
@@ -158,6 +242,41 @@ namespace ray {
     return scal * rota * tran;
   }
 
+  /**
+   * Moves a point in the world into the space of the Camera. The x and y of
+   * the result are along the horizontal and vertical of the Camera and the z
+   * is the distance in front of the focal point.
+   *
+   * @param world  the point in world coordinates
+   * @return       the point in view coordinates
+   */
+  Vector Camera::toView(const Vector& world) const {
+    Vector d = world - fp;
+
+    return Vector(dot(d, u), dot(d, v), -dot(d, n));
+  }
+
+  /**
+   * Projects a point in view coordinates onto an image. The result has the
+   * column and row that the point lands on, matching the Rays created by
+   * getRays, and keeps the depth of the point in z. The point must be in
+   * front of the focal point.
+   *
+   * @param view  the point in view coordinates
+   * @param rows  the number of rows in the image
+   * @param cols  the number of columns in the image
+   * @return      the column, row and depth of the point
+   */
+  Vector Camera::toImage(const Vector& view, int rows, int cols) const {
+    double xv =  view.x() * -fl / view.z();
+    double yv = -view.y() * -fl / view.z();
+
+    return Vector(
+        (xv - umin) * double(cols) / (umax - umin),
+        (yv - vmin) * double(rows) / (vmax - vmin),
+        view.z());
+  }
+
   /**
    * Create a new Camera based on a model.
    *
@@ -165,7 +284,16 @@ namespace ray {
    * @return   a new Camera that looks at the model
    */
   Camera Camera::fromModel(const Model& m) {
-    auto box   = m.getBounds();
+    return fromBounds(m.getBounds());
+  }
+
+  /**
+   * Create a new Camera that looks at everything inside of a box.
+   *
+   * @param box  the bounds of what the camera should see
+   * @return     a new Camera that looks at the box
+   */
+  Camera Camera::fromBounds(const Box& box) {
     auto zdiff = sqrt(
         pow(box.len().y(), 2) * pow(box.len().x(), 2)) + box.len().z();
 
@@ -14,6 +14,7 @@
 
 namespace ray {
 
+  class Box;
   class Model;
 
   class Pixel {
@@ -48,6 +49,18 @@ namespace ray {
     return (ostr << "(" << int(p.r()) << " " << int(p.g()) << " " << int(p.b()) << ")");
   }
 
+  /**
+   * A rectangle of the pixels of a picture, given by its first row and column
+   * and its size.
+   */
+  struct Rect {
+    Rect() : top(0), left(0), height(0), width(0) { }
+    Rect(int top, int left, int height, int width) :
+      top(top), left(left), height(height), width(width) { }
+
+    int top, left, height, width;
+  };
+
   class Camera {
     public:
 
@@ -61,11 +74,18 @@ namespace ray {
       void move  (double amount, axis which);
       void rotate(double amount, axis which, Vector around);
 
+      Camera window(int top, int left, int height, int width, int rows, int cols) const;
+
       /* get information about camera for rendering */
       Matrix<Ray>    getRays(int rows, int cols) const;
+      Ray            getRay(double row, double col, int rows, int cols) const;
       Matrix<double>  getProjection() const;
       Matrix<double>  getRotation(int rows, int cols) const;
 
+      /* move points from the world onto the image */
+      Vector toView (const Vector& world) const;
+      Vector toImage(const Vector& view, int rows, int cols) const;
+
       Vector  _fp() const { return  fp; }
       Vector _vrp() const { return vrp; }
       Vector   _n() const { return   n; }
@@ -73,8 +93,13 @@ namespace ray {
       Vector   _v() const { return   v; }
       double   _fl() const { return  fl; }
 
+      /** the first row and column of the whole picture that a window sees */
+      int _top()  const { return top;  }
+      int _left() const { return left; }
+
       /* camera creation */
       static Camera fromModel(const Model& m);
+      static Camera fromBounds(const Box& box);
 
     private:
 
@@ -97,6 +122,12 @@ namespace ray {
       double umin, umax;
       /** top and bottom of the plane of the Camera */
       double vmin, vmax;
+
+      /** where the picture of a window starts in the whole picture */
+      int top, left;
+
+      /** for a window, where the whole picture starts and the step between its pixels */
+      double ubase, vbase, xstep, ystep;
   };
 
 }
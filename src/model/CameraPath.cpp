@@ -0,0 +1,120 @@
+/*
+ * CameraPath.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <CameraPath.hpp>
+
+/* std includes */
+#include <fstream>
+#include <sstream>
+
+namespace ray {
+
+  /**
+   * Turns a Camera around a point in equal steps, the way dragging in
+   * ObjView does. The last frame stops one step short of the whole turn so
+   * that a full circle loops without a repeated frame.
+   *
+   * @param start    the Camera for the first frame
+   * @param center   the point to turn around, normally the center of the model
+   * @param frames   the number of frames
+   * @param which    the axis of the Camera to turn around
+   * @param radians  the whole turn
+   * @return         the path
+   */
+  CameraPath CameraPath::orbit(
+      const Camera& start,
+      const Vector& center,
+      uint32_t frames,
+      Camera::axis which,
+      double radians)
+  {
+    CameraPath ret;
+
+    ret.cameras.reserve(frames);
+    for(uint32_t i = 0; i < frames; i++) {
+      Camera cam = start;
+      cam.rotate(radians * i / frames, which, center);
+      ret.cameras.push_back(cam);
+    }
+
+    return ret;
+  }
+
+  /**
+   * Reads a path from a file of keyframes. Each line is the frame number of
+   * the keyframe followed by the focal point, view reference point and up
+   * direction of its Camera:
+   *
+   *   frame  fpx fpy fpz  vrpx vrpy vrpz  upx upy upz
+   *
+   * Lines starting with # are skipped. The frame numbers must increase and
+   * the path runs from the first keyframe to the last.
+   *
+   * @param fileName  the name of the file
+   * @return          the path
+   */
+  CameraPath CameraPath::fromFile(const std::string& fileName) {
+    struct key { uint32_t frame; Vector fp, vrp, up; };
+
+    std::ifstream istr(fileName.c_str());
+    std::vector<key> keys;
+    std::string buffer;
+
+    if(!istr)
+      throw std::exception();
+
+    while(std::getline(istr, buffer)) {
+      std::istringstream line(buffer);
+      double v[9];
+      key k;
+
+      if(!(line >> k.frame)) {
+        std::istringstream check(buffer);
+        std::string word;
+        if(check >> word && word[0] != '#')
+          throw std::exception();
+        continue;
+      }
+
+      for(double& d : v)
+        if(!(line >> d))
+          throw std::exception();
+
+      if(!keys.empty() && k.frame <= keys.back().frame)
+        throw std::exception();
+
+      k.fp  = Vector(v[0], v[1], v[2]);
+      k.vrp = Vector(v[3], v[4], v[5]);
+      k.up  = Vector(v[6], v[7], v[8]);
+      keys.push_back(k);
+    }
+
+    CameraPath ret;
+
+    if(keys.empty())
+      return ret;
+
+    ret.cameras.push_back(Camera(keys[0].fp, keys[0].vrp, keys[0].up));
+    for(uint32_t i = 1; i < keys.size(); i++) {
+      const key& a = keys[i - 1];
+      const key& b = keys[i];
+
+      for(uint32_t f = a.frame + 1; f <= b.frame; f++) {
+        double t = double(f - a.frame) / double(b.frame - a.frame);
+
+        ret.cameras.push_back(Camera(
+            a.fp  + (b.fp  - a.fp)  * t,
+            a.vrp + (b.vrp - a.vrp) * t,
+            a.up  + (b.up  - a.up)  * t));
+      }
+    }
+
+    return ret;
+  }
+
+}
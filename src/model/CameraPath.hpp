@@ -0,0 +1,50 @@
+/*
+ * CameraPath.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Camera.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ray {
+
+  /**
+   * The Camera for every frame of an animation. A path is either an orbit of
+   * a Camera around a point or is read from a file of keyframes, with the
+   * frames between two keyframes placed on the line between them.
+   */
+  class CameraPath {
+    public:
+
+      CameraPath() : cameras() { }
+
+      static CameraPath orbit(
+          const Camera& start,
+          const Vector& center,
+          uint32_t frames,
+          Camera::axis which = Camera::x_axis,
+          double radians = 2.0 * M_PI);
+
+      static CameraPath fromFile(const std::string& fileName);
+
+      inline size_t        size()                 const { return cameras.size(); }
+      inline bool          empty()                const { return cameras.empty(); }
+      inline const Camera& operator[](size_t idx) const { return cameras[idx]; }
+
+    private:
+
+      std::vector<Camera> cameras;
+  };
+
+}
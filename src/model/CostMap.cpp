@@ -0,0 +1,133 @@
+/*
+ * CostMap.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <CostMap.hpp>
+#include <Stats.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <iomanip>
+
+namespace ray {
+
+  /** the colors that the false color scale passes through, cheap to expensive */
+  static const double scale[][3] = {
+      {   0,   0,   0 },
+      {   0,   0, 255 },
+      {   0, 255, 255 },
+      {   0, 255,   0 },
+      { 255, 255,   0 },
+      { 255,   0,   0 },
+  };
+
+  static const int nscale = sizeof(scale) / sizeof(scale[0]);
+
+  /**
+   * Finds the power of two range that a cost falls in, costs of 0 and 1 both
+   * go in the first.
+   */
+  static inline uint32_t bin(uint64_t cost) {
+    uint32_t ret = 0;
+    while(cost > 1) {
+      cost >>= 1;
+      ret++;
+    }
+    return ret;
+  }
+
+  /**
+   * Works out the summary of the costs of a picture.
+   *
+   * @param cost  the cost of every pixel
+   */
+  CostMap::CostMap(const Matrix<uint64_t>& cost) :
+      cost(cost), _total(0), _median(0), _p99(0), _max(0), bins()
+  {
+    uint64_t n = uint64_t(cost.rows()) * cost.cols();
+
+    if(n == 0)
+      return;
+
+    std::vector<uint64_t> sorted(cost.get(), cost.get() + n);
+    std::sort(sorted.begin(), sorted.end());
+
+    for(uint64_t c : sorted) {
+      uint32_t b = bin(c);
+
+      if(b >= bins.size())
+        bins.resize(b + 1, 0);
+      bins[b]++;
+      _total += c;
+    }
+
+    _median = sorted[n / 2];
+    _p99    = sorted[std::min(n - 1, n * 99 / 100)];
+    _max    = sorted.back();
+  }
+
+  /**
+   * Makes a false color picture of the costs. The scale runs from black for
+   * free pixels through blue, cyan, green and yellow to red. It ends at the
+   * 99th percentile instead of the most expensive pixel so that a handful of
+   * outliers do not wash out the rest of the picture.
+   *
+   * @return  the picture, the same size as the picture that was measured
+   */
+  Matrix<Pixel> CostMap::heatmap() const {
+    Matrix<Pixel> ret(cost.rows(), cost.cols());
+    double top = double(std::max(_p99, uint64_t(1)));
+
+    for(uint32_t i = 0; i < cost.rows(); i++) {
+      for(uint32_t j = 0; j < cost.cols(); j++) {
+        double t   = std::min(double(cost[i][j]) / top, 1.0) * (nscale - 1);
+        int    lo  = std::min(int(t), nscale - 2);
+        double mix = t - lo;
+
+        ret[i][j] = Pixel(
+            uint8_t(scale[lo][0] + (scale[lo + 1][0] - scale[lo][0]) * mix),
+            uint8_t(scale[lo][1] + (scale[lo + 1][1] - scale[lo][1]) * mix),
+            uint8_t(scale[lo][2] + (scale[lo + 1][2] - scale[lo][2]) * mix));
+      }
+    }
+
+    return ret;
+  }
+
+  /**
+   * Prints a summary of the costs followed by a histogram with a row for each
+   * power of two range of cost, starting at the cheapest pixel.
+   *
+   * @param ostr   where to print
+   * @param width  the length of the longest bar
+   */
+  void CostMap::histogram(std::ostream& ostr, uint32_t width) const {
+    uint64_t n       = uint64_t(cost.rows()) * cost.cols();
+    uint64_t largest = bins.empty() ? 1 : *std::max_element(bins.begin(), bins.end());
+    const char* unit = stats::costUnit();
+
+    ostr << "Pixel cost (" << unit << "): total " << _total
+         << ", mean " << (n ? _total / n : 0)
+         << ", median " << _median
+         << ", 99th percentile " << _p99
+         << ", max " << _max << std::endl;
+
+    uint32_t first = 0;
+    while(first < bins.size() && bins[first] == 0)
+      first++;
+
+    for(uint32_t b = first; b < bins.size(); b++) {
+      uint64_t lo = b == 0 ? 0 : uint64_t(1) << b;
+      uint64_t hi = uint64_t(1) << (b + 1);
+
+      ostr << "  [" << std::setw(12) << lo << ", " << std::setw(12) << hi << ") "
+           << std::setw(10) << bins[b] << " "
+           << std::string(bins[b] * width / largest, '#') << std::endl;
+    }
+  }
+
+}
@@ -0,0 +1,50 @@
+/*
+ * CostMap.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Camera.hpp>
+#include <Matrix.tpp>
+
+/* std includes */
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+
+namespace ray {
+
+  /**
+   * The cost of rendering every pixel of a picture, taken from Model::cost
+   * after a render with the measureCost option set. This turns the costs into
+   * a false color picture and a histogram so that the expensive parts of a
+   * picture can be found.
+   */
+  class CostMap {
+    public:
+
+      CostMap(const Matrix<uint64_t>& cost);
+
+      Matrix<Pixel> heatmap() const;
+      void histogram(std::ostream& ostr, uint32_t width = 50) const;
+
+      inline uint64_t total()  const { return _total;  }
+      inline uint64_t median() const { return _median; }
+      inline uint64_t p99()    const { return _p99;    }
+      inline uint64_t max()    const { return _max;    }
+
+    private:
+
+      Matrix<uint64_t> cost;
+
+      uint64_t _total, _median, _p99, _max;
+
+      /** the number of pixels in each power of two range of cost */
+      std::vector<uint64_t> bins;
+  };
+
+}
@@ -0,0 +1,89 @@
+/*
+ * FrameCache.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Camera.hpp>
+#include <Surface.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <vector>
+
+namespace ray {
+
+  /**
+   * What the camera Ray for a single pixel hit in the last frame.
+   */
+  struct CacheSample {
+    CacheSample() :
+      position(), normal(), surface(nullptr), instance(nullptr), color(), valid(false) { }
+
+    /** where the Ray hit in world coordinates */
+    Vector position;
+
+    /** the normal of the Surface at the hit */
+    Vector normal;
+
+    /** the Surface that was hit */
+    const Surface* surface;
+
+    /** the Instance that placed the Surface */
+    const Instance* instance;
+
+    /** the color that the pixel was shaded with */
+    Vector color;
+
+    /** false if the Ray did not hit anything */
+    bool valid;
+  };
+
+  /**
+   * Keeps the hits of the last frame rendered by Model::click so that the next
+   * frame can reuse them. When the Camera moves, the cached hits are projected
+   * through the new Camera and only the pixels that nothing lands on are
+   * traced again. The colors of reused pixels are kept as they were, so the
+   * result is meant for interaction and a full frame should be rendered once
+   * the Camera stops moving. The cache must be invalidated whenever the Model
+   * itself changes.
+   */
+  class FrameCache {
+    public:
+
+      FrameCache(double minCoverage = 0.5) :
+        camera(), rows(0), cols(0), samples(), _minCoverage(minCoverage), _reused(0) { }
+
+      /** forget the last frame so that the next one is rendered in full */
+      inline void invalidate() { samples.clear(); }
+
+      /* getters */
+      inline bool        empty() const { return samples.empty(); }
+      inline double minCoverage() const { return _minCoverage;    }
+      inline double      reused() const { return _reused;         }
+
+    private:
+
+      friend class Model;
+
+      /** the Camera for the last frame */
+      Camera camera;
+
+      /** the size of the last frame */
+      int rows, cols;
+
+      /** one sample for every pixel of the last frame */
+      std::vector<CacheSample> samples;
+
+      /** the fraction of the last hits that must be reused, otherwise render in full */
+      double _minCoverage;
+
+      /** the fraction of the hits before the last frame that it reused */
+      double _reused;
+  };
+
+}
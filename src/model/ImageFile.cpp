@@ -0,0 +1,367 @@
+/*
+ * ImageFile.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <ImageFile.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+/* other */
+#include <zlib.h>
+
+namespace ray {
+
+  /**
+   * Writes a picture as a binary ppm.
+   *
+   * @param ostr   the stream to write to
+   * @param image  the picture
+   * @return       false if the write failed
+   */
+  bool writePPM(std::ostream& ostr, const Matrix<Pixel>& image) {
+    std::vector<char> row(image.cols() * 3);
+
+    ostr << "P6\n" << image.cols() << " " << image.rows() << "\n255\n";
+    for(uint32_t i = 0; i < image.rows(); i++) {
+      for(uint32_t j = 0; j < image.cols(); j++) {
+        row[j * 3]     = char(image[i][j].r());
+        row[j * 3 + 1] = char(image[i][j].g());
+        row[j * 3 + 2] = char(image[i][j].b());
+      }
+
+      ostr.write(row.data(), row.size());
+    }
+
+    return bool(ostr);
+  }
+
+  bool writePPM(const std::string& fileName, const Matrix<Pixel>& image) {
+    std::ofstream ostr(fileName.c_str(), std::ios::binary);
+    return writePPM(ostr, image);
+  }
+
+  /** the largest number of rows or columns that readPPM accepts */
+  static const uint32_t maxSide = 1 << 15;
+
+  /**
+   * Reads the next number of a ppm header, skipping the whitespace and the
+   * comments, which run from a # to the end of the line, in front of it.
+   *
+   * @param istr   the stream to read from
+   * @param value  return for the number
+   * @return       false if there is no number
+   */
+  static bool headerValue(std::istream& istr, uint32_t& value) {
+    while(istr >> std::ws && istr.peek() == '#')
+      istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+    return bool(istr >> value);
+  }
+
+  /**
+   * Reads a binary ppm with 8 bits for each channel.
+   *
+   * @param istr   the stream to read from
+   * @param image  return for the picture
+   * @return       false if the stream is not a ppm that can be read
+   */
+  bool readPPM(std::istream& istr, Matrix<Pixel>& image) {
+    std::string magic;
+    uint32_t cols, rows, depth;
+
+    if(!(istr >> magic) || magic != "P6" ||
+       !headerValue(istr, cols) || !headerValue(istr, rows) || !headerValue(istr, depth) ||
+       depth != 255 || cols == 0 || rows == 0 || cols > maxSide || rows > maxSide)
+      return false;
+    istr.get();
+
+    std::vector<unsigned char> row(size_t(cols) * 3);
+    Matrix<Pixel> read(rows, cols);
+
+    for(uint32_t i = 0; i < rows; i++) {
+      if(!istr.read(reinterpret_cast<char*>(row.data()), row.size()))
+        return false;
+
+      for(uint32_t j = 0; j < cols; j++)
+        read[i][j] = Pixel(row[j * 3], row[j * 3 + 1], row[j * 3 + 2]);
+    }
+
+    image = read;
+    return true;
+  }
+
+  bool readPPM(const std::string& fileName, Matrix<Pixel>& image) {
+    std::ifstream istr(fileName.c_str(), std::ios::binary);
+    return readPPM(istr, image);
+  }
+
+  /**
+   * Writes a binary ppm as its rows arrive.
+   */
+  class PPMWriter : public ImageWriter {
+    public:
+
+      PPMWriter(const std::string& fileName, uint32_t rows, uint32_t cols) :
+          ImageWriter(rows, cols), row(cols * 3) {
+        ostr.open(fileName.c_str(), std::ios::binary);
+        ostr << "P6\n" << cols << " " << rows << "\n255\n";
+      }
+
+      virtual bool write(const Matrix<Pixel>& band) {
+        if(band.cols() != _cols || _written + band.rows() > _rows)
+          return false;
+
+        for(uint32_t i = 0; i < band.rows(); i++) {
+          for(uint32_t j = 0; j < _cols; j++) {
+            row[j * 3]     = char(band[i][j].r());
+            row[j * 3 + 1] = char(band[i][j].g());
+            row[j * 3 + 2] = char(band[i][j].b());
+          }
+
+          ostr.write(row.data(), row.size());
+        }
+
+        _written += band.rows();
+        return bool(ostr);
+      }
+
+      virtual bool close() {
+        ostr.close();
+        return _written == _rows && bool(ostr);
+      }
+
+    private:
+
+      std::vector<char> row;
+  };
+
+  /**
+   * Writes a pfm as its rows arrive. A pfm is stored from the bottom row up,
+   * so each row is put in its place in the file instead of at the end. The
+   * channels are the 8 bits of a Pixel as a float from 0 to 1.
+   */
+  class PFMWriter : public ImageWriter {
+    public:
+
+      PFMWriter(const std::string& fileName, uint32_t rows, uint32_t cols) :
+          ImageWriter(rows, cols), row(cols * 3), start(0) {
+        const uint16_t one = 1;
+        bool little = *reinterpret_cast<const uint8_t*>(&one) == 1;
+
+        ostr.open(fileName.c_str(), std::ios::binary);
+        ostr << "PF\n" << cols << " " << rows << "\n" << (little ? "-1.0" : "1.0") << "\n";
+        start = ostr.tellp();
+      }
+
+      virtual bool write(const Matrix<Pixel>& band) {
+        if(band.cols() != _cols || _written + band.rows() > _rows)
+          return false;
+
+        for(uint32_t i = 0; i < band.rows(); i++) {
+          for(uint32_t j = 0; j < _cols; j++) {
+            row[j * 3]     = band[i][j].r() / 255.0f;
+            row[j * 3 + 1] = band[i][j].g() / 255.0f;
+            row[j * 3 + 2] = band[i][j].b() / 255.0f;
+          }
+
+          std::streamoff bytes = std::streamoff(row.size()) * sizeof(float);
+          ostr.seekp(start + std::streamoff(_rows - 1 - (_written + i)) * bytes);
+          ostr.write(reinterpret_cast<const char*>(row.data()), bytes);
+        }
+
+        _written += band.rows();
+        return bool(ostr);
+      }
+
+      virtual bool close() {
+        ostr.close();
+        return _written == _rows && bool(ostr);
+      }
+
+    private:
+
+      std::vector<float> row;
+      std::streamoff     start;
+  };
+
+  /**
+   * Writes a png as its rows arrive. Every row is filtered against the row
+   * above it and all of them go through a single deflate stream, which is
+   * written out in IDAT chunks as it fills up, so nothing but the last row
+   * and the chunk being filled is kept.
+   */
+  class PNGWriter : public ImageWriter {
+    public:
+
+      PNGWriter(const std::string& fileName, uint32_t rows, uint32_t cols) :
+          ImageWriter(rows, cols), z(), row(cols * 3 + 1), prev(cols * 3, 0),
+          out(1 << 16), started(false) {
+        static const char signature[8] = { '\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n' };
+
+        ostr.open(fileName.c_str(), std::ios::binary);
+        ostr.write(signature, 8);
+
+        /* 8 bits for each of red, green and blue, no interlacing */
+        unsigned char header[13] = { 0 };
+        put(header, cols);
+        put(header + 4, rows);
+        header[8] = 8;
+        header[9] = 2;
+        chunk("IHDR", header, sizeof(header));
+
+        started = deflateInit(&z, Z_DEFAULT_COMPRESSION) == Z_OK;
+        z.next_out  = out.data();
+        z.avail_out = out.size();
+      }
+
+      virtual ~PNGWriter() {
+        if(started)
+          deflateEnd(&z);
+      }
+
+      virtual bool write(const Matrix<Pixel>& band) {
+        if(!started || band.cols() != _cols || _written + band.rows() > _rows)
+          return false;
+
+        /* the up filter, each byte less the one above it */
+        row[0] = 2;
+        for(uint32_t i = 0; i < band.rows(); i++) {
+          for(uint32_t j = 0; j < _cols; j++) {
+            const unsigned char rgb[3] = { band[i][j].r(), band[i][j].g(), band[i][j].b() };
+
+            for(uint32_t k = 0; k < 3; k++) {
+              row[j * 3 + k + 1] = rgb[k] - prev[j * 3 + k];
+              prev[j * 3 + k]    = rgb[k];
+            }
+          }
+
+          if(!compress(row.data(), row.size(), Z_NO_FLUSH))
+            return false;
+        }
+
+        _written += band.rows();
+        return bool(ostr);
+      }
+
+      virtual bool close() {
+        bool ret = started && _written == _rows && compress(nullptr, 0, Z_FINISH);
+
+        emit();
+        chunk("IEND", nullptr, 0);
+        ostr.close();
+
+        return ret && bool(ostr);
+      }
+
+    private:
+
+      /** a number in the big endian order of a png */
+      static void put(unsigned char* dst, uint32_t value) {
+        dst[0] = value >> 24;
+        dst[1] = value >> 16;
+        dst[2] = value >> 8;
+        dst[3] = value;
+      }
+
+      void chunk(const char* type, const unsigned char* data, uint32_t size) {
+        unsigned char word[4];
+
+        uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+        if(size)
+          crc = crc32(crc, data, size);
+
+        put(word, size);
+        ostr.write(reinterpret_cast<const char*>(word), 4);
+        ostr.write(type, 4);
+        ostr.write(reinterpret_cast<const char*>(data), size);
+        put(word, crc);
+        ostr.write(reinterpret_cast<const char*>(word), 4);
+      }
+
+      /** writes what has been compressed so far as an IDAT chunk */
+      void emit() {
+        uint32_t size = out.size() - z.avail_out;
+        if(size)
+          chunk("IDAT", out.data(), size);
+
+        z.next_out  = out.data();
+        z.avail_out = out.size();
+      }
+
+      bool compress(const unsigned char* data, uint32_t size, int flush) {
+        z.next_in  = const_cast<Bytef*>(data);
+        z.avail_in = size;
+
+        for(;;) {
+          if(z.avail_out == 0)
+            emit();
+
+          int ret = deflate(&z, flush);
+          if(ret == Z_STREAM_ERROR)
+            return false;
+
+          if(flush == Z_FINISH ? ret == Z_STREAM_END : z.avail_in == 0)
+            return bool(ostr);
+        }
+      }
+
+      z_stream                   z;
+      std::vector<unsigned char> row;
+      std::vector<unsigned char> prev;
+      std::vector<unsigned char> out;
+      bool                       started;
+  };
+
+  /** the lower case extension of a file name, without the dot */
+  static std::string extension(const std::string& fileName) {
+    size_t dot = fileName.find_last_of("./");
+    if(dot == std::string::npos || fileName[dot] != '.')
+      return "";
+
+    std::string ret = fileName.substr(dot + 1);
+    std::transform(ret.begin(), ret.end(), ret.begin(), ::tolower);
+    return ret;
+  }
+
+  /**
+   * Opens a picture to be written a band at a time.
+   *
+   * @param fileName  the file, its extension picks ppm, pfm or png
+   * @param rows      the number of rows in the picture
+   * @param cols      the number of columns in the picture
+   * @return          the writer, or null if the format is unknown or the
+   *                  file could not be opened
+   */
+  ImageWriter::ptr ImageWriter::open(const std::string& fileName, uint32_t rows, uint32_t cols) {
+    std::string ext = extension(fileName);
+    ptr ret;
+
+    if(ext == "ppm") {
+      ret.reset(new PPMWriter(fileName, rows, cols));
+    } else if(ext == "pfm") {
+      ret.reset(new PFMWriter(fileName, rows, cols));
+    } else if(ext == "png") {
+      ret.reset(new PNGWriter(fileName, rows, cols));
+    }
+
+    if(ret && !ret->ostr)
+      ret.reset();
+    return ret;
+  }
+
+  /** checks if a file name has an extension that open can write */
+  bool ImageWriter::supports(const std::string& fileName) {
+    std::string ext = extension(fileName);
+    return ext == "ppm" || ext == "pfm" || ext == "png";
+  }
+
+}
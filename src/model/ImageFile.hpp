@@ -0,0 +1,82 @@
+/*
+ * ImageFile.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Camera.hpp>
+#include <Matrix.tpp>
+
+/* std includes */
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+namespace ray {
+
+  /*
+   * Pictures as binary ppm files. These need nothing but the standard
+   * library, unlike saving through gtk, so they are used by the tools that
+   * run without a display.
+   */
+
+  bool writePPM(std::ostream& ostr, const Matrix<Pixel>& image);
+  bool writePPM(const std::string& fileName, const Matrix<Pixel>& image);
+  bool readPPM (std::istream& istr, Matrix<Pixel>& image);
+  bool readPPM (const std::string& fileName, Matrix<Pixel>& image);
+
+  /**
+   * Writes a picture a band of rows at a time, so that only a band has to be
+   * in memory instead of the whole picture. The bands are written top to
+   * bottom and must add up to the rows given when the file was opened. The
+   * format comes from the extension of the file name: a binary ppm, a pfm
+   * with a float for each channel, or a png.
+   */
+  class ImageWriter {
+    public:
+
+      typedef std::unique_ptr<ImageWriter> ptr;
+
+      static ptr  open(const std::string& fileName, uint32_t rows, uint32_t cols);
+      static bool supports(const std::string& fileName);
+
+      virtual ~ImageWriter() { }
+
+      ImageWriter(const ImageWriter& writer) = delete;
+      const ImageWriter& operator =(const ImageWriter& writer) = delete;
+
+      /**
+       * Writes the next rows of the picture.
+       *
+       * @param band  the rows, as wide as the picture
+       * @return      false if the write failed
+       */
+      virtual bool write(const Matrix<Pixel>& band) = 0;
+
+      /**
+       * Finishes the file once every row has been written.
+       *
+       * @return  false if rows are missing or the write failed
+       */
+      virtual bool close() = 0;
+
+      inline uint32_t    rows() const { return _rows;    }
+      inline uint32_t    cols() const { return _cols;    }
+      inline uint32_t written() const { return _written; }
+
+    protected:
+
+      ImageWriter(uint32_t rows, uint32_t cols) :
+        ostr(), _rows(rows), _cols(cols), _written(0) { }
+
+      std::ofstream ostr;
+      uint32_t      _rows, _cols, _written;
+  };
+
+}
@@ -0,0 +1,168 @@
+/*
+ * LightTree.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <LightTree.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+namespace ray {
+
+  /**
+   * Builds the tree for a set of Lights.
+   *
+   * @param lights  the Lights of a Model
+   */
+  LightTree::LightTree(const std::vector<Light>& lights) :
+      merged(), _nodes()
+  {
+    typedef std::tuple<double, double, double> key_t;
+    std::map<key_t, uint32_t> seen;
+
+    for(const Light& light : lights) {
+      key_t key(light.local().x(), light.local().y(), light.local().z());
+      auto iter = seen.find(key);
+
+      if(iter == seen.end()) {
+        seen[key] = merged.size();
+        merged.push_back(light);
+      } else {
+        const Light& prev = merged[iter->second];
+        merged[iter->second] = Light(prev.local(), prev.illum() + light.illum());
+      }
+    }
+
+    if(merged.empty())
+      return;
+
+    std::vector<uint32_t> order(merged.size());
+    for(uint32_t i = 0; i < order.size(); i++)
+      order[i] = i;
+
+    _nodes.reserve(2 * merged.size() - 1);
+    build(order, 0, order.size());
+  }
+
+  /**
+   * Finds the largest value that the absolute cosine between a normal and the
+   * direction to any Light in a cluster can have.
+   *
+   * @param node  the index of the cluster
+   * @param p     the shading point
+   * @param n     the normal at the shading point
+   * @return      a bound between 0 and 1
+   */
+  double LightTree::cosineBound(uint32_t node, const Vector& p, const Vector& n) const {
+    const Node& curr = _nodes[node];
+    Vector t = n.getPerpendicular().normalize();
+    Vector b = cross(n, t);
+    Vector lo, hi;
+
+    if(p.x() >= curr.lo.x() && p.x() <= curr.hi.x() &&
+       p.y() >= curr.lo.y() && p.y() <= curr.hi.y() &&
+       p.z() >= curr.lo.z() && p.z() <= curr.hi.z())
+      return 1.0;
+
+    /* bounds of the cluster in a frame where the normal is z */
+    for(int i = 0; i < 8; i++) {
+      Vector d = Vector(
+          i & 1 ? curr.hi.x() : curr.lo.x(),
+          i & 2 ? curr.hi.y() : curr.lo.y(),
+          i & 4 ? curr.hi.z() : curr.lo.z()) - p;
+      Vector f(dot(d, t), dot(d, b), dot(d, n));
+
+      lo = i == 0 ? f : ray::min(lo, f);
+      hi = i == 0 ? f : ray::max(hi, f);
+    }
+
+    double z  = std::max(std::fabs(lo.z()), std::fabs(hi.z()));
+    double x  = lo.x() > 0 ? lo.x() : hi.x() < 0 ? -hi.x() : 0.0;
+    double y  = lo.y() > 0 ? lo.y() : hi.y() < 0 ? -hi.y() : 0.0;
+    double r2 = x * x + y * y;
+
+    if(z == 0.0)
+      return r2 == 0.0 ? 1.0 : 0.0;
+
+    return z / std::sqrt(z * z + r2);
+  }
+
+  /**
+   * Bounds how far the light of a cluster can be from its estimate, which is
+   * what decides the next cluster to split in a cut. A single Light is exact.
+   *
+   * @param node  the index of the cluster
+   * @param m     the material at the shading point
+   * @param p     the shading point
+   * @param n     the normal at the shading point
+   * @return      the bound on the error
+   */
+  double LightTree::error(uint32_t node, const Phong& m, const Vector& p, const Vector& n) const {
+    const Node& curr = _nodes[node];
+    return curr.left < 0 ? 0.0 : curr.intensity * (m.kd * cosineBound(node, p, n) + m.ks);
+  }
+
+  /**
+   * Builds the cluster for a range of Lights.
+   *
+   * @param order  the indices of the Lights, reordered while building
+   * @param begin  the first Light in the cluster
+   * @param end    one past the last Light in the cluster
+   * @return       the index of the new cluster
+   */
+  int32_t LightTree::build(std::vector<uint32_t>& order, uint32_t begin, uint32_t end) {
+    int32_t idx = _nodes.size();
+    _nodes.push_back(Node());
+
+    if(end - begin == 1) {
+      const Light& light = merged[order[begin]];
+      Node& leaf = _nodes[idx];
+
+      leaf.lo = leaf.hi = leaf.local = light.local();
+      leaf.illum     = light.illum();
+      leaf.intensity = std::max(light.illum().x(), std::max(light.illum().y(), light.illum().z()));
+      leaf.left      = -1;
+      leaf.right     = -1;
+      return idx;
+    }
+
+    Vector lo = merged[order[begin]].local();
+    Vector hi = lo;
+    for(uint32_t i = begin + 1; i < end; i++) {
+      lo = ray::min(lo, merged[order[i]].local());
+      hi = ray::max(hi, merged[order[i]].local());
+    }
+
+    Vector len  = hi - lo;
+    int    axis = len.x() > len.y() ? (len.x() > len.z() ? 0 : 2) : (len.y() > len.z() ? 1 : 2);
+    uint32_t mid = (begin + end) / 2;
+
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+        [&](uint32_t l, uint32_t r) { return merged[l].local()[axis] < merged[r].local()[axis]; });
+
+    int32_t left  = build(order, begin, mid);
+    int32_t right = build(order, mid, end);
+
+    const Node& l = _nodes[left];
+    const Node& r = _nodes[right];
+    Node& node = _nodes[idx];
+
+    node.lo        = lo;
+    node.hi        = hi;
+    node.local     = l.intensity >= r.intensity ? l.local : r.local;
+    node.illum     = l.illum + r.illum;
+    node.intensity = std::max(node.illum.x(), std::max(node.illum.y(), node.illum.z()));
+    node.left      = left;
+    node.right     = right;
+
+    return idx;
+  }
+
+}
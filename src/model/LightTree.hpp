@@ -0,0 +1,74 @@
+/*
+ * LightTree.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Model.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+namespace ray {
+
+  /**
+   * Binary tree of clusters of Lights. Lights that are in exactly the same
+   * place are merged into a single Light first, the rest are split along the
+   * longest side of their bounds until every leaf holds a single Light. Every
+   * cluster is represented by one of its Lights carrying the total
+   * illumination of the cluster, so a shading point can choose a cut through
+   * the tree and only cast one shadow Ray for each cluster in the cut.
+   */
+  class LightTree {
+    public:
+
+      typedef std::shared_ptr<LightTree> ptr;
+
+      struct Node {
+        /** the corners of the bounds of the Lights in the cluster */
+        Vector lo, hi;
+
+        /** the Light standing in for the cluster */
+        Vector local;
+
+        /** the total illumination of the cluster */
+        Vector illum;
+
+        /** the largest channel of illum */
+        double intensity;
+
+        /** the children of the cluster, -1 for a leaf */
+        int32_t left, right;
+      };
+
+      LightTree(const std::vector<Light>& lights);
+
+      double cosineBound(uint32_t node, const Vector& p, const Vector& n) const;
+      double error(uint32_t node, const Phong& m, const Vector& p, const Vector& n) const;
+
+      /* getters */
+      inline const std::vector<Light>& lights() const { return merged; }
+      inline const std::vector<Node>&   nodes() const { return _nodes; }
+      inline bool                       empty() const { return _nodes.empty(); }
+
+      inline const Node& operator[](uint32_t idx) const { return _nodes[idx]; }
+
+    private:
+
+      int32_t build(std::vector<uint32_t>& order, uint32_t begin, uint32_t end);
+
+      /** the Lights after coincident ones have been merged */
+      std::vector<Light> merged;
+
+      /** the clusters, the root is the first */
+      std::vector<Node> _nodes;
+  };
+
+}
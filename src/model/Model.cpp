@@ -6,11 +6,21 @@
  */
 
 /* local includes */
+#include <FrameCache.hpp>
+#include <LightTree.hpp>
 #include <ObjectStream.hpp>
 #include <Model.hpp>
+#include <Morton.hpp>
+#include <Raster.hpp>
 #include <Ray.hpp>
+#include <Stats.hpp>
+#include <Timeline.hpp>
 #include <Debug.hpp>
 
+/* std includes */
+#include <algorithm>
+#include <memory>
+
 /* boost includes */
 #include <boost/thread/thread.hpp>
 #include <boost/bind.hpp>
@@ -36,6 +46,46 @@ namespace ray {
     return ret;
   }
 
+  Phong::Phong(const Material& m) :
+      ks(m.ks()),
+      alpha(m.alpha()),
+      kd(0.0)
+  {
+    const Matrix<double>& d = m.diffuse();
+
+    for(int i = 0; i < 3; i++) {
+      for(int j = 0; j < 3; j++)
+        diffuse[i][j] = d[i][j];
+      kd = std::max(kd, std::fabs(diffuse[i][0]) + std::fabs(diffuse[i][1]) + std::fabs(diffuse[i][2]));
+    }
+  }
+
+  /**
+   * Calculates the light reflected toward the viewer from a Light that is not
+   * blocked. The color channels are worked out in a flat loop.
+   *
+   * @param Lp     the direction to the Light
+   * @param illum  the illumination of the Light
+   * @param v      the direction back along the incoming Ray
+   * @param n      the normal, facing the incoming Ray
+   * @return       the reflected light
+   */
+  Vector Phong::reflect(const Vector& Lp, const Vector& illum, const Vector& v, const Vector& n) const {
+    Vector Rl = (n * (dot(Lp, n) * 2) - Lp).normalize();
+
+    double cosine   = dot(Lp, n);
+    double specular = ks > 0 ? std::pow(std::max(double(0.0), dot(v, Rl)), alpha) : 0.0;
+    double in[3]    = { illum.x(), illum.y(), illum.z() };
+    double out[3];
+
+    for(int c = 0; c < 3; c++) {
+      double d = diffuse[c][0] * in[0] + diffuse[c][1] * in[1] + diffuse[c][2] * in[2];
+      out[c] = d * cosine + in[c] * ks * specular;
+    }
+
+    return Vector(out[0], out[1], out[2]);
+  }
+
   /**
    * Gets a bounding box for the entire model. This will find a bounding box
    * that contains all of the surfaces contained within the model.
@@ -43,20 +93,40 @@ namespace ray {
    * @return  The bounding box
    */
   Box Model::getBounds() const {
+    if(!surfaces)
+      return Box();
     return surfaces->getBounds();
   }
 
+  /**
+   * Finds the closest Surface that a Ray hits, for callers that follow their
+   * own Rays through the Model instead of rendering a picture.
+   *
+   * @param ray   the Ray
+   * @param best  return for the closest Intersection
+   * @return      true if the Ray hit something
+   */
+  bool Model::intersect(const Ray& ray, Intersection& best) const {
+    return surfaces && surfaces->intersect(ray, best);
+  }
+
   bool Model::renderSection(
       const Matrix<Ray>& rays,
       Matrix<Pixel>& out,
       uint32_t minRow,
-      uint32_t maxRow) const
+      uint32_t maxRow,
+      const Raster* raster,
+      std::vector<CacheSample>* hits,
+      RenderContext* ctx) const
   {
+    STATS_SCOPE(stats, ctx->stats);
+    TIMELINE_SCOPE_ARG("section", minRow);
+
     for(int i = minRow; i < maxRow; i++) {
       for(int j = 0; j < rays.cols(); j++) {
         DEBUG_SECTION(sect, i == ROW_DEBUG && j == COL_DEBUG);
 
-        out[i][j] = Pixel(calculateColor(rays[i][j]));
+        renderPixel(rays, out, i, j, raster, hits, *ctx);
       }
     }
 
@@ -76,36 +146,332 @@ namespace ray {
     return true;
   }
 
+  /**
+   * Renders a single pixel of the image.
+   *
+   * @param rays    the camera Rays for the picture
+   * @param out     return for the picture
+   * @param row     the row of the pixel
+   * @param col     the column of the pixel
+   * @param raster  the filled visibility buffer, or null to trace
+   * @param hits    return for the first hits, or null if they are not needed
+   * @param ctx     the context of the thread
+   */
+  void Model::renderPixel(
+      const Matrix<Ray>& rays,
+      Matrix<Pixel>& out,
+      uint32_t row,
+      uint32_t col,
+      const Raster* raster,
+      std::vector<CacheSample>* hits,
+      RenderContext& ctx) const
+  {
+    stats::cost_scope cost(costOf(row, col));
+
+    Intersection best;
+    Vector       color(0, 0, 0);
+    bool         hit = firstHit(rays[row][col], raster, row, col, best);
+
+    if(hit)
+      color = calculateColor(best, ctx);
+
+    out[row][col] = Pixel(color);
+
+    if(hits) {
+      CacheSample& sample = (*hits)[row * rays.cols() + col];
+
+      sample.color = color;
+      if(hit) {
+        sample.position = best.i();
+        sample.normal   = best.n();
+        sample.surface  = best.source();
+        sample.instance = static_cast<const Instance*>(best.instance());
+        sample.valid    = true;
+      }
+    }
+  }
+
+  /**
+   * Orders the tiles of an image and the pixels of a tile. Both follow the
+   * same curve, the tiles through the smallest power of two grid that covers
+   * the image, skipping the cells that are outside of it.
+   *
+   * @param order  the curve to follow
+   * @param rows   the number of rows in the image
+   * @param cols   the number of columns in the image
+   */
+  TileOrder::TileOrder(RenderOptions::Order order, uint32_t rows, uint32_t cols) :
+      tiles(),
+      pixels(),
+      cols((cols + RENDER_TILE - 1) / RENDER_TILE)
+  {
+    uint32_t tileRows = (rows + RENDER_TILE - 1) / RENDER_TILE;
+    uint32_t tileCols = this->cols;
+    uint32_t grid     = 1;
+
+    while(grid < tileRows || grid < tileCols)
+      grid *= 2;
+
+    auto key = [&](uint32_t n, uint32_t row, uint32_t col) {
+      switch(order) {
+        case RenderOptions::morton:  return morton2(col, row);
+        case RenderOptions::hilbert: return hilbert2(n, col, row);
+        default:                     return row * n + col;
+      }
+    };
+
+    std::vector<std::pair<uint32_t, uint32_t> > keyed;
+
+    for(uint32_t i = 0; i < tileRows; i++)
+      for(uint32_t j = 0; j < tileCols; j++)
+        keyed.push_back(std::make_pair(key(grid, i, j), i * tileCols + j));
+    std::sort(keyed.begin(), keyed.end());
+
+    for(const auto& tile : keyed)
+      tiles.push_back(tile.second);
+
+    keyed.clear();
+    for(uint32_t i = 0; i < RENDER_TILE; i++)
+      for(uint32_t j = 0; j < RENDER_TILE; j++)
+        keyed.push_back(std::make_pair(key(RENDER_TILE, i, j), i * RENDER_TILE + j));
+    std::sort(keyed.begin(), keyed.end());
+
+    for(const auto& pixel : keyed)
+      pixels.push_back(pixel.second);
+  }
+
+  /**
+   * Renders a range of the tiles of an image.
+   *
+   * @param rays    the camera Rays for the picture
+   * @param out     return for the picture
+   * @param order   the order of the tiles and of the pixels in a tile
+   * @param begin   the first tile in the order to render
+   * @param end     one past the last tile in the order to render
+   * @param raster  the filled visibility buffer, or null to trace
+   * @param hits    return for the first hits, or null if they are not needed
+   * @param ctx     the context of the thread
+   */
+  bool Model::renderTiles(
+      const Matrix<Ray>& rays,
+      Matrix<Pixel>& out,
+      const TileOrder* order,
+      uint32_t begin,
+      uint32_t end,
+      const Raster* raster,
+      std::vector<CacheSample>* hits,
+      RenderContext* ctx) const
+  {
+    STATS_SCOPE(stats, ctx->stats);
+
+    for(uint32_t k = begin; k < end; k++) {
+      TIMELINE_SCOPE_ARG("tile", order->tiles[k]);
+
+      uint32_t row = (order->tiles[k] / order->cols) * RENDER_TILE;
+      uint32_t col = (order->tiles[k] % order->cols) * RENDER_TILE;
+
+      if(opts.batchRays) {
+        renderTile(rays, out, row, col, order->pixels, raster, hits, *ctx);
+        continue;
+      }
+
+      for(uint16_t offset : order->pixels) {
+        uint32_t i = row + offset / RENDER_TILE;
+        uint32_t j = col + offset % RENDER_TILE;
+
+        if(i < rays.rows() && j < rays.cols())
+          renderPixel(rays, out, i, j, raster, hits, *ctx);
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Renders a tile of the image with the reflections of every pixel in the
+   * tile followed together by calculateColors.
+   *
+   * @param rays    the camera Rays for the picture
+   * @param out     return for the picture
+   * @param row     the first row of the tile
+   * @param col     the first column of the tile
+   * @param pixels  the order of the pixels in the tile
+   * @param raster  the filled visibility buffer, or null to trace
+   * @param hits    return for the first hits, or null if they are not needed
+   * @param ctx     the context of the thread
+   */
+  void Model::renderTile(
+      const Matrix<Ray>& rays,
+      Matrix<Pixel>& out,
+      uint32_t row,
+      uint32_t col,
+      const std::vector<uint16_t>& pixels,
+      const Raster* raster,
+      std::vector<CacheSample>* hits,
+      RenderContext& ctx) const
+  {
+    std::vector<Intersection> first;
+    std::vector<uint32_t>     indices;
+    std::vector<Vector>       colors;
+
+    for(uint16_t offset : pixels) {
+      uint32_t i = row + offset / RENDER_TILE;
+      uint32_t j = col + offset % RENDER_TILE;
+      Intersection best;
+
+      if(i >= rays.rows() || j >= rays.cols())
+        continue;
+
+      stats::cost_scope cost(costOf(i, j));
+
+      out[i][j] = Pixel(0, 0, 0);
+      if(!firstHit(rays[i][j], raster, i, j, best))
+        continue;
+
+      if(hits) {
+        CacheSample& sample = (*hits)[i * rays.cols() + j];
+
+        sample.position = best.i();
+        sample.normal   = best.n();
+        sample.surface  = best.source();
+        sample.instance = static_cast<const Instance*>(best.instance());
+        sample.valid    = true;
+      }
+
+      first.push_back(best);
+      indices.push_back(i * rays.cols() + j);
+    }
+
+    uint64_t shared = 0;
+    {
+      stats::cost_scope cost(opts.measureCost ? &shared : nullptr);
+      calculateColors(first, colors, ctx);
+    }
+
+    /* the bounces are shaded together, so their cost is split evenly */
+    for(uint32_t k = 0; k < indices.size(); k++) {
+      if(opts.measureCost)
+        ncost.get()[indices[k]] += shared / indices.size();
+      out[indices[k] / rays.cols()][indices[k] % rays.cols()] = Pixel(colors[k]);
+      if(hits)
+        (*hits)[indices[k]].color = colors[k];
+    }
+  }
+
   Model::Model(
       std::vector<Light> lights,
       std::vector<Material> materials,
-      std::vector<Surface::ptr> surfs,
-      ray::Matrix<double>& vertices,
-      ray::Matrix<double>& normals) :
+      SurfaceArena::ptr arena,
+      std::vector<Mesh> meshes,
+      std::vector<Instance*> instances) :
         lights(lights),
+        lightTree(),
         materials(materials),
+        arena(arena),
         surfaces(nullptr),
-        vertices(vertices),
-        normals(normals)
+        meshes(meshes),
+        instances(instances),
+        opts(),
+        pool(),
+        nsamples(0),
+        nshadows(),
+        nstats(),
+        ncost()
   {
-    surfaces = std::make_shared<ray::SurfaceTree>(
-        surfs.begin(), surfs.end());
+    {
+      TIMELINE_SCOPE("bvh build");
+      surfaces = arena->makeTree(instances.begin(), instances.end());
+    }
+
+    TIMELINE_SCOPE("device export");
 
     std::vector<render::d_Surface>  s_transfer;
     std::vector<render::d_Material> m_transfer;
-    std::vector<render::d_Light>    l_transfer;
 
-    s_transfer.resize(Surface::idgen);
+    s_transfer.resize(arena->size());
     surfaces->place(s_transfer);
+    for(const Mesh& mesh : meshes)
+      mesh.root->place(s_transfer);
 
     for(const Material& mat : materials)
       m_transfer.push_back(render::d_Material(mat));
-    for(const Light& light: lights)
-      l_transfer.push_back(render::d_Light(light));
 
     setSurfaces (s_transfer.data(), s_transfer.size(), surfaces->id);
     setMaterials(m_transfer.data(), m_transfer.size());
-    setLights   (l_transfer.data(), l_transfer.size());
+    updateLights();
+  }
+
+  /**
+   * Rebuilds the tree of Lights and sends the merged Lights to the device.
+   * This is cheap compared to the rest of the Model so it is done after every
+   * change to the Lights.
+   */
+  void Model::updateLights() {
+    std::vector<render::d_Light> l_transfer;
+
+    lightTree = std::make_shared<LightTree>(lights);
+
+    for(const Light& light : lightTree->lights())
+      l_transfer.push_back(render::d_Light(light));
+
+    setLights(l_transfer.data(), l_transfer.size());
+  }
+
+  /**
+   * The number of parts that a picture is split into, one for each thread
+   * that renders and one for the thread that called click.
+   */
+  uint8_t Model::threadCount() const {
+    return (pool ? pool->size() : boost::thread::hardware_concurrency()) + 1;
+  }
+
+  /**
+   * Runs a job once for each part of a picture. The last part runs on the
+   * calling thread. With a WorkerPool the rest run on its threads, otherwise
+   * a thread is started for each of them.
+   *
+   * @param nthreads  the number of parts
+   * @param job       the job, called with the index of each part
+   */
+  void Model::parallel(uint8_t nthreads, const std::function<void(uint8_t)>& job) const {
+    if(pool) {
+      pool->run(nthreads, job);
+      return;
+    }
+
+    boost::thread_group threads;
+
+    for(int i = 0; i < nthreads - 1; i++)
+      threads.create_thread(boost::bind(job, uint8_t(i)));
+
+    job(nthreads - 1);
+    threads.join_all();
+  }
+
+  /**
+   * Makes a context for each thread that will render part of an image.
+   *
+   * @param nthreads  the number of threads
+   * @return          the contexts, with empty occluder caches
+   */
+  std::vector<RenderContext> Model::makeContexts(uint8_t nthreads) const {
+    uint32_t clusters = lightTree ? lightTree->nodes().size() : 0;
+    return std::vector<RenderContext>(nthreads, RenderContext(clusters));
+  }
+
+  /**
+   * Adds up the counts from the threads that rendered an image.
+   *
+   * @param contexts  the context of every thread
+   */
+  void Model::collect(const std::vector<RenderContext>& contexts) const {
+    nshadows = ShadowStats();
+    nstats   = RayStats();
+
+    for(const RenderContext& ctx : contexts) {
+      nshadows += ctx.shadows;
+      nstats   += ctx.stats;
+    }
   }
 
   /**
@@ -118,168 +484,988 @@ namespace ray {
    * @return      The resulting image.
    */
   Matrix<Pixel> Model::click(const Camera& cam, int rows, int cols) const {
+    return render(cam, rows, cols, Rect(0, 0, rows, cols));
+  }
+
+  /**
+   * Takes a picture of the model, counting only the samples of some of its
+   * pixels, for a picture that is cropped after it is taken.
+   *
+   * @param cam      The Camera to use for the picture
+   * @param rows     The number of rows in the image
+   * @param cols     The number of columns in the image
+   * @param counted  The pixels whose samples are counted
+   * @return         The resulting image.
+   */
+  Matrix<Pixel> Model::render(const Camera& cam, int rows, int cols, const Rect& counted) const {
     Matrix<Ray>   rays = cam.getRays(rows, cols);
     Matrix<Pixel> image(rays.rows(), rays.cols());
 
-    uint8_t  nthreads = boost::thread::hardware_concurrency() + 1;
+    ncost = opts.measureCost ? Matrix<uint64_t>(rows, cols, 0) : Matrix<uint64_t>();
+
+    uint8_t  nthreads = threadCount();
     uint32_t rowRange = rows / nthreads;
 
-    boost::thread_group threads;
+    std::unique_ptr<Raster> raster;
+    std::vector<RenderContext> contexts = makeContexts(nthreads);
 
-    for(int i = 0; i < nthreads - 1; i++) {
-      uint32_t rowStart = i * rowRange;
-      threads.create_thread(
-          boost::bind(&Model::renderSection, this, rays, image,
-              rowStart, rowStart + rowRange));
+    /* find the first hit for every pixel with the rasterizer */
+    if(opts.rasterize && surfaces) {
+      std::map<Surface::ptr, const Mesh*> roots;
+
+      for(const Mesh& mesh : meshes)
+        roots[mesh.root] = &mesh;
+
+      raster.reset(new Raster(cam, rows, cols));
+      for(const Instance* inst : instances)
+        raster->draw(inst, roots[inst->root()]->triangles);
+      raster->rasterize(nthreads);
     }
 
-    renderSection(rays, image, rowRange * (nthreads - 1), rows);
+    /* keep the first hits around if they will be needed to find edges */
+    std::vector<CacheSample> hits;
+    if(opts.maxSamples > 1)
+      hits.resize(rows * cols);
 
-    threads.join_all();
+    std::vector<CacheSample>* hitsp = hits.empty() ? nullptr : &hits;
+
+    TileOrder order(opts.order, rows, cols);
+    timeline::scope tracing("trace");
+
+    if(opts.order == RenderOptions::scanline && !opts.batchRays) {
+      parallel(nthreads, [&](uint8_t i) {
+        uint32_t rowStart = i * rowRange;
+        uint32_t rowEnd   = i == nthreads - 1 ? rows : rowStart + rowRange;
+        renderSection(rays, image, rowStart, rowEnd, raster.get(), hitsp, &contexts[i]);
+      });
+    } else {
+      uint32_t tileRange = order.tiles.size() / nthreads;
+
+      parallel(nthreads, [&](uint8_t i) {
+        uint32_t tileStart = i * tileRange;
+        uint32_t tileEnd   = i == nthreads - 1 ? order.tiles.size() : tileStart + tileRange;
+        renderTiles(rays, image, &order, tileStart, tileEnd, raster.get(), hitsp, &contexts[i]);
+      });
+    }
+
+    nsamples = uint64_t(counted.height) * counted.width;
+
+    /* add more samples to the pixels that sit on edges */
+    if(hitsp) {
+      TIMELINE_SCOPE("refine");
+      std::vector<uint64_t> extra(nthreads, 0);
+
+      parallel(nthreads, [&](uint8_t i) {
+        uint32_t rowStart = i * rowRange;
+        uint32_t rowEnd   = i == nthreads - 1 ? rows : rowStart + rowRange;
+        refineSection(cam, image, rowStart, rowEnd, hitsp, counted, &extra[i], &contexts[i]);
+      });
+
+      for(uint64_t count : extra)
+        nsamples += count;
+    }
+
+    collect(contexts);
+
+    return image;
+  }
+
+  /**
+   * Takes a picture of a rectangle of a larger picture. Only the Rays for the
+   * pixels of the rectangle are made, through a window of the Camera, so the
+   * pixels are the same as the ones in the whole picture. With anti-aliasing
+   * on, a pixel is refined by comparing it with its neighbors, so the
+   * rectangle is rendered with a border of one pixel that is cropped off,
+   * and the samples of the border are not counted.
+   *
+   * @param cam   The Camera for the whole picture
+   * @param rows  The number of rows in the whole picture
+   * @param cols  The number of columns in the whole picture
+   * @param rect  The rectangle, which must be inside of the picture
+   * @return      The pixels of the rectangle.
+   */
+  Matrix<Pixel> Model::click(const Camera& cam, int rows, int cols, const Rect& rect) const {
+    if(rect.height <= 0 || rect.width <= 0 || rect.top < 0 || rect.left < 0 ||
+        rect.top + rect.height > rows || rect.left + rect.width > cols)
+      throw std::exception();
+
+    int pad    = opts.maxSamples > 1 ? 1 : 0;
+    int top    = std::max(rect.top - pad, 0);
+    int left   = std::max(rect.left - pad, 0);
+    int bottom = std::min(rect.top + rect.height + pad, rows);
+    int right  = std::min(rect.left + rect.width + pad, cols);
+
+    Matrix<Pixel> image = render(
+        cam.window(top, left, bottom - top, right - left, rows, cols), bottom - top, right - left,
+        Rect(rect.top - top, rect.left - left, rect.height, rect.width));
+    Matrix<Pixel> ret(rect.height, rect.width);
+    Matrix<uint64_t> cost = opts.measureCost ?
+        Matrix<uint64_t>(rect.height, rect.width, 0) : Matrix<uint64_t>();
+
+    for(int i = 0; i < rect.height; i++) {
+      for(int j = 0; j < rect.width; j++) {
+        ret[i][j] = image[rect.top - top + i][rect.left - left + j];
+
+        if(opts.measureCost)
+          cost[i][j] = ncost[rect.top - top + i][rect.left - left + j];
+      }
+    }
+
+    ncost = cost;
+    return ret;
+  }
+
+  /**
+   * Renders rectangles of a picture into a picture that has already been
+   * rendered, leaving the rest of its pixels as they are, for when only part
+   * of the picture has changed. Each rectangle is rendered on its own, the
+   * same way as a single rectangle, so rectangles that overlap render the
+   * pixels they share more than once. The counts of the Model, and the cost
+   * of every pixel if it is measured, are for all of the rectangles.
+   *
+   * @param cam    The Camera for the whole picture
+   * @param rows   The number of rows in the whole picture
+   * @param cols   The number of columns in the whole picture
+   * @param rects  The rectangles, which must be inside of the picture
+   * @param image  The whole picture, made black first if it is not rows by cols
+   */
+  void Model::click(const Camera& cam, int rows, int cols, const std::vector<Rect>& rects,
+      Matrix<Pixel>& image) const
+  {
+    if(int(image.rows()) != rows || int(image.cols()) != cols)
+      image = Matrix<Pixel>(rows, cols);
+
+    uint64_t         samples = 0;
+    ShadowStats      shadows;
+    RayStats         stats;
+    Matrix<uint64_t> cost = opts.measureCost ? Matrix<uint64_t>(rows, cols, 0) : Matrix<uint64_t>();
+
+    for(const Rect& rect : rects) {
+      Matrix<Pixel> part = click(cam, rows, cols, rect);
+
+      for(int i = 0; i < rect.height; i++) {
+        for(int j = 0; j < rect.width; j++) {
+          image[rect.top + i][rect.left + j] = part[i][j];
+
+          if(opts.measureCost)
+            cost[rect.top + i][rect.left + j] = ncost[i][j];
+        }
+      }
+
+      samples += nsamples;
+      shadows += nshadows;
+      stats   += nstats;
+    }
+
+    nsamples = samples;
+    nshadows = shadows;
+    nstats   = stats;
+    ncost    = cost;
+  }
+
+  /**
+   * Checks if two neighboring pixels are on different sides of an edge. Since
+   * meshes are made of many small Triangles, pixels are only on different
+   * Surfaces if one hit and the other did not or if they hit different
+   * Instances or Materials.
+   *
+   * @param a     the first hit of one pixel
+   * @param b     the first hit of the other pixel
+   * @param opts  the thresholds for the color and normal
+   * @return      true if there is an edge between the pixels
+   */
+  static bool isEdge(const CacheSample& a, const CacheSample& b, const RenderOptions& opts) {
+    if(a.valid != b.valid)
+      return true;
+
+    Vector diff = a.color - b.color;
+    if(std::max(std::fabs(diff.x()), std::max(std::fabs(diff.y()), std::fabs(diff.z()))) > opts.edgeColor)
+      return true;
+
+    if(!a.valid)
+      return false;
+
+    return
+        a.instance != b.instance ||
+        a.surface->material() != b.surface->material() ||
+        dot(a.normal, b.normal) < opts.edgeNormal;
+  }
+
+  /**
+   * A repeatable number between zero and one for a sample of a pixel.
+   */
+  static inline double jitter(uint32_t row, uint32_t col, uint32_t sample) {
+    uint32_t h = row * 73856093u ^ col * 19349663u ^ sample * 83492791u;
+
+    h ^= h >> 16; h *= 0x85ebca6bu;
+    h ^= h >> 13; h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+
+    return double(h) / 4294967296.0;
+  }
+
+  /**
+   * Adds samples to every pixel in a section of the image that sits on an
+   * edge. The extra samples are spread over a grid of cells covering the
+   * pixel, with one sample placed randomly inside of each cell, and are
+   * averaged with the first sample.
+   *
+   * @param cam      the Camera for the picture
+   * @param out      the picture, the edge pixels are replaced
+   * @param minRow   the first row to refine
+   * @param maxRow   one past the last row to refine
+   * @param hits     the first hit of every pixel
+   * @param counted  the pixels whose extra samples are counted
+   * @param count    return for the number of extra samples
+   * @param ctx      the context of the thread
+   */
+  bool Model::refineSection(
+      const Camera& cam,
+      Matrix<Pixel>& out,
+      uint32_t minRow,
+      uint32_t maxRow,
+      const std::vector<CacheSample>* hits,
+      const Rect& counted,
+      uint64_t* count,
+      RenderContext* ctx) const
+  {
+    STATS_SCOPE(stats, ctx->stats);
+    TIMELINE_SCOPE_ARG("refine section", minRow);
+
+    const uint32_t rows  = out.rows();
+    const uint32_t cols  = out.cols();
+    const int      extra = opts.maxSamples - 1;
+    const int      grid  = int(std::ceil(std::sqrt(double(extra))));
+
+    /* jitter by the place in the whole picture so that windows match it */
+    const int      top   = cam._top();
+    const int      left  = cam._left();
+
+    for(uint32_t i = minRow; i < maxRow; i++) {
+      for(uint32_t j = 0; j < cols; j++) {
+        const CacheSample& curr = (*hits)[i * cols + j];
+        bool edge = false;
+
+        if(i > 0)        edge = edge || isEdge(curr, (*hits)[(i - 1) * cols + j], opts);
+        if(i < rows - 1) edge = edge || isEdge(curr, (*hits)[(i + 1) * cols + j], opts);
+        if(j > 0)        edge = edge || isEdge(curr, (*hits)[i * cols + j - 1],   opts);
+        if(j < cols - 1) edge = edge || isEdge(curr, (*hits)[i * cols + j + 1],   opts);
+
+        if(!edge)
+          continue;
+
+        stats::cost_scope cost(costOf(i, j));
+        Vector color = curr.color;
+
+        for(int s = 0; s < extra; s++) {
+          double dy = ((s / grid) + jitter(i + top, j + left, 2 * s))     / grid - 0.5;
+          double dx = ((s % grid) + jitter(i + top, j + left, 2 * s + 1)) / grid - 0.5;
+          Intersection best;
+
+          if(firstHit(cam.getRay(i + dy, j + dx, rows, cols), nullptr, i, j, best))
+            color = color + calculateColor(best, *ctx);
+        }
+
+        out[i][j] = Pixel(color / double(opts.maxSamples));
+
+        if(int(i) >= counted.top  && int(i) < counted.top  + counted.height &&
+           int(j) >= counted.left && int(j) < counted.left + counted.width)
+          *count += extra;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Takes a picture of the model while reusing the last picture in a
+   * FrameCache. The hits from the last picture are projected through the new
+   * Camera and every pixel that one lands on keeps its old color, after a
+   * quick check that its Ray still hits the same Surface. Everything else is
+   * traced. If too few of the old hits land on the new picture it is taken in
+   * full. The cache is updated with the new picture.
+   *
+   * @param cam    The Camera to use for the picture
+   * @param rows   The number of rows in the image
+   * @param cols   The number of columns in the image
+   * @param cache  The hits of the last picture
+   * @return       The resulting image.
+   */
+  Matrix<Pixel> Model::click(const Camera& cam, int rows, int cols, FrameCache& cache) const {
+    Matrix<Ray>   rays = cam.getRays(rows, cols);
+    Matrix<Pixel> image(rays.rows(), rays.cols());
+
+    ncost = opts.measureCost ? Matrix<uint64_t>(rows, cols, 0) : Matrix<uint64_t>();
+
+    std::vector<int32_t>     reuse(rows * cols, -1);
+    std::vector<CacheSample> next (rows * cols);
+
+    uint8_t  nthreads = threadCount();
+    uint32_t rowRange = rows / nthreads;
+    uint32_t covered  = 0;
+    uint32_t hits     = 0;
+
+    std::vector<RenderContext> contexts = makeContexts(nthreads);
+
+    if(!cache.empty() && cache.rows == rows && cache.cols == cols)
+      reproject(cache, cam, reuse);
+
+    for(const CacheSample& sample : cache.samples)
+      if(sample.valid)
+        hits++;
+
+    for(int32_t idx : reuse)
+      if(idx >= 0)
+        covered++;
+
+    if(covered == 0 || covered < cache.minCoverage() * hits) {
+      reuse.assign(rows * cols, -1);
+      covered = 0;
+    }
+
+    timeline::scope tracing("trace");
+
+    parallel(nthreads, [&](uint8_t i) {
+      uint32_t rowStart = i * rowRange;
+      uint32_t rowEnd   = i == nthreads - 1 ? rows : rowStart + rowRange;
+      renderCached(rays, image, rowStart, rowEnd, &cache, &reuse, &next, &contexts[i]);
+    });
+
+    collect(contexts);
+
+    cache.camera  = cam;
+    cache.rows    = rows;
+    cache.cols    = cols;
+    cache._reused = covered ? double(covered) / double(hits) : 0.0;
+    cache.samples.swap(next);
 
     return image;
   }
 
   /**
-   * Calculate the color that a particular ray will have. This will do the
-   * recursive step for the Ray.
+   * Projects the hits in a FrameCache through a new Camera. When more than one
+   * hit lands on a pixel the one closest to the Camera is used. Hits on the
+   * back of a Surface from the new Camera are dropped.
    *
-   * @param ray  the Ray to check against the Model
-   * @return     the Color that the ray is reflecting
+   * @param cache  the hits of the last picture
+   * @param cam    the Camera for the new picture
+   * @param reuse  return for the index of the hit to reuse for each pixel
    */
-  Vector Model::calculateColor(const Ray& ray) const {
-    Intersection   best;
+  void Model::reproject(
+      const FrameCache& cache,
+      const Camera& cam,
+      std::vector<int32_t>& reuse) const
+  {
+    std::vector<double> depth(reuse.size(), std::numeric_limits<double>::max());
+    const double near = -cam._fl();
+
+    for(uint32_t i = 0; i < cache.samples.size(); i++) {
+      const CacheSample& sample = cache.samples[i];
+
+      if(!sample.valid)
+        continue;
+
+      double before = dot(sample.normal, sample.position - cache.camera._fp());
+      double after  = dot(sample.normal, sample.position - cam._fp());
+      if((before < 0) != (after < 0))
+        continue;
+
+      Vector view = cam.toView(sample.position);
+      if(view.z() < near)
+        continue;
+
+      Vector img = cam.toImage(view, cache.rows, cache.cols);
+      int col = int(std::floor(img.x() + 0.5));
+      int row = int(std::floor(img.y() + 0.5));
+
+      if(col < 0 || row < 0 || col >= cache.cols || row >= cache.rows)
+        continue;
+
+      uint32_t idx = row * cache.cols + col;
+      if(view.z() < depth[idx]) {
+        depth[idx] = view.z();
+        reuse[idx] = i;
+      }
+    }
+  }
+
+  /**
+   * Renders a section of a picture that is using a FrameCache.
+   *
+   * @param rays    the camera Rays for the picture
+   * @param out     return for the picture
+   * @param minRow  the first row to render
+   * @param maxRow  one past the last row to render
+   * @param cache   the hits of the last picture
+   * @param reuse   the hit to reuse for each pixel, -1 for none
+   * @param next    return for the hits of the new picture
+   * @param ctx     the context of the thread
+   */
+  bool Model::renderCached(
+      const Matrix<Ray>& rays,
+      Matrix<Pixel>& out,
+      uint32_t minRow,
+      uint32_t maxRow,
+      const FrameCache* cache,
+      const std::vector<int32_t>* reuse,
+      std::vector<CacheSample>* next,
+      RenderContext* ctx) const
+  {
+    STATS_SCOPE(stats, ctx->stats);
+    TIMELINE_SCOPE_ARG("section", minRow);
+
+    for(uint32_t i = minRow; i < maxRow; i++) {
+      for(uint32_t j = 0; j < rays.cols(); j++) {
+        uint32_t     idx    = i * rays.cols() + j;
+        CacheSample& sample = (*next)[idx];
+        Intersection best;
+        bool         hit    = false;
+
+        stats::cost_scope cost(costOf(i, j));
+
+        if((*reuse)[idx] >= 0) {
+          const CacheSample& old = cache->samples[(*reuse)[idx]];
+
+          if(old.instance->getIntersection(rays[i][j], old.surface, best)) {
+            sample.color = old.color;
+            hit = true;
+          }
+        }
+
+        if(!hit) {
+          hit = surfaces && surfaces->intersect(rays[i][j], best);
+          STATS_RAY(primary, hit);
+
+          if(!hit) {
+            out[i][j] = Pixel(0, 0, 0);
+            continue;
+          }
+
+          sample.color = calculateColor(best, *ctx);
+        } else {
+          STATS_RAY(primary, true);
+        }
+
+        sample.position = best.i();
+        sample.normal   = best.n();
+        sample.surface  = best.source();
+        sample.instance = static_cast<const Instance*>(best.instance());
+        sample.valid    = true;
+
+        out[i][j] = Pixel(sample.color);
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Finds the first hit of a camera Ray. When there is a visibility buffer the
+   * Ray is only tested against the Triangle that the rasterizer found so the
+   * Intersection is exactly what tracing would have found. Pixels where the
+   * rasterizer and the Ray disagree, which only happens along the edges of
+   * Triangles, fall back to tracing the Ray.
+   *
+   * @param ray     the camera Ray for the pixel
+   * @param raster  the filled visibility buffer, or null to trace the Ray
+   * @param row     the row of the pixel
+   * @param col     the column of the pixel
+   * @param best    return for the Intersection
+   * @return        true if the Ray hit something
+   */
+  bool Model::firstHit(const Ray& ray, const Raster* raster, int row, int col, Intersection& best) const {
+    if(raster) {
+      const Fragment& frag = raster->at(row, col);
+
+      if(frag.surface && frag.instance->getIntersection(ray, frag.surface, best)) {
+        STATS_RAY(primary, true);
+        return true;
+      }
+
+      if(!frag.surface && !raster->nearCoverage(row, col)) {
+        STATS_RAY(primary, false);
+        return false;
+      }
+    }
+
+    bool hit = surfaces && surfaces->intersect(ray, best);
+    STATS_RAY(primary, hit);
+    return hit;
+  }
+
+  /**
+   * Calculate the color that is reflected from an Intersection. This follows
+   * the reflections off of the Intersection until they stop contributing.
+   *
+   * @param first  the first Intersection of the Ray
+   * @param ctx    the context of the thread
+   * @return       the Color that the ray is reflecting
+   */
+  Vector Model::calculateColor(const Intersection& first, RenderContext& ctx) const {
+    Intersection   best     = first;
     Vector         color(0, 0, 0), newdir;
     Vector         n, v;
-    Ray            curr_ray = ray;
+    Ray            curr_ray;
     double          cont     = 1.0;
 
-    for(int i = 0; i < MAXIMUM_ITERATIONS && cont > MINIMUM_CONTRIBUTION; i++) {
-
-      /* get the closest intersection */
-      if(!surfaces->intersect(curr_ray, best))
-        break;
-
+    for(int i = 1; ; i++) {
       v = best.v().negate();
       n = best.n();
 
       /* calculate color of intersection */
-      color = color + (reflectance(best) * cont);
+      color = color + (reflectance(best, ctx) * cont);
       cont  = cont * (materials[best.source()->material()]).ks();
 
+      if(i >= MAXIMUM_ITERATIONS || cont <= MINIMUM_CONTRIBUTION)
+        break;
+
       newdir   = n * (dot(v, n) * 2) - v;
-      curr_ray = Ray(best.i(), newdir.normalize(), best.source());
+      curr_ray = Ray(best.i(), newdir.normalize(), best.source(), best.instance());
+
+      /* get the closest intersection */
+      bool hit = surfaces->intersect(curr_ray, best);
+      STATS_RAY(reflection, hit);
+
+      if(!hit)
+        break;
     }
 
     return ray::max(ray::min(color, 255.0), 0.0);
   }
 
+  /**
+   * Calculates the color reflected from a batch of Intersections. This gives
+   * the same colors as calling calculateColor for each of them, but every
+   * path takes its next bounce at the same time. Before the reflection Rays
+   * of a bounce are traced they are sorted by the octant of their direction
+   * and then by the Morton code of their origin, so Rays that are traced one
+   * after the other visit the same parts of the tree. Before the hits of a
+   * bounce are shaded they are grouped by Material, and each group is shaded
+   * together with the Material loaded once.
+   *
+   * @param hits    the first Intersection of every path, used as scratch space
+   * @param colors  return for the color of every path
+   * @param ctx     the context of the thread
+   */
+  void Model::calculateColors(
+      std::vector<Intersection>& hits,
+      std::vector<Vector>& colors,
+      RenderContext& ctx) const
+  {
+    struct path_t {
+      uint32_t idx;
+      uint32_t key;
+
+      inline bool operator<(const path_t& rhs) const { return key < rhs.key; }
+    };
+
+    Box    bounds = getBounds();
+    Vector scale  = bounds.len();
+    scale = Vector(
+        scale.x() > 0 ? 1023.0 / scale.x() : 0.0,
+        scale.y() > 0 ? 1023.0 / scale.y() : 0.0,
+        scale.z() > 0 ? 1023.0 / scale.z() : 0.0);
+
+    std::vector<Ray>    rays(hits.size());
+    std::vector<double> cont(hits.size(), 1.0);
+    std::vector<path_t> active(hits.size());
+    Phong phong((Material()));
+
+    colors.assign(hits.size(), Vector(0, 0, 0));
+    for(uint32_t k = 0; k < hits.size(); k++)
+      active[k].idx = k;
+
+    for(int i = 1; !active.empty(); i++) {
+      uint32_t live = 0;
+
+      for(path_t& path : active)
+        path.key = hits[path.idx].source()->material();
+      std::sort(active.begin(), active.end());
+
+      /* shade the current hit of every path and build its reflection */
+      for(uint32_t b = 0; b < active.size(); b++) {
+        const path_t path = active[b];
+        const Intersection& best = hits[path.idx];
+        Vector v = best.v().negate();
+        Vector n = best.n();
+
+        if(b == 0 || path.key != active[b - 1].key)
+          phong = Phong(materials[path.key]);
+
+        colors[path.idx] = colors[path.idx] + (reflectance(best, phong, ctx) * cont[path.idx]);
+        cont[path.idx]   = cont[path.idx] * phong.ks;
+
+        if(i >= MAXIMUM_ITERATIONS || cont[path.idx] <= MINIMUM_CONTRIBUTION)
+          continue;
+
+        Vector newdir = (n * (dot(v, n) * 2) - v).normalize();
+        Vector q      = ray::max(ray::min((best.i() - bounds.min()) * scale, 1023.0), 0.0);
+
+        rays[path.idx] = Ray(best.i(), newdir, best.source(), best.instance());
+        active[live++] = {
+            path.idx,
+            uint32_t(newdir.x() < 0) << 31 |
+            uint32_t(newdir.y() < 0) << 30 |
+            uint32_t(newdir.z() < 0) << 29 |
+            morton3(uint32_t(q.x()), uint32_t(q.y()), uint32_t(q.z())) >> 1 };
+      }
+
+      active.resize(live);
+      std::sort(active.begin(), active.end());
+
+      /* trace the reflections in sorted order */
+      live = 0;
+      for(const path_t& path : active) {
+        bool hit = surfaces->intersect(rays[path.idx], hits[path.idx]);
+        STATS_RAY(reflection, hit);
+
+        if(hit)
+          active[live++] = path;
+      }
+
+      active.resize(live);
+    }
+
+    for(Vector& color : colors)
+      color = ray::max(ray::min(color, 255.0), 0.0);
+  }
+
   /**
    * Calculates the color of the reflection for a particular Intersection. The
    * Intersection has the location of the intersection, the reflecting surface,
    * and the normal and viewing Vectors.
    *
+   * The Lights are taken from a cut through the tree of Lights. The cut starts
+   * at the root and the cluster with the largest bound on its error is split
+   * until every error is small compared to the total, so only one shadow Ray
+   * is cast for each cluster in the cut instead of one for each Light.
+   *
+   * @param inter  the location of the Intersection
+   * @param ctx    the context of the thread
+   * @return       the color of the reflection off the surface
+   */
+  Vector Model::reflectance(const Intersection& inter, RenderContext& ctx) const {
+    return reflectance(inter, Phong(materials[inter.source()->material()]), ctx);
+  }
+
+  /**
+   * Calculates the color of the reflection for an Intersection with the
+   * Material already loaded.
+   *
    * @param inter  the location of the Intersection
+   * @param m      the Material of the Surface that was hit
+   * @param ctx    the context of the thread
    * @return       the color of the reflection off the surface
    */
-  Vector Model::reflectance(const Intersection& inter) const {
-    Material m = materials[inter.source()->material()];
+  Vector Model::reflectance(const Intersection& inter, const Phong& m, RenderContext& ctx) const {
+    struct cut_t {
+      uint32_t node;
+      double   error;
+      Vector   estimate;
+    };
+
+    const LightTree& tree = *lightTree;
+
     Vector p = inter.i();
     Vector v = inter.v().negate();
     Vector n = inter.n();
 
-    Vector Lp;
-    Vector Rl;
-
     Vector ret;
 
     if(dot(v, n) < 0)
       n = n.negate();
 
-    for(const Light& light : lights) {
-      Lp = (light.local() - p).normalize();
+    if(tree.empty())
+      return ret;
 
-      if(dot(Lp, n) < 0 && shadowed(Ray(Lp, p, inter.source()), light))
-        continue;
+    auto error = [&](uint32_t node) {
+      return tree.error(node, m, p, n);
+    };
+
+    auto estimate = [&](uint32_t node) {
+      return illuminate(m, inter, p, v, n, node, ctx);
+    };
 
-      Rl = (n * (dot(Lp, n) * 2) - Lp).normalize();
+    std::vector<cut_t> cut;
+    cut.push_back({ 0, error(0), estimate(0) });
+    ret = cut[0].estimate;
 
-      ret = ret +
-          (m.diffuse() * light.illum() * dot(Lp, n)) +
-          (light.illum() * m.ks() * std::pow(std::max(double(0.0), dot(v, Rl)), m.alpha()));
+    while(cut.size() < opts.maxLightCut) {
+      uint32_t worst = 0;
+
+      for(uint32_t i = 1; i < cut.size(); i++)
+        if(cut[i].error > cut[worst].error)
+          worst = i;
+
+      double total = std::max(std::fabs(ret.x()), std::max(std::fabs(ret.y()), std::fabs(ret.z())));
+      if(cut[worst].error == 0.0 || cut[worst].error <= opts.lightError * total)
+        break;
+
+      const LightTree::Node& split = tree[cut[worst].node];
+      ret = ret - cut[worst].estimate;
+
+      cut[worst] = { uint32_t(split.left), error(split.left), estimate(split.left) };
+      cut.push_back({ uint32_t(split.right), error(split.right), estimate(split.right) });
+
+      ret = ret + cut[worst].estimate + cut.back().estimate;
     }
 
+    /* add up the cut again so that errors from removing clusters do not build up */
+    ret = Vector();
+    for(const cut_t& curr : cut)
+      ret = ret + curr.estimate;
+
     return ret;
   }
 
+  /**
+   * Calculates the light reflected from a single Light, or from a cluster of
+   * Lights that is standing in for a single Light, unless it is shadowed.
+   *
+   * @param m        the material at the Intersection
+   * @param inter    the Intersection
+   * @param p        the location of the Intersection
+   * @param v        the direction back along the incoming Ray
+   * @param n        the normal, facing the incoming Ray
+   * @param cluster  the cluster in the tree of Lights
+   * @param ctx      the context of the thread
+   * @return         the reflected light
+   */
+  Vector Model::illuminate(
+      const Phong& m,
+      const Intersection& inter,
+      const Vector& p,
+      const Vector& v,
+      const Vector& n,
+      uint32_t cluster,
+      RenderContext& ctx) const
+  {
+    const Vector& local = (*lightTree)[cluster].local;
+    const Vector& illum = (*lightTree)[cluster].illum;
+
+    Vector Lp = (local - p).normalize();
+
+    if(dot(Lp, n) < 0 && shadowed(Ray(Lp, p, inter.source(), inter.instance()), local, cluster, ctx))
+      return Vector();
+
+    return m.reflect(Lp, illum, v, n);
+  }
+
   /**
    * Determines if a particular Light is shadowed by one of the Surfaces in the
    * Model.
    *
-   * @param ray    the Ray from the Intersection to the Light
-   * @param Light  the Light to check if it is Shadowed
-   * @return       true if the Intersection is shadowed for the Light
+   * Neighboring shading points tend to be shadowed by the same Surface, so the
+   * last Surface that blocked each cluster of Lights is kept by the thread and
+   * is tested before the Ray is traced through the tree. Any hit closer than
+   * the Light is enough to shadow it, so a hit on the cached Surface gives the
+   * same answer as tracing.
+   *
+   * @param ray      the Ray from the Intersection to the Light
+   * @param light    the location of the Light to check if it is Shadowed
+   * @param cluster  the cluster in the tree of Lights that the Light is for
+   * @param ctx      the context of the thread
+   * @return         true if the Intersection is shadowed for the Light
    */
-  bool Model::shadowed(const Ray& ray, const Light& light) const {
+  bool Model::shadowed(const Ray& ray, const Vector& light, uint32_t cluster, RenderContext& ctx) const {
+    RenderContext::Occluder& occ = ctx.occluders[cluster];
+    double dist = light.distance(ray.L());
     Intersection inter;
 
-    return
-        surfaces->intersect(ray, inter) &&
-        inter.distance() < light.local().distance(ray.L());
+    ctx.shadows.rays++;
+
+    if(opts.shadowCache && occ.surface) {
+      ctx.shadows.tests++;
+
+      if(occ.instance->getIntersection(ray, occ.surface, inter) && inter.distance() < dist) {
+        ctx.shadows.hits++;
+        STATS_RAY(shadow, true);
+        return true;
+      }
+    }
+
+    bool hit = surfaces->intersect(ray, inter) && inter.distance() < dist;
+    STATS_RAY(shadow, hit);
+
+    if(!hit)
+      return false;
+
+    occ.surface  = inter.source();
+    occ.instance = static_cast<const Instance*>(inter.instance());
+    return true;
   }
 
   /**
-   * Creates a Model and a Camera based on an ObjectStream
+   * Builds the geometry for a single mesh. The Materials of the mesh are added
+   * to the end of the Materials for the Model and the Triangles are updated to
+   * refer to them.
    *
-   * @param stream   the object stream to create everything with
-   * @param mreturn  return location for the model
-   * @param creturn  return location for teh camera
+   * @param arena      the arena that will own the Surfaces of the mesh
+   * @param stream     the object that contains the mesh
+   * @param materials  the Materials for the Model
+   * @return           the new Mesh, with a null root if it has no Triangles
    */
-  void Model::fromObjectStream(
-      const std::shared_ptr<ObjectStream> stream,
-      Model& mreturn, Camera& creturn)
+  Mesh Model::buildMesh(
+      SurfaceArena& arena,
+      const ObjectStream& stream,
+      std::vector<Material>& materials)
   {
-    /* build everything for the model */
-    auto vertices = stream->vertices();
-    auto normals  = stream->normals();
-    auto polygons = stream->polygons();
+    auto vertices = stream.vertices();
+    auto normals  = stream.normals();
+    auto polygons = stream.polygons();
+    auto mats     = stream.materials();
+
+    Mesh ret;
+    uint16_t matbase = materials.size();
+
+    /* a Triangle with a vertex that has no normal, which the OBJ parser marks
+     * with -1, gets the normal of its face in an extra row after the normals */
+    size_t nfaces = 0;
+    for(const ObjectStream::Polygon& p : polygons)
+      for(int j = 1; j + 1 < int(p.vertices.size()); j++)
+        if(p.normals.size() < p.vertices.size() ||
+           p.normals[0] < 0 || p.normals[j] < 0 || p.normals[j + 1] < 0)
+          nfaces++;
 
-    auto vertmat  = Matrix<double>(vertices.size(), 4);
-    auto normmat  = Matrix<double>(normals.size(),  4);
+    ret.vertices = Matrix<double>(vertices.size(), 4);
+    ret.normals  = Matrix<double>(normals.size() + nfaces, 4);
 
-    std::vector<Surface::ptr> surfaces;
+    materials.insert(materials.end(), mats.begin(), mats.end());
 
     for(int i = 0; i < vertices.size(); i++) {
-      vertmat[i][0] = vertices[i].x();
-      vertmat[i][1] = vertices[i].y();
-      vertmat[i][2] = vertices[i].z();
-      vertmat[i][3] = 1.0;
+      ret.vertices[i][0] = vertices[i].x();
+      ret.vertices[i][1] = vertices[i].y();
+      ret.vertices[i][2] = vertices[i].z();
+      ret.vertices[i][3] = 1.0;
     }
 
     for(int i = 0; i < normals.size(); i++) {
-      normmat[i][0] = normals[i].x();
-      normmat[i][1] = normals[i].y();
-      normmat[i][2] = normals[i].z();
-      normmat[i][3] = 1.0;
+      ret.normals[i][0] = normals[i].x();
+      ret.normals[i][1] = normals[i].y();
+      ret.normals[i][2] = normals[i].z();
+      ret.normals[i][3] = 1.0;
     }
 
+    size_t ntriangles = 0;
+    for(const ObjectStream::Polygon& p : polygons)
+      if(p.vertices.size() > 2)
+        ntriangles += p.vertices.size() - 2;
+
+    if(ntriangles == 0)
+      return ret;
+
+    arena.reserve(ntriangles);
+    ret.triangles.reserve(ntriangles);
+
+    uint32_t face = normals.size();
+
     for(int i = 0; i < polygons.size(); i++) {
       ObjectStream::Polygon& p = polygons[i];
 
       for(int j = 1; j < p.vertices.size() - 1; j++) {
-        surfaces.push_back(std::make_shared<Triangle>(
-            RefVector(vertmat, p.vertices[0]),
-            RefVector(vertmat, p.vertices[j]),
-            RefVector(vertmat, p.vertices[j + 1]),
-            RefVector(normmat, p.normals[0]),
-            RefVector(normmat, p.normals[j]),
-            RefVector(normmat, p.normals[j + 1]),
-            p.matidx));
+        int idx[3]   = { 0, j, j + 1 };
+        int norms[3] = { -1, -1, -1 };
+
+        for(int k = 0; k < 3; k++)
+          if(idx[k] < int(p.normals.size()))
+            norms[k] = p.normals[idx[k]];
+
+        if(norms[0] < 0 || norms[1] < 0 || norms[2] < 0) {
+          Vector a = vertices[p.vertices[0]];
+          Vector n = cross(vertices[p.vertices[j]] - a, vertices[p.vertices[j + 1]] - a).normalize();
+
+          ret.normals[face][0] = n.x();
+          ret.normals[face][1] = n.y();
+          ret.normals[face][2] = n.z();
+          ret.normals[face][3] = 1.0;
+
+          for(int k = 0; k < 3; k++)
+            if(norms[k] < 0)
+              norms[k] = face;
+          face++;
+        }
+
+        ret.triangles.push_back(arena.makeTriangle(
+            RefVector(ret.vertices, p.vertices[0]),
+            RefVector(ret.vertices, p.vertices[j]),
+            RefVector(ret.vertices, p.vertices[j + 1]),
+            RefVector(ret.normals,  norms[0]),
+            RefVector(ret.normals,  norms[1]),
+            RefVector(ret.normals,  norms[2]),
+            matbase + p.matidx));
       }
     }
 
+    TIMELINE_SCOPE("bvh build");
+    ret.root = arena.makeTree(ret.triangles.begin(), ret.triangles.end());
+    return ret;
+  }
+
+  /**
+   * Places an object and everything that it instances into the Model. Each
+   * object is only turned into a Mesh the first time that it is seen, after
+   * that its Instances share the same Mesh.
+   *
+   * @param arena      the arena that will own the Surfaces
+   * @param stream     the object to place
+   * @param transform  the object to world transform for the object
+   * @param meshes     return for the Meshes of the Model
+   * @param materials  return for the Materials of the Model
+   * @param instances  return for the Instances of the Model
+   * @param built      the Meshes that have already been built
+   */
+  void Model::addInstances(
+      SurfaceArena& arena,
+      const ObjectStream& stream,
+      const Matrix<double>& transform,
+      std::vector<Mesh>& meshes,
+      std::vector<Material>& materials,
+      std::vector<Instance*>& instances,
+      mesh_map& built)
+  {
+    if(built.find(&stream) == built.end()) {
+      Mesh mesh = buildMesh(arena, stream, materials);
+
+      built[&stream] = mesh.root;
+      if(mesh.root)
+        meshes.push_back(mesh);
+    }
+
+    if(built[&stream])
+      instances.push_back(arena.makeInstance(built[&stream], transform));
+
+    for(const ObjectStream::Instance& inst : stream.instances()) {
+      addInstances(arena, *inst.mesh, transform * inst.transform,
+          meshes, materials, instances, built);
+    }
+  }
+
+  /**
+   * Creates a Model and a Camera based on an ObjectStream
+   *
+   * @param stream   the object stream to create everything with
+   * @param mreturn  return location for the model
+   * @param creturn  return location for teh camera
+   */
+  void Model::fromObjectStream(
+      const std::shared_ptr<ObjectStream> stream,
+      Model& mreturn, Camera& creturn)
+  {
+    TIMELINE_SCOPE("fromObjectStream");
+
+    /* build everything for the model */
+    auto arena = std::make_shared<SurfaceArena>();
+
+    std::vector<Mesh>      meshes;
+    std::vector<Material>  materials;
+    std::vector<Instance*> instances;
+    mesh_map               built;
+
+    addInstances(*arena, *stream, ray::eye<double>(4),
+        meshes, materials, instances, built);
+
     /* build everything for the camera */
-    auto box = Box(surfaces.begin(), surfaces.end());
+    auto box = Box(instances.begin(), instances.end());
     auto zdiff = sqrt(pow(box.len().y(), 2) * pow(box.len().x(), 2)) + box.len().z();
 
     auto fl  = -1.0;
@@ -299,9 +1485,233 @@ namespace ray {
     /* create the model */
     mreturn = Model(
         lights,
-        stream->materials(),
-        surfaces,
-        vertmat,
-        normmat);
+        materials,
+        arena,
+        meshes,
+        instances);
+  }
+
+  /**
+   * Refits every tree from a node up to the root of the Model, recording the
+   * trees that changed so that they can be sent to the device.
+   *
+   * @param node     the lowest tree that changed
+   * @param changed  return for the Surfaces that need to be sent
+   */
+  void Model::refit(SurfaceTree* node, std::vector<render::d_Surface>& changed) {
+    for(; node != nullptr; node = node->parent()) {
+      node->refit();
+      changed.push_back(render::d_Surface(*node));
+    }
+  }
+
+  /**
+   * Takes an Instance out of the top level tree. Any trees that are left
+   * empty are removed as well so that they do not stretch the bounds of the
+   * trees above them.
+   *
+   * @param inst  the Instance to take out
+   * @return      the lowest tree that is left, which needs to be refit
+   */
+  SurfaceTree* Model::detach(Instance* inst) {
+    SurfaceTree* node = inst->parent();
+    node->remove(inst);
+
+    while(node->size() == 0 && node != surfaces) {
+      SurfaceTree* parent = node->parent();
+      parent->remove(node);
+      node = parent;
+    }
+
+    return node;
+  }
+
+  /**
+   * Creates the arena and an empty top level tree for a Model that was default
+   * constructed, so that meshes and Instances can be added to it.
+   */
+  void Model::prepare() {
+    if(surfaces)
+      return;
+
+    std::vector<Surface::ptr>      empty;
+    std::vector<render::d_Surface> s_transfer;
+
+    arena    = std::make_shared<SurfaceArena>();
+    surfaces = arena->makeTree(empty.begin(), empty.end());
+
+    s_transfer.resize(arena->size());
+    surfaces->place(s_transfer);
+    setSurfaces(s_transfer.data(), s_transfer.size(), surfaces->id);
+    updateLights();
+  }
+
+  /**
+   * Sends Surfaces that have changed to the device.
+   *
+   * @param changed  the Surfaces that changed
+   */
+  void Model::upload(std::vector<render::d_Surface>& changed) {
+    render::updateSurfaces(changed.data(), changed.size(), arena->size(), surfaces->id);
+  }
+
+  /**
+   * Adds the geometry of an object to the Model without placing it. The
+   * Materials of the object are added to the end of the Materials of the
+   * Model. Any Lights or Instances in the object are ignored.
+   *
+   * @param stream  the object to add
+   * @return        the index of the new Mesh
+   */
+  uint32_t Model::addMesh(const ObjectStream& stream) {
+    prepare();
+
+    uint32_t first = arena->size();
+    uint32_t nmats = materials.size();
+    Mesh     mesh  = buildMesh(*arena, stream, materials);
+
+    if(!mesh.root) {
+      materials.resize(nmats);
+      throw std::exception();
+    }
+
+    std::vector<render::d_Surface>  s_transfer(arena->size());
+    std::vector<render::d_Material> m_transfer;
+
+    mesh.root->place(s_transfer);
+    render::updateSurfaces(s_transfer.data() + first, s_transfer.size() - first,
+        arena->size(), surfaces->id);
+
+    if(materials.size() != nmats) {
+      for(const Material& mat : materials)
+        m_transfer.push_back(render::d_Material(mat));
+      setMaterials(m_transfer.data(), m_transfer.size());
+    }
+
+    meshes.push_back(mesh);
+    return meshes.size() - 1;
+  }
+
+  /**
+   * Places a Mesh into the Model. The new Instance is inserted into the top
+   * level tree and only the trees along the path to it are updated.
+   *
+   * @param mesh       the index of the Mesh to place
+   * @param transform  the object to world transform for the Mesh
+   * @return           the new Instance, owned by the Model
+   */
+  Instance* Model::addInstance(uint32_t mesh, const Matrix<double>& transform) {
+    std::vector<render::d_Surface> changed;
+
+    if(mesh >= meshes.size())
+      throw std::exception();
+
+    Instance* inst = arena->makeInstance(meshes[mesh].root, transform);
+
+    changed.push_back(render::d_Surface(*inst));
+    refit(surfaces->insert(*arena, inst), changed);
+    upload(changed);
+
+    instances.push_back(inst);
+    return inst;
+  }
+
+  /**
+   * Removes an Instance from the Model. Any trees that are left empty are
+   * removed as well. The memory for the Instance is held by the Model until
+   * the Model is destroyed.
+   *
+   * @param inst  the Instance to remove
+   */
+  void Model::removeInstance(Instance* inst) {
+    std::vector<render::d_Surface> changed;
+    auto iter = std::find(instances.begin(), instances.end(), inst);
+
+    if(iter == instances.end())
+      throw std::exception();
+
+    refit(detach(inst), changed);
+    upload(changed);
+
+    instances.erase(iter);
+  }
+
+  /**
+   * Moves an Instance to a new place. The Instance is taken out of the top
+   * level tree and inserted again so that the tree stays tight around the
+   * Instances that it contains.
+   *
+   * @param inst       the Instance to move
+   * @param transform  the new object to world transform for the Instance
+   */
+  void Model::moveInstance(Instance* inst, const Matrix<double>& transform) {
+    std::vector<render::d_Surface> changed;
+
+    if(std::find(instances.begin(), instances.end(), inst) == instances.end())
+      throw std::exception();
+
+    SurfaceTree* node = detach(inst);
+    inst->setTransform(transform);
+
+    refit(node, changed);
+    changed.push_back(render::d_Surface(*inst));
+    refit(surfaces->insert(*arena, inst), changed);
+    upload(changed);
+  }
+
+  /**
+   * Adds a Light to the Model.
+   *
+   * @param light  the new Light
+   * @return       the index of the Light
+   */
+  uint32_t Model::addLight(const Light& light) {
+    lights.push_back(light);
+    updateLights();
+
+    return lights.size() - 1;
+  }
+
+  /**
+   * Replaces one of the Lights in the Model.
+   *
+   * @param idx    the index of the Light
+   * @param light  the new value for the Light
+   */
+  void Model::setLight(uint32_t idx, const Light& light) {
+    if(idx >= lights.size())
+      throw std::exception();
+
+    lights[idx] = light;
+    updateLights();
+  }
+
+  /**
+   * Removes one of the Lights from the Model. The indices of the Lights after
+   * it move down by one.
+   *
+   * @param idx  the index of the Light
+   */
+  void Model::removeLight(uint32_t idx) {
+    if(idx >= lights.size())
+      throw std::exception();
+
+    lights.erase(lights.begin() + idx);
+    updateLights();
+  }
+
+  /**
+   * Replaces one of the Materials in the Model. Every Triangle that uses the
+   * Material will use the new value from the next render on.
+   *
+   * @param idx       the index of the Material
+   * @param material  the new value for the Material
+   */
+  void Model::setMaterial(uint32_t idx, const Material& material) {
+    if(idx >= materials.size())
+      throw std::exception();
+
+    materials[idx] = material;
+    render::updateMaterial(render::d_Material(material), idx);
   }
 }
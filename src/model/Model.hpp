@@ -10,12 +10,15 @@
 /* local includes */
 #include <Camera.hpp>
 #include <Matrix.tpp>
+#include <Stats.hpp>
 #include <Surface.hpp>
 #include <Vector.hpp>
+#include <WorkerPool.hpp>
 
 #include <render.hpp>
 
 /* std includes */
+#include <functional>
 #include <iostream>
 #include <map>
 #include <vector>
@@ -24,8 +27,13 @@ namespace ray {
 
 #define MAXIMUM_ITERATIONS   512
 #define MINIMUM_CONTRIBUTION 0.0039
+#define RENDER_TILE          16
 
+  class FrameCache;
+  class LightTree;
+  struct CacheSample;
   class ObjectStream;
+  class Raster;
 
   class Material {
     public:
@@ -42,7 +50,7 @@ namespace ray {
       inline double    kt() const { return _kt;    }
       inline double alpha() const { return _alpha; }
 
-      inline const Matrix<double> diffuse() const { return _diffuse; }
+      inline const Matrix<double>& diffuse() const { return _diffuse; }
 
       operator render::d_Material() const;
 
@@ -54,6 +62,26 @@ namespace ray {
       Matrix<double> _diffuse;
   };
 
+  /**
+   * The parts of a Material that shading needs, copied out of the Material
+   * into plain arrays so that shading a hit never touches the heap. Only the
+   * color part of the diffuse matrix is kept.
+   */
+  struct Phong {
+    Phong(const Material& m);
+
+    Vector reflect(const Vector& Lp, const Vector& illum, const Vector& v, const Vector& n) const;
+
+    /** the diffuse matrix */
+    double diffuse[3][3];
+
+    /** the specular coefficient and exponent */
+    double ks, alpha;
+
+    /** the largest fraction of a Light that the diffuse term can reflect */
+    double kd;
+  };
+
   class Light {
     public:
 
@@ -74,59 +102,396 @@ namespace ray {
       Vector _illum;
   };
 
+  /**
+   * The geometry for a single mesh. A Mesh is built once and is shared by every
+   * Instance that places it into a Model.
+   */
+  struct Mesh {
+    Mesh() : vertices(), normals(), triangles(), root(nullptr) { }
+
+    /** the vertices for the mesh */
+    ray::Matrix<double> vertices;
+
+    /** the normals for the mesh */
+    ray::Matrix<double> normals;
+
+    /** every Triangle in the mesh */
+    std::vector<Triangle*> triangles;
+
+    /** the tree of Triangles for the mesh */
+    Surface::ptr root;
+  };
+
+  /**
+   * Settings that change how a Model renders an image without changing what
+   * the image looks like.
+   */
+  struct RenderOptions {
+    /** the orders that the pixels of an image can be rendered in */
+    enum Order { scanline, morton, hilbert };
+
+    RenderOptions() :
+      rasterize(false),
+      maxSamples(1),
+      edgeColor(16.0),
+      edgeNormal(0.9),
+      lightError(0.02),
+      maxLightCut(64),
+      shadowCache(true),
+      batchRays(false),
+      order(scanline),
+      measureCost(false) { }
+
+    /** find what the camera Rays hit with the rasterizer instead of tracing */
+    bool rasterize;
+
+    /** the most samples taken for a pixel on an edge, 1 turns this off */
+    uint16_t maxSamples;
+
+    /** the largest difference in a color channel that is not an edge */
+    double edgeColor;
+
+    /** the smallest cosine between two normals that is not an edge */
+    double edgeNormal;
+
+    /** the largest error allowed for a cluster of lights, relative to the total */
+    double lightError;
+
+    /** the most clusters of lights used for a single shading point */
+    uint32_t maxLightCut;
+
+    /** test the last Surface that blocked a Light before tracing a shadow Ray */
+    bool shadowCache;
+
+    /** follow the reflections of a whole tile together, sorted for coherence */
+    bool batchRays;
+
+    /** the order of the tiles in the image and of the pixels in a tile */
+    Order order;
+
+    /** record the cost of rendering every pixel, see Model::cost */
+    bool measureCost;
+  };
+
+  /**
+   * The order that the tiles of an image, and the pixels in each tile, are
+   * rendered in. Each thread renders a range of the tiles, so when the tiles
+   * follow a curve through the image every thread gets a compact region
+   * instead of a thin strip.
+   */
+  struct TileOrder {
+    TileOrder(RenderOptions::Order order, uint32_t rows, uint32_t cols);
+
+    /** the row major index of every tile, in the order they are rendered */
+    std::vector<uint32_t> tiles;
+
+    /** the row major offset of every pixel in a tile, in the order they are rendered */
+    std::vector<uint16_t> pixels;
+
+    /** the number of tiles in a row of the image */
+    uint32_t cols;
+  };
+
+  /**
+   * Counts for the shadow Rays cast while rendering an image.
+   */
+  struct ShadowStats {
+    ShadowStats() : rays(0), tests(0), hits(0) { }
+
+    /** the number of shadow Rays that were cast */
+    uint64_t rays;
+
+    /** the number of shadow Rays that had a cached occluder to test first */
+    uint64_t tests;
+
+    /** the number of shadow Rays that were blocked by the cached occluder */
+    uint64_t hits;
+
+    inline double hitRate() const { return tests ? double(hits) / double(tests) : 0.0; }
+
+    inline ShadowStats& operator+=(const ShadowStats& rhs) {
+      rays  += rhs.rays;
+      tests += rhs.tests;
+      hits  += rhs.hits;
+      return *this;
+    }
+  };
+
+  /**
+   * State that belongs to a single rendering thread. Nothing in a context is
+   * shared with the other threads so it is changed without any locking.
+   */
+  struct RenderContext {
+    /** a Surface that blocked a shadow Ray and the Instance it was seen in */
+    struct Occluder {
+      Occluder() : surface(nullptr), instance(nullptr) { }
+
+      const Surface*  surface;
+      const Instance* instance;
+    };
+
+    RenderContext(uint32_t clusters) : occluders(clusters), shadows(), stats() { }
+
+    /** the last occluder for each cluster in the tree of Lights */
+    std::vector<Occluder> occluders;
+
+    /** the shadow Rays cast by this thread */
+    ShadowStats shadows;
+
+    /** the work done by this thread, only counted when built with STATS */
+    RayStats stats;
+  };
+
+  /**
+   * A scene that can be rendered. After a Model has been built it can be
+   * changed in place: meshes, Instances and Lights can be added and removed
+   * and Materials can be replaced. Only the parts of the top level tree and of
+   * the device arrays that are touched by a change are updated. A copy of a
+   * Model holds its own Lights, Materials, Meshes and Instances but shares the
+   * Surfaces of the original, so a Model must not be changed after it has been
+   * copied. A default constructed Model is empty until a mesh is added to it.
+   * Changes must not be made while the Model is rendering.
+   */
   class Model {
     public:
 
       Model() :
         lights(),
+        lightTree(),
         materials(),
+        arena(),
         surfaces(),
-        vertices(),
-        normals() { }
+        meshes(),
+        instances(),
+        opts(),
+        pool(),
+        nsamples(0),
+        nshadows(),
+        nstats(),
+        ncost() { }
 
       Model(std::vector<Light> lights,
             std::vector<Material> materials,
-            std::vector<Surface::ptr> surfs,
-            ray::Matrix<double>& vertices,
-            ray::Matrix<double>& normals);
+            SurfaceArena::ptr arena,
+            std::vector<Mesh> meshes,
+            std::vector<Instance*> instances);
 
       virtual ~Model()   { }
 
       Matrix<Pixel> click(const Camera& cam, int row, int cols) const;
+      Matrix<Pixel> click(const Camera& cam, int row, int cols, FrameCache& cache) const;
+      Matrix<Pixel> click(const Camera& cam, int rows, int cols, const Rect& rect) const;
+      void          click(const Camera& cam, int rows, int cols, const std::vector<Rect>& rects,
+          Matrix<Pixel>& image) const;
 
-      Box getBounds() const;
+      Box  getBounds() const;
+      bool intersect(const Ray& ray, Intersection& best) const;
 
       static void fromObjectStream(
           const std::shared_ptr<ObjectStream> objstream,
           Model& mreturn, Camera& creturn);
 
-    private:
+      /* scene updates */
+      uint32_t  addMesh(const ObjectStream& stream);
+      Instance* addInstance(uint32_t mesh, const Matrix<double>& transform);
+      void      removeInstance(Instance* inst);
+      void      moveInstance(Instance* inst, const Matrix<double>& transform);
+
+      uint32_t addLight(const Light& light);
+      void     setLight(uint32_t idx, const Light& light);
+      void     removeLight(uint32_t idx);
+
+      void     setMaterial(uint32_t idx, const Material& material);
+
+      /* getters */
+      inline const std::vector<Light>&     getLights()    const { return lights;    }
+      inline const std::vector<Material>&  getMaterials() const { return materials; }
+      inline const std::vector<Mesh>&      getMeshes()    const { return meshes;    }
+      inline const std::vector<Instance*>& getInstances() const { return instances; }
 
-      Vector calculateColor(const Ray& ray) const;
+      inline       RenderOptions& options()       { return opts; }
+      inline const RenderOptions& options() const { return opts; }
 
-      Vector reflectance(const Intersection& inter) const;
-      bool   shadowed(const Ray& ray, const Light& light) const;
+      /**
+       * Renders with a pool of threads that is kept between pictures instead
+       * of starting new threads for every picture. Null goes back to starting
+       * new threads.
+       */
+      inline void setPool(WorkerPool::ptr workers) { pool = workers; }
+      inline WorkerPool::ptr getPool() const { return pool; }
+
+      /** the number of camera samples taken by the last call to click */
+      inline uint64_t samples() const { return nsamples; }
+
+      /** the shadow Rays cast by the last call to click */
+      inline const ShadowStats& shadowStats() const { return nshadows; }
+
+      /** the work done by the last call to click, only counted when built with STATS */
+      inline const RayStats& stats() const { return nstats; }
+
+      /**
+       * The cost of every pixel rendered by the last call to click, in the
+       * unit of stats::costUnit. Empty unless the measureCost option is set.
+       */
+      inline const Matrix<uint64_t>& cost() const { return ncost; }
+
+    private:
+
+      typedef std::map<const ObjectStream*, Surface::ptr> mesh_map;
+
+      static Mesh buildMesh(
+          SurfaceArena& arena,
+          const ObjectStream& stream,
+          std::vector<Material>& materials);
+
+      static void addInstances(
+          SurfaceArena& arena,
+          const ObjectStream& stream,
+          const Matrix<double>& transform,
+          std::vector<Mesh>& meshes,
+          std::vector<Material>& materials,
+          std::vector<Instance*>& instances,
+          mesh_map& built);
+
+      void         prepare();
+      SurfaceTree* detach(Instance* inst);
+      void         refit(SurfaceTree* node, std::vector<render::d_Surface>& changed);
+      void upload(std::vector<render::d_Surface>& changed);
+
+      bool   firstHit(const Ray& ray, const Raster* raster, int row, int col,
+          Intersection& best) const;
+      Vector calculateColor(const Intersection& first, RenderContext& ctx) const;
+      void   calculateColors(std::vector<Intersection>& hits, std::vector<Vector>& colors,
+          RenderContext& ctx) const;
+
+      void updateLights();
+
+      /** the cost of a pixel for stats::cost_scope, null when it is not measured */
+      inline uint64_t* costOf(uint32_t row, uint32_t col) const
+      { return opts.measureCost ? &ncost[row][col] : nullptr; }
+
+      uint8_t threadCount() const;
+      void    parallel(uint8_t nthreads, const std::function<void(uint8_t)>& job) const;
+
+      std::vector<RenderContext> makeContexts(uint8_t nthreads) const;
+      void                       collect(const std::vector<RenderContext>& contexts) const;
+
+      Vector reflectance(const Intersection& inter, RenderContext& ctx) const;
+      Vector reflectance(const Intersection& inter, const Phong& m, RenderContext& ctx) const;
+      Vector illuminate(
+          const Phong& m,
+          const Intersection& inter,
+          const Vector& p,
+          const Vector& v,
+          const Vector& n,
+          uint32_t cluster,
+          RenderContext& ctx) const;
+      bool   shadowed(const Ray& ray, const Vector& light, uint32_t cluster,
+          RenderContext& ctx) const;
+
+      Matrix<Pixel> render(const Camera& cam, int rows, int cols, const Rect& counted) const;
 
       bool renderSection(
           const Matrix<Ray>& rays,
           Matrix<Pixel>& out,
           uint32_t minRow,
-          uint32_t maxRow) const;
+          uint32_t maxRow,
+          const Raster* raster,
+          std::vector<CacheSample>* hits,
+          RenderContext* ctx) const;
+
+      void renderPixel(
+          const Matrix<Ray>& rays,
+          Matrix<Pixel>& out,
+          uint32_t row,
+          uint32_t col,
+          const Raster* raster,
+          std::vector<CacheSample>* hits,
+          RenderContext& ctx) const;
+
+      bool renderTiles(
+          const Matrix<Ray>& rays,
+          Matrix<Pixel>& out,
+          const TileOrder* order,
+          uint32_t begin,
+          uint32_t end,
+          const Raster* raster,
+          std::vector<CacheSample>* hits,
+          RenderContext* ctx) const;
+
+      void renderTile(
+          const Matrix<Ray>& rays,
+          Matrix<Pixel>& out,
+          uint32_t row,
+          uint32_t col,
+          const std::vector<uint16_t>& pixels,
+          const Raster* raster,
+          std::vector<CacheSample>* hits,
+          RenderContext& ctx) const;
+
+      bool refineSection(
+          const Camera& cam,
+          Matrix<Pixel>& out,
+          uint32_t minRow,
+          uint32_t maxRow,
+          const std::vector<CacheSample>* hits,
+          const Rect& counted,
+          uint64_t* count,
+          RenderContext* ctx) const;
+
+      void reproject(
+          const FrameCache& cache,
+          const Camera& cam,
+          std::vector<int32_t>& reuse) const;
+
+      bool renderCached(
+          const Matrix<Ray>& rays,
+          Matrix<Pixel>& out,
+          uint32_t minRow,
+          uint32_t maxRow,
+          const FrameCache* cache,
+          const std::vector<int32_t>* reuse,
+          std::vector<CacheSample>* next,
+          RenderContext* ctx) const;
 
       /** all of the lights for the model */
       std::vector<Light> lights;
 
+      /** the lights clustered for shading, shared between copies of the model */
+      std::shared_ptr<LightTree> lightTree;
+
       /** all of the materials for the model */
       std::vector<Material> materials;
 
-      /** all of the Surfaces in the model */
-      Surface::ptr surfaces;
+      /** owns every Surface in the model, shared between copies of the model */
+      SurfaceArena::ptr arena;
+
+      /** the top level tree over all of the Instances in the model */
+      SurfaceTree* surfaces;
+
+      /** the geometry that is shared by the Instances */
+      std::vector<Mesh> meshes;
+
+      /** every Instance that is currently part of the top level tree */
+      std::vector<Instance*> instances;
+
+      /** how the model should be rendered */
+      RenderOptions opts;
+
+      /** the threads that render, started for each picture when null */
+      WorkerPool::ptr pool;
+
+      /** the number of camera samples taken by the last call to click */
+      mutable uint64_t nsamples;
+
+      /** the shadow Rays cast by the last call to click */
+      mutable ShadowStats nshadows;
 
-      /** the vertices for the model */
-      ray::Matrix<double> vertices;
+      /** the work done by the last call to click */
+      mutable RayStats nstats;
 
-      /** the normals for the model */
-      ray::Matrix<double> normals;
+      /** the cost of every pixel rendered by the last call to click */
+      mutable Matrix<uint64_t> ncost;
 
   };
 
@@ -0,0 +1,396 @@
+/*
+ * RegionTracer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <RegionTracer.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace ray {
+
+  /**
+   * Creates a RegionTracer for a scene.
+   *
+   * @param regions  the parts of the scene, they have to outlive the RegionTracer
+   * @param lights   the Lights of the scene
+   */
+  RegionTracer::RegionTracer(const std::vector<Region*>& regions, const std::vector<Light>& lights) :
+      regions(regions), tree(lights), opts(), image(), paths(), shadings(), upcoming(), nwaves(0) { }
+
+  /**
+   * Renders a picture.
+   *
+   * @param cam   the Camera to use for the picture
+   * @param rows  the number of rows in the picture
+   * @param cols  the number of columns in the picture
+   * @param band  the number of rows rendered at once
+   * @return      false if a Region could no longer answer
+   */
+  bool RegionTracer::render(const Camera& cam, int rows, int cols, int band) {
+    image = Matrix<Pixel>(rows, cols);
+
+    for(int top = 0; top < rows; top += band) {
+      int height = std::min(band, rows - top);
+      Matrix<Ray> rays = cam.window(top, 0, height, cols, rows, cols).getRays(height, cols);
+
+      paths.assign(height * cols, Path());
+      shadings.clear();
+      upcoming.clear();
+
+      for(int i = 0; i < height; i++) {
+        for(int j = 0; j < cols; j++) {
+          uint32_t idx  = i * cols + j;
+          Path&    path = paths[idx];
+
+          path.row     = top + i;
+          path.col     = j;
+          path.cont    = 1.0;
+          path.bounces = 0;
+          path.pending = 0;
+          path.tracing = true;
+
+          Trace trace;
+          trace.L      = rays[i][j].L();
+          trace.U      = rays[i][j].U();
+          trace.owner  = idx;
+
+          if(!launch(trace)) {
+            path.tracing = false;
+            finish(idx);
+          }
+        }
+      }
+
+      while(!upcoming.empty()) {
+        std::vector<Trace> traces;
+        traces.swap(upcoming);
+
+        if(!wave(traces))
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+  /**
+   * Finds the Regions that a Ray passes through and queues it for the first
+   * of them.
+   *
+   * @return  false if the Ray misses every Region
+   */
+  bool RegionTracer::launch(Trace& trace) {
+    Ray r(trace.L, trace.U);
+
+    trace.route.clear();
+    for(uint32_t k = 0; k < regions.size(); k++)
+      if(regions[k]->bounds().intersect(r))
+        trace.route.push_back(std::make_pair(regions[k]->bounds().entry(trace.L, trace.U), uint16_t(k)));
+
+    if(trace.route.empty())
+      return false;
+
+    std::sort(trace.route.begin(), trace.route.end());
+    trace.next  = 0;
+    trace.found = -1;
+    trace.best.distance = std::numeric_limits<double>::max();
+
+    upcoming.push_back(trace);
+    return true;
+  }
+
+  /**
+   * Sends every waiting Ray to the Region it is waiting on and handles the
+   * answers.
+   *
+   * @param traces  the waiting Rays
+   * @return        false if a Region could no longer answer
+   */
+  bool RegionTracer::wave(std::vector<Trace>& traces) {
+    std::vector<std::vector<uint32_t> > batches(regions.size());
+
+    for(uint32_t i = 0; i < traces.size(); i++)
+      batches[traces[i].route[traces[i].next].second].push_back(i);
+
+    for(uint32_t k = 0; k < regions.size(); k++) {
+      if(batches[k].empty())
+        continue;
+
+      uint32_t count = batches[k].size();
+      std::vector<RayQuery> queries(count);
+
+      for(uint32_t j = 0; j < count; j++) {
+        const Trace& trace = traces[batches[k][j]];
+        RayQuery&    q     = queries[j];
+
+        for(int a = 0; a < 3; a++) {
+          q.L[a] = trace.L[a];
+          q.U[a] = trace.U[a];
+        }
+        q.distance = trace.limit;
+        q.source   = trace.region == int32_t(k) ? trace.source : -1;
+        q.shadow   = trace.shadow;
+      }
+
+      if(!regions[k]->send(queries))
+        return false;
+    }
+
+    for(uint32_t k = 0; k < regions.size(); k++) {
+      if(batches[k].empty())
+        continue;
+
+      std::vector<RayAnswer> answers;
+      if(!regions[k]->receive(answers) || answers.size() != batches[k].size())
+        return false;
+
+      for(uint32_t j = 0; j < answers.size(); j++)
+        answered(traces[batches[k][j]], k, answers[j]);
+    }
+
+    nwaves++;
+    return true;
+  }
+
+  /**
+   * Handles what a Region found for a Ray. The Ray goes on to the next Region on
+   * its route if it could still find something there, otherwise what it found
+   * is used.
+   */
+  void RegionTracer::answered(Trace& trace, uint16_t region, const RayAnswer& answer) {
+    trace.next++;
+
+    if(trace.shadow) {
+      Shading& shading = shadings[trace.owner];
+
+      if(answer.surface >= 0) {
+        shading.cut[trace.slot].estimate = Vector();
+      } else if(trace.next < trace.route.size()) {
+        upcoming.push_back(trace);
+        return;
+      }
+
+      if(--shading.pending == 0)
+        advance(trace.owner);
+      return;
+    }
+
+    if(answer.surface >= 0 && answer.distance < trace.best.distance) {
+      trace.best  = answer;
+      trace.found = region;
+    }
+
+    /* leave some room for where a hit on the side of a Region's bounds is rounded */
+    double reach = trace.best.distance + 1e-9 * (1.0 + std::fabs(trace.best.distance));
+    if(trace.next < trace.route.size() && (trace.found < 0 || trace.route[trace.next].first <= reach)) {
+      upcoming.push_back(trace);
+      return;
+    }
+
+    if(trace.found >= 0) {
+      hit(trace.owner, trace.best, trace.found);
+    } else {
+      paths[trace.owner].tracing = false;
+      finish(trace.owner);
+    }
+  }
+
+  /**
+   * Shades the closest hit of a Ray and follows its reflection, the same way
+   * as Model::calculateColor.
+   *
+   * @param idx     the Path
+   * @param best    the closest hit
+   * @param region  the Region the hit is in
+   */
+  void RegionTracer::hit(uint32_t idx, const RayAnswer& best, int32_t region) {
+    Path& path = paths[idx];
+    uint32_t bounce = path.light.size();
+
+    path.light.push_back(Vector());
+    path.conts.push_back(path.cont);
+    path.pending++;
+    path.bounces++;
+
+    shade(idx, bounce, best, region);
+
+    path.cont = path.cont * regions[region]->materials()[best.material].ks;
+
+    if(path.bounces >= MAXIMUM_ITERATIONS || path.cont <= MINIMUM_CONTRIBUTION) {
+      path.tracing = false;
+      finish(idx);
+      return;
+    }
+
+    Vector i(best.i[0], best.i[1], best.i[2]);
+    Vector n(best.n[0], best.n[1], best.n[2]);
+    Vector v = Vector(best.v[0], best.v[1], best.v[2]).negate();
+    Vector newdir = n * (dot(v, n) * 2) - v;
+
+    Trace trace;
+    trace.L      = i;
+    trace.U      = newdir.normalize();
+    trace.region = region;
+    trace.source = best.surface;
+    trace.owner  = idx;
+
+    if(!launch(trace)) {
+      path.tracing = false;
+      finish(idx);
+    }
+  }
+
+  /**
+   * Starts the light cut of a hit, the same way as Model::reflectance.
+   *
+   * @param idx     the Path
+   * @param bounce  the bounce of the Path that the hit is for
+   * @param best    the hit
+   * @param region  the Region the hit is in
+   */
+  void RegionTracer::shade(uint32_t idx, uint32_t bounce, const RayAnswer& best, int32_t region) {
+    Shading shading = {
+        idx, bounce,
+        regions[region]->materials()[best.material],
+        Vector(best.i[0], best.i[1], best.i[2]),
+        Vector(best.v[0], best.v[1], best.v[2]).negate(),
+        Vector(best.n[0], best.n[1], best.n[2]),
+        region, best.surface,
+        std::vector<Cut>(), Vector(), -1, 0 };
+
+    if(dot(shading.v, shading.n) < 0)
+      shading.n = shading.n.negate();
+
+    if(tree.empty()) {
+      paths[idx].pending--;
+      return;
+    }
+
+    uint32_t s = shadings.size();
+    shading.cut.push_back({ 0, tree.error(0, shading.m, shading.p, shading.n), Vector() });
+    shadings.push_back(shading);
+
+    estimate(s, 0);
+    if(shadings[s].pending == 0)
+      advance(s);
+  }
+
+  /**
+   * Works out the light from a cluster in a cut, the same way as
+   * Model::illuminate. When the cluster needs a shadow Ray it is sent out and
+   * the light is taken away again if the Ray is blocked.
+   *
+   * @param idx   the Shading
+   * @param slot  the cluster in its cut
+   */
+  void RegionTracer::estimate(uint32_t idx, uint32_t slot) {
+    Shading& shading = shadings[idx];
+    const LightTree::Node& node = tree[shading.cut[slot].node];
+
+    Vector Lp = (node.local - shading.p).normalize();
+    shading.cut[slot].estimate = shading.m.reflect(Lp, node.illum, shading.v, shading.n);
+
+    if(dot(Lp, shading.n) >= 0)
+      return;
+
+    Trace trace;
+    trace.L      = Lp;
+    trace.U      = shading.p;
+    trace.region = shading.region;
+    trace.source = shading.surface;
+    trace.limit  = node.local.distance(Lp);
+    trace.shadow = true;
+    trace.owner  = idx;
+    trace.slot   = slot;
+
+    if(launch(trace))
+      shading.pending++;
+  }
+
+  /**
+   * Takes the next steps of a light cut once the light of every cluster in it
+   * is known, until it needs to wait on another shadow Ray or is finished.
+   *
+   * @param idx  the Shading
+   */
+  void RegionTracer::advance(uint32_t idx) {
+    Shading& shading = shadings[idx];
+    std::vector<Cut>& cut = shading.cut;
+
+    if(shading.worst < 0)
+      shading.ret = cut[0].estimate;
+    else
+      shading.ret = shading.ret + cut[shading.worst].estimate + cut.back().estimate;
+
+    while(cut.size() < opts.maxLightCut) {
+      uint32_t worst = 0;
+
+      for(uint32_t i = 1; i < cut.size(); i++)
+        if(cut[i].error > cut[worst].error)
+          worst = i;
+
+      const Vector& ret = shading.ret;
+      double total = std::max(std::fabs(ret.x()), std::max(std::fabs(ret.y()), std::fabs(ret.z())));
+      if(cut[worst].error == 0.0 || cut[worst].error <= opts.lightError * total)
+        break;
+
+      const LightTree::Node& split = tree[cut[worst].node];
+      shading.ret = shading.ret - cut[worst].estimate;
+
+      cut[worst] = { uint32_t(split.left), tree.error(split.left, shading.m, shading.p, shading.n), Vector() };
+      estimate(idx, worst);
+      cut.push_back({ uint32_t(split.right), tree.error(split.right, shading.m, shading.p, shading.n), Vector() });
+      estimate(idx, cut.size() - 1);
+
+      shading.worst = worst;
+      if(shading.pending)
+        return;
+
+      shading.ret = shading.ret + cut[worst].estimate + cut.back().estimate;
+    }
+
+    /* add up the cut again so that errors from removing clusters do not build up */
+    Vector sum;
+    for(const Cut& curr : cut)
+      sum = sum + curr.estimate;
+
+    Path& path = paths[shading.path];
+    path.light[shading.bounce] = sum;
+    path.pending--;
+
+    std::vector<Cut>().swap(cut);
+    finish(shading.path);
+  }
+
+  /**
+   * Writes a pixel once its Rays are done and all of its hits are shaded.
+   *
+   * @param idx  the Path of the pixel
+   */
+  void RegionTracer::finish(uint32_t idx) {
+    Path& path = paths[idx];
+
+    if(path.tracing || path.pending)
+      return;
+
+    Vector color(0, 0, 0);
+    for(uint32_t b = 0; b < path.light.size(); b++)
+      color = color + (path.light[b] * path.conts[b]);
+
+    if(!path.light.empty())
+      color = max(min(color, 255.0), 0.0);
+
+    image[path.row][path.col] = Pixel(color);
+
+    std::vector<Vector>().swap(path.light);
+    std::vector<double>().swap(path.conts);
+  }
+
+}
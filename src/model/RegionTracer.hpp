@@ -0,0 +1,205 @@
+/*
+ * RegionTracer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Camera.hpp>
+#include <LightTree.hpp>
+#include <Matrix.tpp>
+#include <Model.hpp>
+#include <Surface.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace ray {
+
+  /**
+   * A Ray that a Region is asked about. The Region answers with the closest
+   * Surface the Ray hits or, for a shadow Ray, whether anything closer than
+   * the Light blocks it. These are plain data so that they can be sent between
+   * processes as they are laid out in memory.
+   */
+  struct RayQuery {
+    double   L[3], U[3];
+
+    /** for a shadow Ray, the distance to the Light */
+    double   distance;
+
+    /** the Surface the Ray left from if it belongs to this Region, otherwise -1 */
+    int32_t  source;
+
+    /** 1 for a shadow Ray */
+    uint32_t shadow;
+  };
+
+  /** what a Region found for a RayQuery */
+  struct RayAnswer {
+    double   i[3], n[3], v[3];
+    double   distance;
+
+    /** the Surface that was hit, -1 for a miss */
+    int32_t  surface;
+    uint16_t material;
+  };
+
+  /**
+   * One part of a scene that answers batches of RayQueries. The Surfaces of a
+   * Region are numbered by the Region, and their Materials are the Region's.
+   */
+  class Region {
+    public:
+
+      virtual ~Region() { }
+
+      /** the bounds of every Surface in the Region */
+      virtual const Box& bounds() const = 0;
+
+      /** the Materials of the Region */
+      virtual const std::vector<Phong>& materials() const = 0;
+
+      /**
+       * Starts answering a batch of queries. Every Region is sent its batch
+       * before any of them is asked for its answers, so they can all work at
+       * the same time.
+       *
+       * @param queries  the batch
+       * @return         false if the Region can no longer answer
+       */
+      virtual bool send(const std::vector<RayQuery>& queries) = 0;
+
+      /**
+       * Waits for the answers to the last batch that was sent.
+       *
+       * @param answers  return for an answer to every query, in order
+       * @return         false if the Region can no longer answer
+       */
+      virtual bool receive(std::vector<RayAnswer>& answers) = 0;
+  };
+
+  /**
+   * Owns the pixels of a picture and follows every Ray of it through the
+   * Regions that the scene is made of. Only the bounds and Materials of each
+   * Region and the Lights are kept here, the Regions do all of the tracing.
+   *
+   * Each Ray visits the Regions whose bounds it passes through, nearest first,
+   * until the closest hit so far is closer than where the Ray enters the next
+   * Region. A shadow Ray visits them until one of them blocks it. The hits
+   * come back here and are shaded the same way Model shades them, with each
+   * shadow Ray of a light cut and each reflection sent out as a new Ray, so
+   * the picture matches one rendered by Model.
+   *
+   * The picture is rendered a band of rows at a time. Every Ray of the band
+   * that is waiting on a Region is sent in a single batch to that Region,
+   * every Region works on its batch at the same time, and the answers may
+   * start new Rays for the next batch. The band is done when no Rays are left.
+   */
+  class RegionTracer {
+    public:
+
+      RegionTracer(const std::vector<Region*>& regions, const std::vector<Light>& lights);
+
+      bool render(const Camera& cam, int rows, int cols, int band);
+
+      inline const Matrix<Pixel>& picture() const { return image; }
+
+      /** the number of batches sent to the Regions */
+      inline uint64_t waves() const { return nwaves; }
+
+    private:
+
+      /** a Ray on its way through the Regions */
+      struct Trace {
+        Trace() : region(-1), source(-1), limit(0.0), shadow(false), owner(0), slot(0),
+          route(), next(0), best(), found(-1) { }
+
+        Vector L, U;
+
+        /** the Region and Surface the Ray left from, -1 for a camera Ray */
+        int32_t region, source;
+
+        /** for a shadow Ray, the distance to the Light */
+        double limit;
+        bool   shadow;
+
+        /** the Path of a Ray, or the Shading of a shadow Ray */
+        uint32_t owner;
+
+        /** for a shadow Ray, the cluster of the cut that it is for */
+        uint32_t slot;
+
+        /** the Regions the Ray passes through and where it enters them, nearest first */
+        std::vector<std::pair<double, uint16_t> > route;
+        uint32_t next;
+
+        /** the closest hit so far and the Region it was found in */
+        RayAnswer best;
+        int32_t   found;
+      };
+
+      /** everything that is known about a single pixel */
+      struct Path {
+        uint32_t row, col;
+
+        /** how much the next hit contributes to the pixel */
+        double   cont;
+        uint32_t bounces;
+
+        /** the light reflected from each hit, and how much of it reaches the pixel */
+        std::vector<Vector> light;
+        std::vector<double> conts;
+
+        /** hits that are still being shaded */
+        uint32_t pending;
+        bool     tracing;
+      };
+
+      /** a cluster of Lights in a cut */
+      struct Cut {
+        uint32_t node;
+        double   error;
+        Vector   estimate;
+      };
+
+      /** a hit that is being shaded, a step of its light cut at a time */
+      struct Shading {
+        uint32_t         path, bounce;
+        Phong            m;
+        Vector           p, v, n;
+        int32_t          region, surface;
+        std::vector<Cut> cut;
+        Vector           ret;
+        int32_t          worst;
+        uint32_t         pending;
+      };
+
+      bool launch(Trace& trace);
+      bool wave(std::vector<Trace>& traces);
+      void answered(Trace& trace, uint16_t region, const RayAnswer& answer);
+
+      void hit(uint32_t idx, const RayAnswer& best, int32_t region);
+      void shade(uint32_t idx, uint32_t bounce, const RayAnswer& best, int32_t region);
+      void estimate(uint32_t idx, uint32_t slot);
+      void advance(uint32_t idx);
+      void finish(uint32_t idx);
+
+      std::vector<Region*> regions;
+      LightTree            tree;
+      RenderOptions        opts;
+      Matrix<Pixel>        image;
+
+      std::vector<Path>    paths;
+      std::vector<Shading> shadings;
+      std::vector<Trace>   upcoming;
+      uint64_t             nwaves;
+  };
+
+}
@@ -0,0 +1,658 @@
+/*
+ * PagedTree.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <PagedTree.hpp>
+#include <Ray.hpp>
+#include <RefVector.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+/* system includes */
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ray {
+
+  const std::string PagedTree::suffix  = ".rpage";
+  const uint32_t    PagedTree::version = 1;
+
+  static const char magic[4] = { 'R', 'P', 'A', 'G' };
+
+  /** the number of Rays a thread takes at once while tracing a round */
+  static const uint32_t chunk = 64;
+
+  /** an entry in the table of pages */
+  struct PageEntry {
+    uint64_t offset;
+    uint32_t first, count;
+  };
+
+  template<typename T>
+  static inline void get(std::istream& istr, T& out) {
+    istr.read(reinterpret_cast<char*>(&out), sizeof(T));
+  }
+
+  template<typename T>
+  static inline void put(std::ostream& ostr, const T& in) {
+    ostr.write(reinterpret_cast<const char*>(&in), sizeof(T));
+  }
+
+  /**
+   * Builds the top of the tree and lays out the pages below it. This makes
+   * the same choices as the SurfaceTree constructor so that the tree is the
+   * one Model builds for the same Triangles. The pages are stored one after
+   * the other from first, so once the tree is built the order holds every
+   * Triangle in the order it is stored in.
+   */
+  struct PageWriter {
+    typedef std::vector<uint32_t>::iterator iter_t;
+
+    int32_t node(iter_t begin, iter_t end);
+
+    const std::vector<Box>& boxes;
+    uint32_t                pageSize;
+    uint64_t                first;
+
+    std::vector<render::d_Surface> nodes;
+    std::vector<PageEntry>         pages;
+    uint32_t                       written;
+  };
+
+  /**
+   * Adds the node for a range of Triangles. A range that fits into a page
+   * becomes the next page in its current order, which is the order the
+   * SurfaceTree constructor would see it in, so reading the page can build
+   * the same subtree again.
+   *
+   * @param begin  the first Triangle of the range
+   * @param end    one past the last Triangle of the range
+   * @return       the index of the node
+   */
+  int32_t PageWriter::node(iter_t begin, iter_t end) {
+    Box bounds = boxes[*begin];
+    for(iter_t iter = begin + 1; iter != end; iter++)
+      bounds = Box(bounds, boxes[*iter]);
+
+    int32_t idx = nodes.size();
+    render::d_Surface surf = render::d_Surface();
+
+    surf.id  = idx;
+    surf.min = bounds.min();
+    surf.len = bounds.len();
+
+    nodes.push_back(surf);
+
+    if(end - begin <= pageSize) {
+      PageEntry page = { first + uint64_t(written) * sizeof(PagedTree::PagedTriangle), written, uint32_t(end - begin) };
+
+      nodes[idx].which  = render::d_Surface::page;
+      nodes[idx].d_axis = pages.size();
+      nodes[idx].v_axis = -1;
+
+      pages.push_back(page);
+      written += page.count;
+      return idx;
+    }
+
+    int axis = bounds.len().x() > bounds.len().y() ?
+        bounds.len().x() > bounds.len().z() ? 0 : 2 :
+        bounds.len().y() > bounds.len().z() ? 1 : 2;
+
+    std::sort(begin, end, [&](uint32_t l, uint32_t r) {
+      return (boxes[l].min()[axis] + (boxes[l].len()[axis] / 2.0) <
+              boxes[r].min()[axis] + (boxes[r].len()[axis] / 2.0));
+    });
+
+    iter_t  seperator = begin + ((end - begin) / 2);
+    int32_t left      = node(begin, seperator);
+    int32_t right     = node(seperator, end);
+
+    nodes[idx].which  = render::d_Surface::tree;
+    nodes[idx].d_axis = left;
+    nodes[idx].v_axis = right;
+    return idx;
+  }
+
+  /**
+   * Makes the Triangles of a polygon the same way Model::buildMesh makes
+   * them, as a fan around its first vertex. A vertex without a normal, which
+   * the OBJ parser marks with -1, gets the normal of the Triangle.
+   *
+   * @param source  the scene, for the vertices and normals
+   * @param p       the polygon
+   * @param j       the Triangle of the polygon, from 1
+   * @param tri     return for the Triangle
+   * @return        the bounds of the Triangle
+   */
+  static Box fan(const mesh::Source& source, const ObjectStream::Polygon& p, int j,
+      PagedTree::PagedTriangle& tri)
+  {
+    int verts[3] = { p.vertices[0], p.vertices[j], p.vertices[j + 1] };
+    int norms[3] = { p.normals [0], p.normals [j], p.normals [j + 1] };
+    Vector v[3];
+
+    for(int k = 0; k < 3; k++)
+      v[k] = source.vertex(verts[k]);
+
+    Vector face = cross(v[1] - v[0], v[2] - v[0]).normalize();
+
+    std::memset(&tri, 0, sizeof(tri));
+    for(int k = 0; k < 3; k++) {
+      Vector n = norms[k] < 0 ? face : source.normal(norms[k]);
+
+      for(int a = 0; a < 3; a++) {
+        tri.v[k][a] = v[k][a];
+        tri.n[k][a] = n[a];
+      }
+    }
+    tri.material = p.matidx;
+
+    Vector lo = min(min(v[0], v[1]), v[2]);
+    Vector hi = max(max(v[0], v[1]), v[2]);
+    return Box(lo, hi - lo);
+  }
+
+  /**
+   * Writes a scene into a paged file. The scene is read twice, once for the
+   * bounds of every Triangle to build the tree and once more to write each
+   * Triangle into its page, so only the bounds and the place of every
+   * Triangle are kept in memory and a binary mesh bigger than the memory of
+   * the machine can be paged.
+   *
+   * @param fileName  the name of the file
+   * @param source    the scene
+   * @param pageSize  the most Triangles in a page, at least 2
+   */
+  void PagedTree::write(std::string fileName, mesh::Source& source, uint32_t pageSize) {
+    std::ofstream ostr(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if(!ostr)
+      throw std::exception();
+
+    const ObjectStream::Polygon* p;
+    PagedTriangle                tri;
+
+    std::vector<Box> boxes;
+    source.rewind();
+    while((p = source.next()))
+      for(int j = 1; j + 1 < int(p->vertices.size()); j++)
+        boxes.push_back(fan(source, *p, j, tri));
+
+    const uint64_t ntriangles = boxes.size();
+
+    std::vector<uint32_t> order(ntriangles);
+    for(uint32_t i = 0; i < order.size(); i++)
+      order[i] = i;
+
+    ostr.write(magic, sizeof(magic));
+    put(ostr, version);
+    for(int i = 0; i < 4; i++)
+      put(ostr, uint32_t(0));
+    put(ostr, ntriangles);
+    put(ostr, uint64_t(0));
+
+    for(const Material& mat : source.materials()) {
+      put(ostr, mat.ks());
+      put(ostr, mat.kt());
+      put(ostr, mat.alpha());
+      for(int r = 0; r < 3; r++)
+        for(int c = 0; c < 3; c++)
+          put(ostr, mat.diffuse()[r][c]);
+    }
+
+    for(const Light& light : source.lights()) {
+      double values[6] = {
+          light.local().x(), light.local().y(), light.local().z(),
+          light.illum().x(), light.illum().y(), light.illum().z() };
+      ostr.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+
+    const uint64_t first = ostr.tellp();
+    const uint64_t table = first + ntriangles * sizeof(PagedTriangle);
+
+    PageWriter writer = { boxes, std::max(pageSize, uint32_t(2)), first,
+        std::vector<render::d_Surface>(), std::vector<PageEntry>(), 0 };
+
+    if(!order.empty())
+      writer.node(order.begin(), order.end());
+    std::vector<Box>().swap(boxes);
+
+    ostr.seekp(table);
+    for(const render::d_Surface& surf : writer.nodes)
+      put(ostr, surf);
+    for(const PageEntry& page : writer.pages)
+      put(ostr, page);
+
+    /* where each Triangle is stored, in the order they are read */
+    std::vector<uint32_t> place(ntriangles);
+    for(uint32_t i = 0; i < order.size(); i++)
+      place[order[i]] = i;
+    std::vector<uint32_t>().swap(order);
+
+    /* Triangles next to each other in the scene are often stored together, so only seek when they are not */
+    uint64_t next = ntriangles, i = 0;
+    source.rewind();
+    while((p = source.next())) {
+      for(int j = 1; j + 1 < int(p->vertices.size()); j++, i++) {
+        fan(source, *p, j, tri);
+        if(place[i] != next)
+          ostr.seekp(first + uint64_t(place[i]) * sizeof(PagedTriangle));
+        put(ostr, tri);
+        next = place[i] + 1;
+      }
+    }
+
+    ostr.seekp(sizeof(magic) + sizeof(uint32_t));
+    put(ostr, uint32_t(source.materials().size()));
+    put(ostr, uint32_t(source.lights().size()));
+    put(ostr, uint32_t(writer.nodes.size()));
+    put(ostr, uint32_t(writer.pages.size()));
+    put(ostr, ntriangles);
+    put(ostr, table);
+
+    ostr.close();
+    if(!ostr || i != ntriangles)
+      throw std::exception();
+  }
+
+  /**
+   * Opens a paged file. Only the top of the tree is read, the pages are read
+   * when Rays reach them.
+   *
+   * @param fileName  the name of the file
+   * @param budget    the most bytes the pages in memory may use, at least one
+   *                  page is always kept
+   * @param nthreads  the number of threads besides the caller that trace and
+   *                  read pages
+   */
+  PagedTree::PagedTree(std::string fileName, size_t budget, uint8_t nthreads) :
+      fd(-1),
+      phong(),
+      _lights(),
+      nodes(),
+      table(),
+      _bounds(),
+      ntriangles(0),
+      resident(),
+      used(0),
+      budget(budget),
+      pool(nthreads),
+      answered(),
+      nreads(0),
+      nevicts(0),
+      nrounds(0),
+      npeak(0)
+  {
+    std::ifstream istr(fileName.c_str(), std::ios::binary);
+    char     head[4];
+    uint32_t vers, counts[4];
+    uint64_t offset;
+
+    if(!istr)
+      throw std::exception();
+
+    istr.read(head, sizeof(head));
+    get(istr, vers);
+    if(!istr || std::memcmp(head, magic, sizeof(magic)) != 0 || vers != version)
+      throw std::exception();
+
+    for(uint32_t& count : counts)
+      get(istr, count);
+    get(istr, ntriangles);
+    get(istr, offset);
+
+    for(uint32_t i = 0; i < counts[0]; i++) {
+      double params[3];
+      Matrix<double> diffuse = ray::eye<double>(4);
+
+      istr.read(reinterpret_cast<char*>(params), sizeof(params));
+      for(int r = 0; r < 3; r++)
+        for(int c = 0; c < 3; c++)
+          get(istr, diffuse[r][c]);
+
+      phong.push_back(Phong(Material(params[0], params[1], params[2], diffuse)));
+    }
+
+    for(uint32_t i = 0; i < counts[1]; i++) {
+      double values[6];
+      istr.read(reinterpret_cast<char*>(values), sizeof(values));
+      _lights.push_back(Light(
+          Vector(values[0], values[1], values[2]),
+          Vector(values[3], values[4], values[5])));
+    }
+
+    istr.seekg(offset);
+    nodes.resize(counts[2]);
+    istr.read(reinterpret_cast<char*>(nodes.data()), counts[2] * sizeof(render::d_Surface));
+
+    std::vector<Page>(counts[3]).swap(table);
+    for(Page& page : table) {
+      PageEntry entry;
+      get(istr, entry);
+
+      page.offset = entry.offset;
+      page.first  = entry.first;
+      page.count  = entry.count;
+      page.used   = 0;
+    }
+
+    if(!istr)
+      throw std::exception();
+
+    /* the bounds that Model gives a mesh placed by an Instance, so the Rays
+     * that are tested against them match */
+    if(!nodes.empty()) {
+      Box root(nodes[0].min, nodes[0].len);
+      _bounds = Box(root.min(), (root.min() + root.len()) - root.min());
+    }
+
+    if((fd = ::open(fileName.c_str(), O_RDONLY)) < 0)
+      throw std::exception();
+  }
+
+  PagedTree::~PagedTree() {
+    if(fd >= 0)
+      ::close(fd);
+  }
+
+  /**
+   * Estimates the memory a page uses while it is loaded.
+   *
+   * @param page  the page
+   * @return      the size in bytes
+   */
+  size_t PagedTree::bytes(const Page& page) const {
+    return sizeof(Loaded) + size_t(page.count) * (sizeof(Triangle) + sizeof(SurfaceTree) +
+        2 * sizeof(Triangle*) + 6 * VECTOR_SIZE * sizeof(double));
+  }
+
+  /**
+   * Traces a batch of Rays. The answers are kept until receive is called.
+   *
+   * @param queries  the Rays
+   * @return         true, a PagedTree can always answer
+   */
+  bool PagedTree::send(const std::vector<RayQuery>& queries) {
+    RayAnswer miss;
+    std::memset(&miss, 0, sizeof(miss));
+    miss.surface = -1;
+
+    std::vector<Walk>     walks(queries.size());
+    std::vector<uint32_t> active, waiting;
+
+    answered.assign(queries.size(), miss);
+
+    for(uint32_t i = 0; i < queries.size(); i++) {
+      walks[i].page    = -1;
+      walks[i].waiting = -1;
+
+      if(!nodes.empty()) {
+        walks[i].stack.push_back(std::make_pair(0.0, 0));
+        active.push_back(i);
+      }
+    }
+
+    while(!active.empty() || !waiting.empty()) {
+      nrounds++;
+
+      /* follow every Ray that can go on until it is done or waits on a page */
+      std::atomic<uint32_t> next(0);
+      pool.run(pool.size() + 1, [&](uint8_t) {
+        for(uint32_t begin; (begin = next.fetch_add(chunk)) < active.size();) {
+          uint32_t end = std::min(begin + chunk, uint32_t(active.size()));
+
+          for(uint32_t i = begin; i < end; i++)
+            trace(queries[active[i]], walks[active[i]], answered[active[i]]);
+        }
+      });
+
+      for(uint32_t i : active)
+        if(walks[i].waiting >= 0)
+          waiting.push_back(i);
+      active.clear();
+
+      if(waiting.empty())
+        break;
+
+      /* read the pages with the most Rays waiting on them first */
+      std::vector<std::pair<uint32_t, uint32_t> > counts;
+      std::vector<uint32_t> pages;
+
+      for(uint32_t i : waiting)
+        pages.push_back(walks[i].waiting);
+      std::sort(pages.begin(), pages.end());
+
+      for(uint32_t i = 0; i < pages.size(); i++) {
+        if(i == 0 || pages[i] != pages[i - 1])
+          counts.push_back(std::make_pair(0, pages[i]));
+        counts.back().first++;
+      }
+
+      std::stable_sort(counts.begin(), counts.end(),
+          [](const std::pair<uint32_t, uint32_t>& l, const std::pair<uint32_t, uint32_t>& r) {
+            return l.first > r.first;
+          });
+
+      pages.clear();
+      for(const auto& count : counts)
+        pages.push_back(count.second);
+
+      load(pages);
+
+      std::vector<uint32_t> still;
+      for(uint32_t i : waiting)
+        (table[walks[i].waiting].loaded ? active : still).push_back(i);
+      waiting.swap(still);
+    }
+
+    return true;
+  }
+
+  bool PagedTree::receive(std::vector<RayAnswer>& answers) {
+    answers.swap(answered);
+    answered.clear();
+    return true;
+  }
+
+  /**
+   * Follows a Ray through the tree until it is done or reaches a page that is
+   * not in memory. The nearer child of a node is visited first, and nodes
+   * that start further away than the closest hit so far are skipped. Where
+   * two hits are the same distance away the one in the later page is kept,
+   * which is the one a SurfaceTree keeps.
+   *
+   * @param q     the Ray
+   * @param walk  where the Ray is in the tree
+   * @param a     the closest hit so far
+   */
+  void PagedTree::trace(const RayQuery& q, Walk& walk, RayAnswer& a) {
+    Vector L(q.L[0], q.L[1], q.L[2]);
+    Vector U(q.U[0], q.U[1], q.U[2]);
+    Ray    plain(L, U);
+
+    walk.waiting = -1;
+
+    while(!walk.stack.empty()) {
+      double limit = q.shadow ? q.distance :
+          a.surface >= 0 ? a.distance : std::numeric_limits<double>::infinity();
+
+      /* leave some room for where a hit on the side of a node's bounds is rounded */
+      if(walk.stack.back().first > limit + 1e-9 * (1.0 + std::fabs(limit))) {
+        walk.stack.pop_back();
+        continue;
+      }
+
+      const render::d_Surface& node = nodes[walk.stack.back().second];
+
+      if(node.which == render::d_Surface::tree) {
+        std::pair<double, int32_t> children[2];
+        int nchildren = 0;
+
+        walk.stack.pop_back();
+        for(int32_t child : { node.d_axis, node.v_axis }) {
+          Box box(nodes[child].min, nodes[child].len);
+          if(box.intersect(plain))
+            children[nchildren++] = std::make_pair(box.entry(L, U), child);
+        }
+
+        if(nchildren == 2 && children[0].first < children[1].first)
+          std::swap(children[0], children[1]);
+        for(int i = 0; i < nchildren; i++)
+          walk.stack.push_back(children[i]);
+        continue;
+      }
+
+      Page& page = table[node.d_axis];
+      if(!page.loaded) {
+        walk.waiting = node.d_axis;
+        return;
+      }
+
+      walk.stack.pop_back();
+      page.used.store(nrounds, std::memory_order_relaxed);
+
+      /* the Triangle the Ray left from is only skipped in its own page */
+      const Surface* source = nullptr;
+      if(q.source >= 0 && uint32_t(q.source) - page.first < page.count)
+        source = page.loaded->triangles[q.source - page.first];
+
+      Intersection inter;
+      if(!page.loaded->root->getIntersection(source ? Ray(L, U, source) : plain, inter))
+        continue;
+
+      if(q.shadow ? inter.distance() >= q.distance :
+          a.surface >= 0 && (inter.distance() > a.distance ||
+            (inter.distance() == a.distance && int32_t(node.d_axis) < walk.page)))
+        continue;
+
+      a.surface  = page.first + inter.source()->id;
+      a.material = inter.source()->material();
+      a.distance = inter.distance();
+      for(int k = 0; k < 3; k++) {
+        a.i[k] = inter.i()[k];
+        a.n[k] = inter.n()[k];
+        a.v[k] = inter.v()[k];
+      }
+      walk.page = node.d_axis;
+
+      /* anything that blocks a shadow Ray is enough */
+      if(q.shadow)
+        walk.stack.clear();
+    }
+  }
+
+  /**
+   * Reads pages that Rays are waiting on. As many of them as fit in the
+   * budget are read, at least the first, and the pages that were used the
+   * longest ago are dropped to make room.
+   *
+   * @param wanted  the pages, the most important first
+   */
+  void PagedTree::load(const std::vector<uint32_t>& wanted) {
+    std::vector<uint32_t> reading;
+    size_t need = 0;
+
+    for(uint32_t page : wanted) {
+      if(!reading.empty() && need + bytes(table[page]) > budget)
+        break;
+      reading.push_back(page);
+      need += bytes(table[page]);
+    }
+
+    if(used + need > budget) {
+      std::sort(resident.begin(), resident.end(), [&](uint32_t l, uint32_t r) {
+        return table[l].used.load() > table[r].used.load();
+      });
+
+      while(!resident.empty() && used + need > budget) {
+        Page& page = table[resident.back()];
+
+        used -= bytes(page);
+        page.loaded.reset();
+        resident.pop_back();
+        nevicts++;
+      }
+    }
+
+    std::atomic<uint32_t> next(0);
+    std::atomic<bool>     failed(false);
+
+    pool.run(pool.size() + 1, [&](uint8_t) {
+      for(uint32_t idx; (idx = next.fetch_add(1)) < reading.size();) {
+        Page& page = table[reading[idx]];
+        std::vector<PagedTriangle> buffer(page.count);
+
+        char*  data = reinterpret_cast<char*>(buffer.data());
+        size_t size = buffer.size() * sizeof(PagedTriangle);
+
+        for(size_t done = 0; done < size;) {
+          ssize_t n = ::pread(fd, data + done, size - done, page.offset + done);
+          if(n < 0 && errno == EINTR)
+            continue;
+          if(n <= 0) {
+            failed = true;
+            return;
+          }
+          done += n;
+        }
+
+        std::unique_ptr<Loaded> loaded(new Loaded());
+        loaded->vertices = Matrix<double>(3 * page.count, 4);
+        loaded->normals  = Matrix<double>(3 * page.count, 4);
+
+        for(uint32_t i = 0; i < page.count; i++) {
+          for(int k = 0; k < 3; k++) {
+            for(int a = 0; a < 3; a++) {
+              loaded->vertices[3 * i + k][a] = buffer[i].v[k][a];
+              loaded->normals [3 * i + k][a] = buffer[i].n[k][a];
+            }
+            loaded->vertices[3 * i + k][3] = 1.0;
+            loaded->normals [3 * i + k][3] = 1.0;
+          }
+        }
+
+        loaded->arena.reserve(page.count);
+        loaded->triangles.reserve(page.count);
+
+        for(uint32_t i = 0; i < page.count; i++) {
+          loaded->triangles.push_back(loaded->arena.makeTriangle(
+              RefVector(loaded->vertices[3 * i + 0]),
+              RefVector(loaded->vertices[3 * i + 1]),
+              RefVector(loaded->vertices[3 * i + 2]),
+              RefVector(loaded->normals [3 * i + 0]),
+              RefVector(loaded->normals [3 * i + 1]),
+              RefVector(loaded->normals [3 * i + 2]),
+              buffer[i].material));
+        }
+
+        /* building the tree reorders what it is given */
+        std::vector<Triangle*> order = loaded->triangles;
+        loaded->root = loaded->arena.makeTree(order.begin(), order.end());
+
+        page.loaded.swap(loaded);
+      }
+    });
+
+    if(failed)
+      throw std::exception();
+
+    for(uint32_t page : reading) {
+      resident.push_back(page);
+      used += bytes(table[page]);
+      nreads++;
+    }
+
+    npeak = std::max(npeak, used);
+  }
+
+}
@@ -0,0 +1,159 @@
+/*
+ * PagedTree.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Matrix.tpp>
+#include <MeshFile.hpp>
+#include <Model.hpp>
+#include <RegionTracer.hpp>
+#include <Surface.hpp>
+
+#include <render.hpp>
+
+/* std includes */
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ray {
+
+  /**
+   * A tree of Triangles that is kept in a file and only partly in memory, for
+   * scenes that are bigger than the memory of the machine. The top levels of
+   * the tree are always in memory as d_Surfaces. Below them every subtree
+   * that holds few enough Triangles is a page, which stays on disk until a
+   * Ray reaches it and is dropped again, least recently used first, when the
+   * pages in memory would go over the budget.
+   *
+   * A batch of Rays is traced in rounds. A Ray that reaches a page that is
+   * not in memory waits for it instead of loading it on the spot, and the
+   * rest of the batch carries on. Between rounds the pages with waiting Rays
+   * are read, all of them at the same time, and those Rays carry on in the
+   * next round. Each page is read once for every Ray that was waiting on it.
+   *
+   * The tree is the same one that Model builds for a mesh, and a page is
+   * built again from its Triangles in the same order when it is read, so a
+   * Ray hits the same Triangle as it would in a Model. The file is laid out
+   * as follows, in the byte order of the machine that wrote it:
+   *
+   *   char     magic[4]     "RPAG"
+   *   uint32_t version      1
+   *   uint32_t nmaterials, nlights, nnodes, npages
+   *   uint64_t ntriangles, table
+   *   nmaterials x { double ks, kt, alpha, diffuse[3][3] }
+   *   nlights    x { double x, y, z, r, g, b }
+   *   the pages, each holding its Triangles as PagedTriangles
+   *   at table:
+   *   nnodes     x render::d_Surface      the top of the tree, the root first
+   *   npages     x { uint64_t offset; uint32_t first, count; }
+   */
+  class PagedTree : public Region {
+    public:
+
+      /** a Triangle in a page, with its vertices and normals copied in */
+      struct PagedTriangle {
+        double   v[3][3];
+        double   n[3][3];
+        uint16_t material;
+      };
+
+      static const std::string suffix;
+      static const uint32_t    version;
+
+      PagedTree(std::string fileName, size_t budget, uint8_t nthreads);
+      virtual ~PagedTree();
+
+      PagedTree(const PagedTree& tree) = delete;
+      const PagedTree& operator =(const PagedTree& tree) = delete;
+
+      static void write(std::string fileName, mesh::Source& source, uint32_t pageSize);
+
+      /* Region */
+      virtual const Box&                bounds()    const { return _bounds; }
+      virtual const std::vector<Phong>& materials() const { return phong;   }
+
+      virtual bool send(const std::vector<RayQuery>& queries);
+      virtual bool receive(std::vector<RayAnswer>& answers);
+
+      /* getters */
+      inline const std::vector<Light>& lights() const { return _lights; }
+
+      inline uint64_t triangles() const { return ntriangles;   }
+      inline uint32_t     pages() const { return table.size(); }
+      inline uint64_t     reads() const { return nreads;       }
+      inline uint64_t    evicts() const { return nevicts;      }
+      inline uint64_t    rounds() const { return nrounds;      }
+      inline size_t        peak() const { return npeak;        }
+
+    private:
+
+      /** the Surfaces of a page while it is in memory */
+      struct Loaded {
+        Loaded() : vertices(), normals(), arena(), triangles(), root(nullptr) { }
+
+        Matrix<double>         vertices;
+        Matrix<double>         normals;
+        SurfaceArena           arena;
+        std::vector<Triangle*> triangles;
+        Surface::ptr           root;
+      };
+
+      struct Page {
+        uint64_t offset;
+        uint32_t first, count;
+
+        /** null while the page is on disk */
+        std::unique_ptr<Loaded> loaded;
+
+        /** the last round a Ray went through the page */
+        std::atomic<uint64_t> used;
+      };
+
+      /** where a Ray is in the tree */
+      struct Walk {
+        /** the nodes left to visit and where the Ray enters them, the next last */
+        std::vector<std::pair<double, int32_t> > stack;
+
+        /** the page that the closest hit so far is in */
+        int32_t page;
+
+        /** the page the Ray is waiting on, -1 once it is done */
+        int32_t waiting;
+      };
+
+      void trace(const RayQuery& q, Walk& walk, RayAnswer& a);
+      void load(const std::vector<uint32_t>& wanted);
+
+      size_t bytes(const Page& page) const;
+
+      /** the file */
+      int fd;
+
+      std::vector<Phong>             phong;
+      std::vector<Light>             _lights;
+      std::vector<render::d_Surface> nodes;
+      std::vector<Page>              table;
+      Box                            _bounds;
+      uint64_t                       ntriangles;
+
+      /** the pages that are in memory and the bytes they use */
+      std::vector<uint32_t> resident;
+      size_t                used;
+      size_t                budget;
+
+      WorkerPool             pool;
+      std::vector<RayAnswer> answered;
+
+      uint64_t nreads, nevicts, nrounds;
+      size_t   npeak;
+  };
+
+}
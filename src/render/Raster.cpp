@@ -0,0 +1,307 @@
+/*
+ * Raster.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <Raster.hpp>
+#include <Timeline.hpp>
+
+/* std includes */
+#include <algorithm>
+#include <cmath>
+
+/* boost includes */
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+
+namespace ray {
+
+  /**
+   * Signed area of the parallelogram formed by three points on the image. Only
+   * the column and row of the points are used.
+   */
+  static inline double edge(const Vector& a, const Vector& b, double x, double y) {
+    return (b.x() - a.x()) * (y - a.y()) - (b.y() - a.y()) * (x - a.x());
+  }
+
+  /**
+   * Moves a point by an affine transform.
+   *
+   * @param m  the transform
+   * @param v  the point
+   * @return   the transformed point
+   */
+  static inline Vector transformPoint(const Matrix<double>& m, const Vector& v) {
+    return Vector(
+        m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z() + m[0][3],
+        m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z() + m[1][3],
+        m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z() + m[2][3]);
+  }
+
+  /**
+   * Creates an empty visibility buffer for a Camera.
+   *
+   * @param cam   the Camera that is looking at the Model
+   * @param rows  the number of rows in the image
+   * @param cols  the number of columns in the image
+   */
+  Raster::Raster(const Camera& cam, int rows, int cols) :
+      _cam(cam),
+      _rows(rows),
+      _cols(cols),
+      tileRows((rows + RASTER_TILE - 1) / RASTER_TILE),
+      tileCols((cols + RASTER_TILE - 1) / RASTER_TILE),
+      jobs(),
+      fragments(rows * cols),
+      projected(),
+      tiles() { }
+
+  /**
+   * Adds the Triangles of a mesh to the list of things to draw. Nothing is
+   * drawn until rasterize is called. The vector of Triangles must stay alive
+   * until then.
+   *
+   * @param instance   the Instance that places the mesh into the world
+   * @param triangles  the Triangles of the mesh
+   */
+  void Raster::draw(const Instance* instance, const std::vector<Triangle*>& triangles) {
+    Job job;
+
+    job.instance  = instance;
+    job.triangles = &triangles;
+
+    jobs.push_back(job);
+  }
+
+  /**
+   * Fills the visibility buffer with everything that has been drawn. The
+   * Triangles are first projected and sorted into tiles and then every tile is
+   * filled, with the work for both steps split between the threads.
+   *
+   * @param nthreads  the number of threads to use
+   */
+  void Raster::rasterize(uint8_t nthreads) {
+    TIMELINE_SCOPE("rasterize");
+
+    boost::thread_group threads;
+
+    nthreads = std::max(nthreads, uint8_t(1));
+
+    projected.assign(nthreads, std::vector<Projected>());
+    tiles.assign(nthreads,
+        std::vector<std::vector<uint32_t> >(tileRows * tileCols));
+
+    for(int i = 1; i < nthreads; i++)
+      threads.create_thread(boost::bind(&Raster::project, this, i, nthreads));
+    project(0, nthreads);
+    threads.join_all();
+
+    for(int i = 1; i < nthreads; i++)
+      threads.create_thread(boost::bind(&Raster::fill, this, i, nthreads));
+    fill(0, nthreads);
+    threads.join_all();
+
+    jobs.clear();
+    projected.clear();
+    tiles.clear();
+  }
+
+  /**
+   * Checks if any pixel next to a pixel is covered by a Triangle. Pixels that
+   * are not covered but have covered neighbors sit on the edge of the mesh and
+   * may still be hit by their Ray.
+   *
+   * @param row  the row of the pixel
+   * @param col  the column of the pixel
+   * @return     true if the pixel or one of its neighbors is covered
+   */
+  bool Raster::nearCoverage(int row, int col) const {
+    for(int i = std::max(row - 1, 0); i <= std::min(row + 1, _rows - 1); i++)
+      for(int j = std::max(col - 1, 0); j <= std::min(col + 1, _cols - 1); j++)
+        if(at(i, j).surface)
+          return true;
+
+    return false;
+  }
+
+  /**
+   * Projects every Triangle that belongs to a thread onto the image. Parts of
+   * a Triangle that are closer than the plane of the image are cut off since
+   * the camera Rays start on that plane.
+   *
+   * @param thread    the index of the thread
+   * @param nthreads  the total number of threads
+   */
+  void Raster::project(uint32_t thread, uint8_t nthreads) {
+    const double near = -_cam._fl();
+    uint64_t index = 0;
+
+    for(const Job& job : jobs) {
+      const Matrix<double>& transform = job.instance->transform();
+
+      for(const Triangle* tri : *job.triangles) {
+        if(index++ % nthreads != thread)
+          continue;
+
+        Vector view[4], weight[4];
+        Vector clipView[4], clipWeight[4];
+        int nclip = 0;
+
+        for(int i = 0; i < 3; i++) {
+          view[i]   = _cam.toView(transformPoint(transform, tri->vertex(i)));
+          weight[i] = Vector(i == 0, i == 1, i == 2);
+        }
+
+        /* clip the triangle against the plane of the image */
+        for(int i = 0; i < 3; i++) {
+          const int j = (i + 1) % 3;
+          const bool iin = view[i].z() >= near;
+          const bool jin = view[j].z() >= near;
+
+          if(iin) {
+            clipView  [nclip] = view[i];
+            clipWeight[nclip] = weight[i];
+            nclip++;
+          }
+
+          if(iin != jin) {
+            double t = (near - view[i].z()) / (view[j].z() - view[i].z());
+            clipView  [nclip] = view[i]   + (view[j]   - view[i])   * t;
+            clipWeight[nclip] = weight[i] + (weight[j] - weight[i]) * t;
+            nclip++;
+          }
+        }
+
+        for(int i = 1; i + 1 < nclip; i++) {
+          Projected p;
+          int idx[3] = { 0, i, i + 1 };
+
+          for(int k = 0; k < 3; k++) {
+            p.corner[k] = _cam.toImage(clipView[idx[k]], _rows, _cols);
+            p.weight[k] = clipWeight[idx[k]];
+          }
+
+          p.surface  = tri;
+          p.instance = job.instance;
+
+          bin(thread, p);
+        }
+      }
+    }
+  }
+
+  /**
+   * Adds a projected triangle to every tile that it might cover.
+   *
+   * @param thread  the index of the thread
+   * @param tri     the projected triangle
+   */
+  void Raster::bin(uint32_t thread, const Projected& tri) {
+    double xmin = std::min(tri.corner[0].x(), std::min(tri.corner[1].x(), tri.corner[2].x()));
+    double xmax = std::max(tri.corner[0].x(), std::max(tri.corner[1].x(), tri.corner[2].x()));
+    double ymin = std::min(tri.corner[0].y(), std::min(tri.corner[1].y(), tri.corner[2].y()));
+    double ymax = std::max(tri.corner[0].y(), std::max(tri.corner[1].y(), tri.corner[2].y()));
+
+    if(xmax < 0 || ymax < 0 || xmin > _cols - 1 || ymin > _rows - 1)
+      return;
+
+    int cmin = std::max(int(std::ceil (xmin)), 0);
+    int cmax = std::min(int(std::floor(xmax)), _cols - 1);
+    int rmin = std::max(int(std::ceil (ymin)), 0);
+    int rmax = std::min(int(std::floor(ymax)), _rows - 1);
+
+    if(cmin > cmax || rmin > rmax)
+      return;
+
+    uint32_t index = projected[thread].size();
+    projected[thread].push_back(tri);
+
+    for(int i = rmin / RASTER_TILE; i <= rmax / RASTER_TILE; i++)
+      for(int j = cmin / RASTER_TILE; j <= cmax / RASTER_TILE; j++)
+        tiles[thread][i * tileCols + j].push_back(index);
+  }
+
+  /**
+   * Fills every tile that belongs to a thread.
+   *
+   * @param thread    the index of the thread
+   * @param nthreads  the total number of threads
+   */
+  void Raster::fill(uint32_t thread, uint8_t nthreads) {
+    for(int tile = thread; tile < tileRows * tileCols; tile += nthreads)
+      fillTile(tile);
+  }
+
+  /**
+   * Fills a single tile of the visibility buffer. The triangles are visited in
+   * the same order no matter how the work was split so that ties in depth are
+   * always broken the same way.
+   *
+   * @param tile  the index of the tile
+   */
+  void Raster::fillTile(int tile) {
+    const int r0 = (tile / tileCols) * RASTER_TILE;
+    const int c0 = (tile % tileCols) * RASTER_TILE;
+    const int r1 = std::min(r0 + RASTER_TILE, _rows) - 1;
+    const int c1 = std::min(c0 + RASTER_TILE, _cols) - 1;
+
+    for(uint32_t t = 0; t < tiles.size(); t++) {
+      for(uint32_t index : tiles[t][tile]) {
+        const Projected& p = projected[t][index];
+        const Vector& a = p.corner[0];
+        const Vector& b = p.corner[1];
+        const Vector& c = p.corner[2];
+
+        double area = edge(a, b, c.x(), c.y());
+        if(area == 0.0)
+          continue;
+
+        double xmin = std::min(a.x(), std::min(b.x(), c.x()));
+        double xmax = std::max(a.x(), std::max(b.x(), c.x()));
+        double ymin = std::min(a.y(), std::min(b.y(), c.y()));
+        double ymax = std::max(a.y(), std::max(b.y(), c.y()));
+
+        int cmin = std::max(int(std::ceil (xmin)), c0);
+        int cmax = std::min(int(std::floor(xmax)), c1);
+        int rmin = std::max(int(std::ceil (ymin)), r0);
+        int rmax = std::min(int(std::floor(ymax)), r1);
+
+        for(int row = rmin; row <= rmax; row++) {
+          for(int col = cmin; col <= cmax; col++) {
+            double l0 = edge(b, c, col, row) / area;
+            double l1 = edge(c, a, col, row) / area;
+            double l2 = edge(a, b, col, row) / area;
+
+            if(l0 < 0.0 || l1 < 0.0 || l2 < 0.0)
+              continue;
+
+            /* interpolate in a perspective correct way */
+            double w0 = l0 / a.z();
+            double w1 = l1 / b.z();
+            double w2 = l2 / c.z();
+            double depth = 1.0 / (w0 + w1 + w2);
+
+            Fragment& frag = fragments[row * _cols + col];
+
+            if(depth > frag.depth)
+              continue;
+            if(depth == frag.depth && frag.surface->id < p.surface->id)
+              continue;
+
+            Vector bary = (p.weight[0] * w0 + p.weight[1] * w1 + p.weight[2] * w2) * depth;
+
+            frag.surface  = p.surface;
+            frag.instance = p.instance;
+            frag.depth    = depth;
+            frag.beta     = bary.y();
+            frag.gamma    = bary.z();
+          }
+        }
+      }
+    }
+  }
+
+}
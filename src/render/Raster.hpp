@@ -0,0 +1,115 @@
+/*
+ * Raster.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* local includes */
+#include <Camera.hpp>
+#include <Surface.hpp>
+#include <Vector.hpp>
+
+/* std includes */
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+namespace ray {
+
+#define RASTER_TILE 32
+
+  /**
+   * One entry of the visibility buffer. This records the Triangle that is
+   * closest to the Camera for a pixel, the Instance that placed it and the
+   * barycentric coordinates of the hit on the Triangle.
+   */
+  struct Fragment {
+    Fragment() :
+      surface(nullptr),
+      instance(nullptr),
+      depth(std::numeric_limits<double>::max()),
+      beta(0),
+      gamma(0) { }
+
+    /** the closest Triangle, null if nothing covers the pixel */
+    const Triangle* surface;
+
+    /** the Instance that placed the Triangle */
+    const Instance* instance;
+
+    /** the distance in front of the Camera */
+    double depth;
+
+    /** the weights of the second and third vertices of the Triangle */
+    float beta, gamma;
+  };
+
+  /**
+   * Software rasterizer that finds the first Surface seen by every pixel of a
+   * Camera. Triangles are projected and sorted into square tiles of the image
+   * and the tiles are then filled in parallel. The pixel centers match the
+   * Rays that are created by Camera::getRays so that the result can stand in
+   * for tracing the camera Rays.
+   */
+  class Raster {
+    public:
+
+      Raster(const Camera& cam, int rows, int cols);
+
+      void draw(const Instance* instance, const std::vector<Triangle*>& triangles);
+      void rasterize(uint8_t nthreads);
+
+      bool nearCoverage(int row, int col) const;
+
+      /* getters */
+      inline int rows() const { return _rows; }
+      inline int cols() const { return _cols; }
+
+      inline const Fragment& at(int row, int col) const
+      { return fragments[row * _cols + col]; }
+
+    private:
+
+      /** a triangle after it has been moved onto the image */
+      struct Projected {
+        /** column, row and depth of each corner */
+        Vector corner[3];
+
+        /** the barycentric coordinates of each corner on the original Triangle */
+        Vector weight[3];
+
+        const Triangle* surface;
+        const Instance* instance;
+      };
+
+      /** the triangles of a single Instance that still need to be drawn */
+      struct Job {
+        const Instance*               instance;
+        const std::vector<Triangle*>* triangles;
+      };
+
+      void project(uint32_t thread, uint8_t nthreads);
+      void bin(uint32_t thread, const Projected& tri);
+      void fill(uint32_t thread, uint8_t nthreads);
+      void fillTile(int tile);
+
+      Camera _cam;
+      int    _rows;
+      int    _cols;
+      int    tileRows;
+      int    tileCols;
+
+      std::vector<Job>      jobs;
+      std::vector<Fragment> fragments;
+
+      /** projected triangles, one list for each thread */
+      std::vector<std::vector<Projected> > projected;
+
+      /** the triangles touching each tile, one set of tiles for each thread */
+      std::vector<std::vector<std::vector<uint32_t> > > tiles;
+  };
+
+}
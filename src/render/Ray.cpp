@@ -11,22 +11,26 @@
 
 namespace ray {
 
-  Ray::Ray() : _source(nullptr) { }
+  Ray::Ray() : _source(nullptr), _instance(nullptr) { }
 
   /**
    * Constructs a Ray out of the compontent Vectors.
    *
-   * @param U  The direction that the ray is traveling
-   * @param L  The origin of the Ray
+   * @param U         The direction that the ray is traveling
+   * @param L         The origin of the Ray
+   * @param source    The Surface that the Ray bounced off of
+   * @param instance  The Instance that placed the source Surface
    */
-  Ray::Ray(const Vector& L, const Vector& U, const Surface* source):
+  Ray::Ray(const Vector& L, const Vector& U, const Surface* source,
+      const Surface* instance):
       _L(L),
       _U(U),
       _iU(1.0 / U.x(), 1.0 / U.y(), 1.0 / U.z()),
       _iL(1.0 / L.x(), 1.0 / L.y(), 1.0 / L.z()),
       _positive({U.x()  > 0.0, U.y()  > 0.0, U.z()  > 0.0}),
       _nonzero ({U.x() != 0.0, U.y() != 0.0, U.z() != 0.0}),
-      _source(source) { }
+      _source(source),
+      _instance(instance) { }
 
   Ray::operator ray::render::d_Ray() const {
     render::d_Ray ret;
@@ -42,6 +46,7 @@ namespace ray {
     ret.nonzero [1] = _nonzero [1];
     ret.nonzero [2] = _nonzero [2];
     ret.src      = -1;
+    ret.inst     = -1;
 
     return ret;
   }
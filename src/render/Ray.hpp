@@ -24,7 +24,8 @@ namespace ray {
     public:
 
       Ray();
-      Ray(const Vector& L, const Vector& U, const Surface* source = nullptr);
+      Ray(const Vector& L, const Vector& U, const Surface* source = nullptr,
+          const Surface* instance = nullptr);
 
       inline const Vector&  U() const { return  _U; }
       inline const Vector&  L() const { return  _L; }
@@ -34,7 +35,8 @@ namespace ray {
       inline bool posi(int idx) const { return _positive[idx]; }
       inline bool zero(int idx) const { return _nonzero[idx];  }
 
-      inline const Surface* source() const { return _source; }
+      inline const Surface*   source() const { return _source;   }
+      inline const Surface* instance() const { return _instance; }
 
       operator render::d_Ray() const;
 
@@ -51,6 +53,9 @@ namespace ray {
 
       /** the surface that the Ray bounced off of */
       const Surface* _source;
+
+      /** the Instance that the source surface was placed by */
+      const Surface* _instance;
   };
 
   class Intersection {
@@ -61,21 +66,25 @@ namespace ray {
         _location(),
         _normal  (),
         _viewing (),
-        _distance(std::numeric_limits<double>::max()) { }
+        _distance(std::numeric_limits<double>::max()),
+        _instance(nullptr) { }
 
       Intersection(
           const Surface* source  ,
           Vector         location,
           Vector         normal  ,
           Vector         viewing ,
-          double         distance) :
+          double         distance,
+          const Surface* instance = nullptr) :
         _source  (source  ),
         _location(location),
         _normal  (normal  ),
         _viewing (viewing ),
-        _distance(distance) { }
+        _distance(distance),
+        _instance(instance) { }
 
       inline const Surface*   source() const { return _source;   }
+      inline const Surface* instance() const { return _instance; }
       inline       Vector          i() const { return _location; }
       inline       Vector          n() const { return _normal;   }
       inline       Vector          v() const { return _viewing;  }
@@ -99,6 +108,9 @@ namespace ray {
 
       /** The distance from the Ray's source to the location of Intersection */
       double   _distance;
+
+      /** The Instance that placed the source Surface, if there is one */
+      const Surface* _instance;
   };
 
   std::ostream& operator<<(std::ostream& ostr, const Ray& ray);
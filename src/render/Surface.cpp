@@ -10,6 +10,7 @@
 #include <Model.hpp>
 #include <Surface.hpp>
 #include <Ray.hpp>
+#include <Stats.hpp>
 #include <util.tpp>
 
 /* std includes */
@@ -18,8 +19,6 @@
 
 namespace ray {
 
-  uint32_t Surface::idgen = 0;
-
   /**
    * Determines if a Ray and a Surface intersect. This also calculates the
    * location of the intersection.
@@ -86,6 +85,8 @@ namespace ray {
     double tmin, tmax;
     double dmin, dmax;
 
+    STATS_COUNT(boxTests);
+
     if(ray.zero(0)) {
       if(ray.posi(0)) {
         dmin = (min().x() - ray.L().x()) * ray.iU().x();
@@ -179,6 +180,28 @@ namespace ray {
     return true;
   }
 
+  /**
+   * Finds how far along a line it enters the Box. This does not check that
+   * the line hits the Box at all, that is left to intersect.
+   *
+   * @param L  the start of the line
+   * @param U  the direction of the line
+   * @return   the distance to where the line enters, 0 if it starts inside
+   */
+  double Box::entry(const Vector& L, const Vector& U) const {
+    double ret = 0.0;
+
+    for(int a = 0; a < 3; a++) {
+      if(U[a] == 0.0)
+        continue;
+
+      double side = U[a] > 0.0 ? min()[a] : min()[a] + len()[a];
+      ret = std::max(ret, (side - L[a]) / U[a]);
+    }
+
+    return ret;
+  }
+
   /* ************************************************************************ */
   /* *** Surface Tree ******************************************************* */
   /* ************************************************************************ */
@@ -207,17 +230,112 @@ namespace ray {
     Intersection curr;
     bool found = false;
 
-    for(Surface::ptr surf : children) {
-      if(surf->intersect(ray, curr)) {
+    STATS_ENTER();
+
+    for(int i = 0; i < nchildren; i++) {
+      if(children[i]->intersect(ray, curr)) {
         best  = Intersection::best(best, curr);
         found = true;
       }
     }
 
+    STATS_LEAVE();
+
     inter = best;
     return found;
   }
 
+  /**
+   * Recalculates the bounds of the tree from the bounds of its children. This
+   * only looks at the direct children, so trees need to be refit from the
+   * bottom up. A tree with no children has no bounds, so empty children are
+   * left out.
+   */
+  void SurfaceTree::refit() {
+    Surface::ptr filled[BRANCHING_FACTOR - 1];
+    int          count = 0;
+
+    for(int i = 0; i < nchildren; i++) {
+      SurfaceTree* tree = dynamic_cast<SurfaceTree*>(children[i]);
+
+      if(!tree || tree->nchildren != 0)
+        filled[count++] = children[i];
+    }
+
+    bounds = Box(filled, filled + count);
+  }
+
+  /**
+   * Adds a Surface to the tree. The Surface is added to the first node with
+   * room for it that is found by following the children whose bounds grow the
+   * least. If a full node is reached that only contains leaves, one of the
+   * leaves is replaced by a new node that holds both it and the new Surface.
+   * The bounds of the tree are not changed, the caller needs to refit every
+   * node from the returned node up to the root.
+   *
+   * @param arena  the arena that owns the tree
+   * @param surf   the Surface to add
+   * @return       the lowest node that was changed
+   */
+  SurfaceTree* SurfaceTree::insert(SurfaceArena& arena, Surface::ptr surf) {
+    SurfaceTree* node = this;
+    Box add = surf->getBounds();
+
+    while(node->nchildren == BRANCHING_FACTOR - 1) {
+      int    best = 0;
+      double cost = std::numeric_limits<double>::max();
+
+      for(int i = 0; i < node->nchildren; i++) {
+        Box curr = node->children[i]->getBounds();
+        double grow = Box(curr, add).area() - curr.area();
+
+        if(grow < cost) {
+          best = i;
+          cost = grow;
+        }
+      }
+
+      SurfaceTree* next = dynamic_cast<SurfaceTree*>(node->children[best]);
+
+      if(next == nullptr) {
+        Surface::ptr pair[2] = { node->children[best], surf };
+
+        next = arena.makeTree(pair, pair + 2);
+        next->_parent = node;
+        node->children[best] = next;
+        return next;
+      }
+
+      node = next;
+    }
+
+    node->children[node->nchildren++] = surf;
+    surf->_parent = node;
+    return node;
+  }
+
+  /**
+   * Removes one of the direct children of the tree. The bounds of the tree are
+   * not changed, the caller needs to refit the tree and its parents.
+   *
+   * @param surf  the child to remove
+   * @return      true if the Surface was a child of this tree
+   */
+  bool SurfaceTree::remove(Surface::ptr surf) {
+    for(int i = 0; i < nchildren; i++) {
+      if(children[i] == surf) {
+        for(int j = i + 1; j < nchildren; j++)
+          children[j - 1] = children[j];
+
+        nchildren--;
+        surf->_parent = nullptr;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
   render::d_Surface SurfaceTree::getDevice() const {
     render::d_Surface ret;
 
@@ -226,14 +344,18 @@ namespace ray {
     ret.min = bounds.min();
     ret.len = bounds.len();
 
+    /* an empty tree has no bounds, no Ray enters a box with a negative side */
+    if(nchildren == 0)
+      ret.len = Vector(-1.0);
+
     ret.which = render::d_Surface::tree;
 
     ret.d_axis = -1;
     ret.v_axis = -1;
 
-    if(children.size() == 1) {
+    if(nchildren == 1) {
       ret.d_axis = children[0]->id;
-    } else if(children.size() == 2) {
+    } else if(nchildren == 2) {
       ret.d_axis = children[0]->id;
       ret.v_axis = children[1]->id;
     }
@@ -241,6 +363,198 @@ namespace ray {
     return ret;
   }
 
+  /* ************************************************************************ */
+  /* *** Instance *********************************************************** */
+  /* ************************************************************************ */
+
+  /**
+   * Moves a point by an affine transform.
+   *
+   * @param m  the transform
+   * @param v  the point
+   * @return   the transformed point
+   */
+  static inline Vector transformPoint(const Matrix<double>& m, const Vector& v) {
+    return Vector(
+        m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z() + m[0][3],
+        m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z() + m[1][3],
+        m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z() + m[2][3]);
+  }
+
+  /**
+   * Moves a direction by an affine transform, ignoring the translation.
+   *
+   * @param m  the transform
+   * @param v  the direction
+   * @return   the transformed direction
+   */
+  static inline Vector transformDirection(const Matrix<double>& m, const Vector& v) {
+    return Vector(
+        m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z(),
+        m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z(),
+        m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z());
+  }
+
+  /**
+   * Moves a normal by an affine transform. This multiplies by the transpose
+   * of the inverse of the transform so that normals stay perpendicular to
+   * their surfaces under non-uniform scaling.
+   *
+   * @param inv  the inverse of the transform
+   * @param n    the normal
+   * @return     the transformed normal
+   */
+  static inline Vector transformNormal(const Matrix<double>& inv, const Vector& n) {
+    return Vector(
+        inv[0][0] * n.x() + inv[1][0] * n.y() + inv[2][0] * n.z(),
+        inv[0][1] * n.x() + inv[1][1] * n.y() + inv[2][1] * n.z(),
+        inv[0][2] * n.x() + inv[1][2] * n.y() + inv[2][2] * n.z()).normalize();
+  }
+
+  /**
+   * Constructs an Instance of a mesh.
+   *
+   * @param id         the id of the Instance inside of its arena
+   * @param root       the root Surface of the mesh
+   * @param transform  the object to world transform for the mesh
+   */
+  Instance::Instance(uint32_t id, Surface::ptr root, const Matrix<double>& transform) :
+      Surface(id, 0),
+      _root(root),
+      _transform(),
+      _inverse(),
+      _identity(true),
+      bounds()
+  {
+    setTransform(transform);
+  }
+
+  /**
+   * Moves the Instance to a new place in the world. The bounds of the Instance
+   * are updated but the trees that contain it are not.
+   *
+   * @param transform  the new object to world transform for the mesh
+   */
+  void Instance::setTransform(const Matrix<double>& transform) {
+    Matrix<double> ident = ray::eye<double>(4);
+    Box local = _root->getBounds();
+    Vector lo, hi;
+
+    _transform = transform;
+    _inverse   = transform.inv();
+    _identity  = true;
+
+    for(int i = 0; i < 4; i++)
+      for(int j = 0; j < 4; j++)
+        _identity = _identity && transform[i][j] == ident[i][j];
+
+    for(int i = 0; i < 8; i++) {
+      Vector corner = transformPoint(_transform, Vector(
+          local.min().x() + (i & 1 ? local.len().x() : 0.0),
+          local.min().y() + (i & 2 ? local.len().y() : 0.0),
+          local.min().z() + (i & 4 ? local.len().z() : 0.0)));
+
+      lo = i == 0 ? corner : min(lo, corner);
+      hi = i == 0 ? corner : max(hi, corner);
+    }
+
+    bounds = Box(lo, hi - lo);
+  }
+
+  /**
+   * Get the bounding region of the Instance in world space.
+   *
+   * @return  the Bounding region as a Box
+   */
+  Box Instance::getBounds() const {
+    return bounds;
+  }
+
+  /**
+   * Calculates the Intersection of a Ray and an Instance. The Ray is moved into
+   * the space of the mesh and the resulting Intersection is moved back out into
+   * world space. Since the direction of the Ray is not normalized inside of the
+   * mesh the distance along the Ray is the same in both spaces.
+   *
+   * @param ray    the Ray in world space
+   * @param inter  the location of the intersection
+   * @return       if the Ray intersected the mesh
+   */
+  bool Instance::getIntersection(const Ray& ray, Intersection& inter) const {
+    return getIntersection(ray, _root, inter);
+  }
+
+  /**
+   * Calculates the Intersection of a Ray and a single part of the mesh that is
+   * placed by the Instance. This is used when something other than the tree
+   * of the mesh has already decided which Surface the Ray should hit.
+   *
+   * @param ray    the Ray in world space
+   * @param surf   the Surface of the mesh to test, in the space of the mesh
+   * @param inter  the location of the intersection
+   * @return       if the Ray intersected the Surface
+   */
+  bool Instance::getIntersection(const Ray& ray, const Surface* surf, Intersection& inter) const {
+    Intersection local;
+
+    /* the source of the ray only belongs to this mesh if it came from here */
+    const Surface* source = ray.instance() == this ? ray.source() : nullptr;
+
+    if(_identity) {
+      if(source == ray.source()) {
+        if(!surf->getIntersection(ray, local))
+          return false;
+      } else if(!surf->getIntersection(Ray(ray.L(), ray.U()), local)) {
+        return false;
+      }
+
+      inter = Intersection(local.source(), local.i(), local.n(), local.v(),
+          local.distance(), this);
+      return true;
+    }
+
+    Ray lray(
+        transformPoint    (_inverse, ray.L()),
+        transformDirection(_inverse, ray.U()),
+        source);
+
+    if(!surf->intersect(lray, local))
+      return false;
+
+    inter = Intersection(
+        local.source(),
+        transformPoint(_transform, local.i()),
+        transformNormal(_inverse, local.n()),
+        ray.U().normalize(),
+        local.distance(),
+        this);
+    return true;
+  }
+
+  render::d_Surface Instance::getDevice() const {
+    render::d_Surface ret;
+
+    ret.id  = id;
+    ret.mat = 0;
+    ret.min = bounds.min();
+    ret.len = bounds.len();
+
+    ret.which = render::d_Surface::instance;
+
+    ret.d_axis = _root->id;
+    ret.v_axis = -1;
+
+    ret.va = Vector(_inverse[0][0], _inverse[0][1], _inverse[0][2], _inverse[0][3]);
+    ret.vb = Vector(_inverse[1][0], _inverse[1][1], _inverse[1][2], _inverse[1][3]);
+    ret.vc = Vector(_inverse[2][0], _inverse[2][1], _inverse[2][2], _inverse[2][3]);
+
+    ret.na = Vector(_transform[0][0], _transform[0][1], _transform[0][2], _transform[0][3]);
+    ret.nb = Vector(_transform[1][0], _transform[1][1], _transform[1][2], _transform[1][3]);
+    ret.nc = Vector(_transform[2][0], _transform[2][1], _transform[2][2], _transform[2][3]);
+
+    return ret;
+  }
+
   /* ************************************************************************ */
   /* *** Triangle *********************************************************** */
   /* ************************************************************************ */
@@ -249,6 +563,7 @@ namespace ray {
    * Constructor the a Triangle. This needs to be passed the 3 Vectors that at
    * the vertices for the Triangle and the normals for the Vectors.
    *
+   * @param id  the id of the Triangle inside of its arena
    * @param va  first Vector
    * @param vb  second Vector
    * @param vc  third Vector
@@ -256,10 +571,11 @@ namespace ray {
    * @param nb  second normal
    * @param nc  third normal
    */
-  Triangle::Triangle(RefVector _va, RefVector _vb, RefVector _vc,
+  Triangle::Triangle(uint32_t id,
+                     RefVector _va, RefVector _vb, RefVector _vc,
                      RefVector _na, RefVector _nb, RefVector _nc,
                      uint16_t material) :
-      Surface(material),
+      Surface(id, material),
       va(_va), vb(_vb), vc(_vc),
       na(_na), nb(_nb), nc(_nc),
       _norm(0, 0, 0),
@@ -303,6 +619,8 @@ namespace ray {
       std::swap(na, nb);
     }
 
+    /* normalAt interpolates along the edge from vb to vc */
+    b = vc - vb;
     x = fabs(b.x());
     y = fabs(b.y());
     z = fabs(b.z());
@@ -364,6 +682,8 @@ namespace ray {
     if(this == ray.source())
       return false;
 
+    STATS_COUNT(triangleTests);
+
     u = vb - va;
     v = vc - va;
     n = cross(u, v);
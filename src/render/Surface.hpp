@@ -8,6 +8,7 @@
 #pragma once
 
 /* local includes */
+#include <Pool.tpp>
 #include <RefVector.hpp>
 #include <Vector.hpp>
 
@@ -23,6 +24,8 @@ namespace ray {
   class Ray;
   class Intersection;
   class Model;
+  class SurfaceArena;
+  class SurfaceTree;
 
   class Box {
     public:
@@ -37,8 +40,12 @@ namespace ray {
       inline const Vector& min() const { return _min; }
       inline const Vector& len() const { return _len; }
 
-      bool contains(const Box& box) const;
-      bool intersect(const Ray& ray) const;
+      inline double area() const
+      { return 2.0 * (_len.x() * _len.y() + _len.y() * _len.z() + _len.z() * _len.x()); }
+
+      bool   contains(const Box& box) const;
+      bool   intersect(const Ray& ray) const;
+      double entry(const Vector& L, const Vector& U) const;
 
     private:
 
@@ -49,12 +56,14 @@ namespace ray {
   class Surface {
     public:
 
-      typedef std::shared_ptr<Surface> ptr;
+      typedef Surface* ptr;
 
-      Surface(uint16_t material) : id(idgen++), _material(material) { }
+      Surface(uint32_t id, uint16_t material) :
+        id(id), _material(material), _parent(nullptr) { }
       virtual ~Surface() { }
 
-      inline uint16_t material() const { return _material; }
+      inline uint16_t     material() const { return _material; }
+      inline SurfaceTree*   parent() const { return _parent;   }
 
       bool intersect(const Ray& ray, Intersection& inter) const;
 
@@ -63,7 +72,6 @@ namespace ray {
 
       virtual void place(std::vector<render::d_Surface>& out) const = 0;
 
-      static uint32_t idgen;
       uint32_t id;
 
       operator render::d_Surface() const;
@@ -73,13 +81,20 @@ namespace ray {
       virtual render::d_Surface getDevice() const = 0;
 
       uint16_t _material;
+
+    private:
+
+      friend class SurfaceTree;
+
+      /** the tree that contains this Surface, null for the root of a tree */
+      SurfaceTree* _parent;
   };
 
   class SurfaceTree : public Surface {
     public:
 
       template<typename iter_t>
-      SurfaceTree(iter_t begin, iter_t end);
+      SurfaceTree(SurfaceArena& arena, uint32_t id, iter_t begin, iter_t end);
 
       virtual ~SurfaceTree() { }
 
@@ -87,20 +102,29 @@ namespace ray {
       virtual bool getIntersection(const Ray& ray, Intersection& inter) const;
 
       virtual void place(std::vector<render::d_Surface>& out) const
-      { out[id] = render::d_Surface(*this); for(const Surface::ptr s : children) s->place(out); }
+      { out[id] = render::d_Surface(*this); for(int i = 0; i < nchildren; i++) children[i]->place(out); }
+
+      /* incremental updates */
+      void         refit();
+      SurfaceTree* insert(SurfaceArena& arena, Surface::ptr surf);
+      bool         remove(Surface::ptr surf);
+
+      inline uint8_t size() const { return nchildren; }
 
     private:
 
       virtual render::d_Surface getDevice() const;
 
-      std::vector<Surface::ptr> children;
-      Box                       bounds;
+      Surface::ptr children[BRANCHING_FACTOR - 1];
+      uint8_t      nchildren;
+      Box          bounds;
   };
 
   class Triangle : public Surface {
     public:
 
-      Triangle(RefVector va, RefVector vb, RefVector vc,
+      Triangle(uint32_t id,
+               RefVector va, RefVector vb, RefVector vc,
                RefVector na, RefVector nb, RefVector nc,
                uint16_t material);
 
@@ -112,6 +136,9 @@ namespace ray {
       inline virtual void place(std::vector<render::d_Surface>& out) const
       { out[id] = render::d_Surface(*this); }
 
+      inline Vector vertex(int idx) const
+      { return idx == 0 ? Vector(va) : idx == 1 ? Vector(vb) : Vector(vc); }
+
     private:
 
       virtual render::d_Surface getDevice() const;
@@ -127,6 +154,88 @@ namespace ray {
       Box       bounds;
   };
 
+  /**
+   * Places a mesh into the world. The mesh is shared between every Instance
+   * that refers to it, and rays are moved into the space of the mesh while it
+   * is being traversed.
+   */
+  class Instance : public Surface {
+    public:
+
+      Instance(uint32_t id, Surface::ptr root, const Matrix<double>& transform);
+
+      virtual ~Instance() { }
+
+      virtual Box getBounds() const;
+      virtual bool getIntersection(const Ray& ray, Intersection& inter) const;
+
+      bool getIntersection(const Ray& ray, const Surface* surf, Intersection& inter) const;
+
+      inline virtual void place(std::vector<render::d_Surface>& out) const
+      { out[id] = render::d_Surface(*this); }
+
+      inline Surface::ptr          root()      const { return _root;      }
+      inline const Matrix<double>& transform() const { return _transform; }
+
+      void setTransform(const Matrix<double>& transform);
+
+    private:
+
+      virtual render::d_Surface getDevice() const;
+
+      Surface::ptr   _root;
+      Matrix<double> _transform;
+      Matrix<double> _inverse;
+      bool           _identity;
+      Box            bounds;
+  };
+
+  /**
+   * Owns every Surface that belongs to a Model. Surfaces are placed into
+   * contiguous Pools instead of being allocated one at a time, are given ids
+   * that are local to the Model, and are all released when the arena is.
+   */
+  class SurfaceArena {
+    public:
+
+      typedef std::shared_ptr<SurfaceArena> ptr;
+
+      SurfaceArena() : triangles(), trees(), instances(), idgen(0) { }
+
+      SurfaceArena(const SurfaceArena& arena) = delete;
+      const SurfaceArena& operator =(const SurfaceArena& arena) = delete;
+
+      template<typename... Args>
+      inline Triangle* makeTriangle(Args&&... args)
+      { return triangles.make(idgen++, std::forward<Args>(args)...); }
+
+      template<typename iter_t>
+      inline SurfaceTree* makeTree(iter_t begin, iter_t end)
+      { return trees.make(*this, idgen++, begin, end); }
+
+      inline Instance* makeInstance(Surface::ptr root, const Matrix<double>& transform)
+      { return instances.make(idgen++, root, transform); }
+
+      /**
+       * Makes sure that the Surfaces for a mesh will be contiguous in memory.
+       * A tree over n Surfaces never has more than n interior nodes.
+       *
+       * @param ntriangles  the number of Triangles that will be created
+       */
+      inline void reserve(size_t ntriangles)
+      { triangles.reserve(ntriangles); trees.reserve(ntriangles); }
+
+      /** the number of ids that have been handed out by the arena */
+      inline uint32_t size() const { return idgen; }
+
+    private:
+
+      Pool<Triangle>    triangles;
+      Pool<SurfaceTree> trees;
+      Pool<Instance>    instances;
+      uint32_t          idgen;
+  };
+
   /* ************************************************************************ */
   /* *** template function declarations ************************************* */
   /* ************************************************************************ */
@@ -141,6 +250,9 @@ namespace ray {
   Box::Box(iter_t begin, iter_t end) :
       _min(0, 0, 0), _len(0, 0, 0)
   {
+    if(begin == end)
+      return;
+
     auto base = (*begin)->getBounds();
 
     for(auto iter = begin + 1; iter != end; iter++)
@@ -162,15 +274,20 @@ namespace ray {
    * will divide the list up to create sub-trees and then create the current
    * tree with the two sub-trees.
    *
+   * @param arena  the arena that the sub-trees are created in
+   * @param id     the id of the tree inside of the arena
    * @param begin  the beginning iterator of the collection
    * @param end    the ending iterator of the collection
    */
   template<typename iter_t>
-  SurfaceTree::SurfaceTree(iter_t begin, iter_t end) :
-      Surface(0), children(), bounds(begin, end)
+  SurfaceTree::SurfaceTree(SurfaceArena& arena, uint32_t id, iter_t begin, iter_t end) :
+      Surface(id, 0), children(), nchildren(0), bounds(begin, end)
   {
     if((end - begin) < BRANCHING_FACTOR) {
-      children = std::vector<Surface::ptr>(begin, end);
+      for(iter_t iter = begin; iter != end; iter++) {
+        children[nchildren] = *iter;
+        children[nchildren++]->_parent = this;
+      }
     } else {
 
       auto seperator = begin + ((end - begin) / 2);
@@ -180,11 +297,11 @@ namespace ray {
 
       std::sort(begin, end, compfunc);
 
-      auto a = std::make_shared<SurfaceTree>(begin, seperator);
-      auto b = std::make_shared<SurfaceTree>(seperator, end);
+      children[nchildren++] = arena.makeTree(begin, seperator);
+      children[nchildren++] = arena.makeTree(seperator, end);
 
-      children.push_back(a);
-      children.push_back(b);
+      children[0]->_parent = this;
+      children[1]->_parent = this;
     }
   }
 
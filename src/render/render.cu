@@ -23,6 +23,45 @@
 #define MAXIMUM_ITERATIONS   512
 #define MINIMUM_CONTRIBUTION 0.0039
 
+/* the device has no thread_local, so the counters of each Ray are kept in a
+ * slot of its own that d_Model points at and are added up by Trace */
+#ifdef STATS
+
+#define D_STATS_COUNT(model, field) \
+  do { (model)->stats->field++; } while(0)
+
+#define D_STATS_BASE(model) \
+  uint32_t _base = (model)->depth
+
+#define D_STATS_DEPTH(model, size) do {                            \
+    (model)->depth = _base + (size);                               \
+    if((model)->depth > (model)->deepest)                          \
+      (model)->deepest = (model)->depth;                           \
+  } while(0)
+
+#define D_STATS_RAY(model, kind, hit) do {                         \
+    (model)->stats->kind++;                                        \
+    (model)->stats->hits  += (hit) ? 1 : 0;                        \
+    (model)->stats->depth += (model)->deepest;                     \
+    (model)->deepest = 0;                                          \
+  } while(0)
+
+#else
+
+#define D_STATS_COUNT(model, field) \
+  do { } while(0)
+
+#define D_STATS_BASE(model) \
+  do { } while(0)
+
+#define D_STATS_DEPTH(model, size) \
+  do { } while(0)
+
+#define D_STATS_RAY(model, kind, hit) \
+  do { } while(0)
+
+#endif
+
 namespace ray {
 
   namespace render {
@@ -85,6 +124,12 @@ namespace ray {
         d_Surface*  surfaces;
         d_Material* materials;
         d_Light*    lights;
+
+        /* the counters of the Ray and how deep in the tree it is, only used
+         * when built with STATS */
+        RayStats* stats;
+        uint32_t  depth;
+        uint32_t  deepest;
     };
 
     __device__ d_Intersection best_of(
@@ -107,6 +152,12 @@ namespace ray {
         const d_Ray& ray,
         d_Intersection& inter);
 
+    __device__ bool intersectInstance(
+        d_Model* model,
+        d_Surface& curr,
+        const d_Ray& ray,
+        d_Intersection& inter);
+
     __device__ Vector normalAt(
         d_Surface& surf, const
         Vector& inter);
@@ -284,22 +335,34 @@ namespace ray {
 
       bool found = false;
 
+      D_STATS_BASE(model);
       stack.push(selem(root));
 
       while(stack.size() != 0) {
+        D_STATS_DEPTH(model, stack.size());
+
         if(stack.peek().surf >= 0) {
           d_Surface& surf = model->surfaces[stack.peek().surf];
 
+          D_STATS_COUNT(model, boxTests);
           if(!intersect(surf.min, surf.len, ray) ||
               ray.src == surf.id) {
             stack.pop();
           } else if(surf.which == d_Surface::triangle) {
+            D_STATS_COUNT(model, triangleTests);
             if(intersect(surf, ray, curr)) {
               best = best_of(best, curr);
               found = true;
             }
             stack.pop();
 
+          } else if(surf.which == d_Surface::instance) {
+            if(intersectInstance(model, surf, ray, curr)) {
+              best = best_of(best, curr);
+              found = true;
+            }
+            stack.pop();
+
           } else if(surf.which == d_Surface::tree) {
             switch(stack.peek().lr) {
               case selem::left:
@@ -320,6 +383,8 @@ namespace ray {
         }
       }
 
+      D_STATS_DEPTH(model, 0);
+
       if(found) {
         inter = best;
         return true;
@@ -382,6 +447,52 @@ namespace ray {
       return true;
     }
 
+    /**
+     * Intersects a ray with an Instance of a mesh. The ray is moved into the
+     * space of the mesh, intersected with the mesh, and the result is moved
+     * back into world space.
+     *
+     * @param model  the model that contains the mesh
+     * @param curr   the instance that will be checked for intersection
+     * @param ray    the ray in world space
+     * @param inter  Return for the location of intersection
+     * @return       If the ray intersected the instance
+     */
+    __device__ bool intersectInstance(
+        d_Model* model,
+        d_Surface& curr,
+        const d_Ray& ray,
+        d_Intersection& inter)
+    {
+      d_Intersection local;
+
+      Vector L(
+          dot(curr.va, ray.L) + curr.va.w(),
+          dot(curr.vb, ray.L) + curr.vb.w(),
+          dot(curr.vc, ray.L) + curr.vc.w());
+      Vector U(
+          dot(curr.va, ray.U),
+          dot(curr.vb, ray.U),
+          dot(curr.vc, ray.U));
+
+      d_Ray lray(L, U, ray.inst == int32_t(curr.id) ? ray.src : -1);
+
+      if(!intersect(model, curr.d_axis, lray, local))
+        return false;
+
+      Vector I(
+          dot(curr.na, local.location) + curr.na.w(),
+          dot(curr.nb, local.location) + curr.nb.w(),
+          dot(curr.nc, local.location) + curr.nc.w());
+      Vector n = (
+          (curr.va * local.normal.x()) +
+          (curr.vb * local.normal.y()) +
+          (curr.vc * local.normal.z())).normalize();
+
+      inter = d_Intersection(local.src, I, n, ray.U.normalize(), local.distance, curr.id);
+      return true;
+    }
+
     /**
      * Finds the normal for the location intersection of a ray and a Triangle.
      *
@@ -445,9 +556,10 @@ namespace ray {
       d_Intersection inter;
 
       double maxDistance = light.local.distance(ray.L);
-      return(
-          intersect(model, model->root, ray, inter) &&
-          inter.distance < maxDistance);
+      bool   hit = intersect(model, model->root, ray, inter) && inter.distance < maxDistance;
+
+      D_STATS_RAY(model, shadow, hit);
+      return hit;
     }
 
     /**
@@ -480,7 +592,7 @@ namespace ray {
 
         Lp = (light.local - p).normalize();
 
-        if(dot(Lp, n) < 0 && shadowed(model, d_Ray(Lp, p, inter.src), light))
+        if(dot(Lp, n) < 0 && shadowed(model, d_Ray(Lp, p, inter.src, inter.inst), light))
           continue;
 
         Rl = (n * (dot(Lp, n) * 2) - Lp).normalize();
@@ -512,7 +624,14 @@ namespace ray {
       double          cont = 1.0;
 
       for(int i = 0; i < MAXIMUM_ITERATIONS && cont > MINIMUM_CONTRIBUTION; i++) {
-        if(!intersect(model, model->root, curr_ray, inter))
+        bool hit = intersect(model, model->root, curr_ray, inter);
+
+        if(i == 0)
+          D_STATS_RAY(model, primary, hit);
+        else
+          D_STATS_RAY(model, reflection, hit);
+
+        if(!hit)
           break;
 
         v = inter.viewing.negate();
@@ -522,7 +641,7 @@ namespace ray {
         cont  = cont * (model->materials[model->surfaces[inter.src].mat].ks);
 
         newdir = n * (dot(v, n) * 2) - v;
-        curr_ray = d_Ray(inter.location, newdir.normalize(), inter.src);
+        curr_ray = d_Ray(inter.location, newdir.normalize(), inter.src, inter.inst);
       }
 
       return ray::max(ray::min(color, 255), 0);
@@ -539,17 +658,20 @@ namespace ray {
         uint32_t    root,
         uint32_t    n_lights,
         d_Ray*      rays,
-        Vector*     dest)
+        Vector*     dest,
+        RayStats*   stats)
     {
       d_Model model;
+      uint    idx = threadIdx.x;
 
       model.root      = root;
       model.n_lights  = n_lights;
       model.surfaces  = surfaces;
       model.materials = materials;
       model.lights    = lights;
-
-      uint idx = threadIdx.x;
+      model.stats     = stats ? stats + idx : NULL;
+      model.depth     = 0;
+      model.deepest   = 0;
 
       dest[idx] = getColor(&model, rays[idx]);
     }
@@ -560,6 +682,8 @@ namespace ray {
 
     uint32_t rootSurface;
 
+    RayStats traced;
+
     int32_t n_surface;
     int32_t n_material;
     int32_t n_light;
@@ -601,6 +725,41 @@ namespace ray {
       n_light = size;
     }
 
+    /**
+     * Writes a small number of Surfaces into the device array without sending
+     * the entire array again. Each Surface is written to the location of its
+     * id. The array is grown if any new Surfaces have been created.
+     *
+     * @param surs   the Surfaces that changed
+     * @param count  the number of Surfaces in surs
+     * @param size   the total number of Surfaces that exist
+     * @param root   the id of the root Surface
+     */
+    __host__ void updateSurfaces(d_Surface* surs, size_t count, size_t size, uint32_t root) {
+      if(!surfaces || size > size_t(n_surface)) {
+        d_Surface* next;
+
+        cudaMalloc((void**)&next, size * sizeof(d_Surface));
+
+        if(surfaces) {
+          cudaMemcpy(next, surfaces, n_surface * sizeof(d_Surface), cudaMemcpyDeviceToDevice);
+          cudaFree(surfaces);
+        }
+
+        surfaces  = next;
+        n_surface = size;
+      }
+
+      for(size_t i = 0; i < count; i++)
+        cudaMemcpy(surfaces + surs[i].id, surs + i, sizeof(d_Surface), cudaMemcpyHostToDevice);
+
+      rootSurface = root;
+    }
+
+    __host__ void updateMaterial(const d_Material& mat, uint32_t idx) {
+      cudaMemcpy(materials + idx, &mat, sizeof(d_Material), cudaMemcpyHostToDevice);
+    }
+
     __host__ void Trace(Vector* out, d_Ray* in, size_t size) {
       Vector* device_out;
       d_Ray*  device_in;
@@ -610,6 +769,14 @@ namespace ray {
 
       cudaMemcpy(device_in, in, size * sizeof(d_Ray), cudaMemcpyHostToDevice);
 
+      RayStats* device_stats = NULL;
+#ifdef STATS
+      std::vector<RayStats> counts(size);
+
+      cudaMalloc((void**)&device_stats, size * sizeof(RayStats));
+      cudaMemcpy(device_stats, counts.data(), size * sizeof(RayStats), cudaMemcpyHostToDevice);
+#endif
+
 #ifdef __CUDACC__
       kernel<<<1, 256>>>(
           surfaces,
@@ -618,7 +785,8 @@ namespace ray {
           rootSurface,
           n_light,
           device_in,
-          device_out);
+          device_out,
+          device_stats);
 #else
       for(int i = 0; i < size; i++) {
         threadIdx.x = i;
@@ -629,7 +797,8 @@ namespace ray {
             rootSurface,
             n_light,
             device_in,
-            device_out);
+            device_out,
+            device_stats);
       }
 #endif
 
@@ -637,6 +806,19 @@ namespace ray {
 
       cudaFree(device_out);
       cudaFree(device_in);
+
+      traced = RayStats();
+#ifdef STATS
+      cudaMemcpy(counts.data(), device_stats, size * sizeof(RayStats), cudaMemcpyDeviceToHost);
+      cudaFree(device_stats);
+
+      for(const RayStats& count : counts)
+        traced += count;
+#endif
+    }
+
+    __host__ const RayStats& traceStats() {
+      return traced;
     }
 
     __host__ std::ostream& operator<<(std::ostream& ostr, const d_Surface& surf) {
@@ -650,6 +832,14 @@ namespace ray {
         case d_Surface::tree:
           ostr << "Tree: " << surf.v_axis << " :: " << surf.d_axis;
           break;
+
+        case d_Surface::instance:
+          ostr << "Instance: " << surf.d_axis;
+          break;
+
+        case d_Surface::page:
+          ostr << "Page: " << surf.d_axis;
+          break;
       }
 
       return ostr;
@@ -11,6 +11,7 @@
 #pragma once
 
 /* local includes */
+#include <Stats.hpp>
 #include <Vector.hpp>
 
 /* std includes */
@@ -35,8 +36,16 @@ namespace ray {
         Vector illum;
     };
 
+    /**
+     * Flattened version of a Surface. Trees store the ids of their children in
+     * d_axis and v_axis. Instances store the id of the root of their mesh in
+     * d_axis, the rows of the world to object transform in va, vb and vc and
+     * the rows of the object to world transform in na, nb and nc. Pages only
+     * appear in the files of a PagedTree, they stand in for a subtree that is
+     * kept on disk and store the index of the page in d_axis.
+     */
     struct d_Surface {
-        enum Type { triangle = 0, tree = 1 };
+        enum Type { triangle = 0, tree = 1, instance = 2, page = 3 };
 
         Vector min;
         Vector len;
@@ -56,25 +65,25 @@ namespace ray {
     struct d_Ray {
 
         __host__ d_Ray() :
-            L(), U(), iL(), iU(), positive(), nonzero(), src() { }
+            L(), U(), iL(), iU(), positive(), nonzero(), src(), inst() { }
 
-        __device__ __host__ d_Ray(Vector L, Vector U, int32_t src) :
+        __device__ __host__ d_Ray(Vector L, Vector U, int32_t src, int32_t inst = -1) :
             L(L), U(U),
             iL(1.0 / L.x(), 1.0 / L.y(), 1.0 / L.z()),
             iU(1.0 / U.x(), 1.0 / U.y(), 1.0 / U.z()),
-            positive(), nonzero(), src(src) {
+            positive(), nonzero(), src(src), inst(inst) {
           positive[0] = U.x() > 0;
           positive[1] = U.y() > 0;
           positive[2] = U.z() > 0;
-          nonzero [0] = L.x() != 0;
-          nonzero [1] = L.y() != 0;
-          nonzero [2] = L.z() != 0;
+          nonzero [0] = U.x() != 0;
+          nonzero [1] = U.y() != 0;
+          nonzero [2] = U.z() != 0;
         }
 
         __device__ __host__ d_Ray(Vector L, Vector U, Vector iL, Vector iU, bool posi[3],
-            bool nonz[3], int32_t src) :
+            bool nonz[3], int32_t src, int32_t inst = -1) :
                       L(L), U(U), iL(iL), iU(iU), positive(), nonzero(),
-                      src(src) {
+                      src(src), inst(inst) {
           positive[0] = posi[0];
           positive[1] = posi[1];
           positive[2] = posi[2];
@@ -92,18 +101,20 @@ namespace ray {
         bool nonzero [3];
 
         int32_t src;
+        int32_t inst;
     };
 
     struct d_Intersection {
 
         __device__ __host__ d_Intersection() :
-                  src(-1), location(), normal(), viewing(), distance(-1) { }
+                  src(-1), inst(-1), location(), normal(), viewing(), distance(-1) { }
         __device__ __host__ d_Intersection(int32_t src, Vector location, Vector normal,
-            Vector viewing, double distance) :
-                      src(src), location(location), normal(normal), viewing(viewing),
-                      distance(distance) { }
+            Vector viewing, double distance, int32_t inst = -1) :
+                      src(src), inst(inst), location(location), normal(normal),
+                      viewing(viewing), distance(distance) { }
 
         int32_t src;
+        int32_t inst;
 
         Vector location;
         Vector normal;
@@ -116,8 +127,14 @@ namespace ray {
     __host__ void setMaterials(d_Material* mats, size_t size);
     __host__ void setLights   (d_Light*    ligs, size_t size);
 
+    __host__ void updateSurfaces(d_Surface* surs, size_t count, size_t size, uint32_t root);
+    __host__ void updateMaterial(const d_Material& mat, uint32_t idx);
+
     __host__ void Trace(Vector* out, d_Ray* in, size_t size);
 
+    /** the work done by the last call to Trace, only counted when built with STATS */
+    __host__ const RayStats& traceStats();
+
     __host__ std::ostream& operator<<(std::ostream& ostr, const d_Surface& surf);
   }
 
@@ -8,6 +8,8 @@
 #pragma once
 
 /* std includes */
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 #include <stdint.h>
@@ -36,6 +38,7 @@ namespace ray {
 
       /* operations */
       Matrix<Type> t() const;
+      Matrix<Type> inv() const;
 
     private:
 
@@ -47,6 +50,9 @@ namespace ray {
       std::shared_ptr<Type> data;
   };
 
+  template<typename Type>
+  Matrix<Type> eye(int size);
+
   template<typename Type>
   Matrix<Type>::Matrix() :
       _rows(0),
@@ -89,6 +95,64 @@ namespace ray {
     return ret;
   }
 
+  /**
+   * Create the inverse of a square Matrix. This uses Gauss-Jordan elimination
+   * with partial pivoting and throws if the Matrix is singular.
+   *
+   * @return  a new Matrix
+   */
+  template<typename Type>
+  Matrix<Type> Matrix<Type>::inv() const {
+    Matrix<Type> work(_rows, _cols);
+    Matrix<Type> ret = eye<Type>(_rows);
+
+    if(_rows != _cols) {
+      throw std::exception();
+    }
+
+    for(uint32_t i = 0; i < _rows * _cols; i++) {
+      work.get()[i] = data.get()[i];
+    }
+
+    for(uint32_t c = 0; c < _cols; c++) {
+      uint32_t pivot = c;
+      for(uint32_t r = c + 1; r < _rows; r++) {
+        if(std::abs(work[r][c]) > std::abs(work[pivot][c])) {
+          pivot = r;
+        }
+      }
+
+      if(work[pivot][c] == Type(0)) {
+        throw std::exception();
+      }
+
+      for(uint32_t j = 0; j < _cols; j++) {
+        std::swap(work[c][j], work[pivot][j]);
+        std::swap(ret [c][j], ret [pivot][j]);
+      }
+
+      Type scale = work[c][c];
+      for(uint32_t j = 0; j < _cols; j++) {
+        work[c][j] /= scale;
+        ret [c][j] /= scale;
+      }
+
+      for(uint32_t r = 0; r < _rows; r++) {
+        if(r == c) {
+          continue;
+        }
+
+        Type factor = work[r][c];
+        for(uint32_t j = 0; j < _cols; j++) {
+          work[r][j] -= factor * work[c][j];
+          ret [r][j] -= factor * ret [c][j];
+        }
+      }
+    }
+
+    return ret;
+  }
+
   /**
    * Create a certain sized identity Matrix
    *
@@ -123,9 +187,9 @@ namespace ray {
       throw std::exception();
     }
 
-    for(int i = 0; i < lhs.rows(); i++) {
-      for(int j = 0;j < rhs.cols(); j++) {
-        for(int k = 0; k < lhs.cols(); k++) {
+    for(uint32_t i = 0; i < lhs.rows(); i++) {
+      for(uint32_t j = 0;j < rhs.cols(); j++) {
+        for(uint32_t k = 0; k < lhs.cols(); k++) {
           ret[i][j] += lhs[i][k] * rhs[k][j];
         }
       }
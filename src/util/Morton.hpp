@@ -0,0 +1,104 @@
+/*
+ * Morton.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* std includes */
+#include <stdint.h>
+
+namespace ray {
+
+  /**
+   * Spreads the lower 10 bits of a number so that there are two zero bits
+   * between each of the original bits.
+   *
+   * @param v  the number to spread
+   * @return   the spread number
+   */
+  inline uint32_t mortonSpread3(uint32_t v) {
+    v &= 0x000003ff;
+    v = (v | (v << 16)) & 0xff0000ff;
+    v = (v | (v <<  8)) & 0x0300f00f;
+    v = (v | (v <<  4)) & 0x030c30c3;
+    v = (v | (v <<  2)) & 0x09249249;
+    return v;
+  }
+
+  /**
+   * Spreads the lower 16 bits of a number so that there is a zero bit between
+   * each of the original bits.
+   *
+   * @param v  the number to spread
+   * @return   the spread number
+   */
+  inline uint32_t mortonSpread2(uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  }
+
+  /**
+   * Interleaves three 10 bit coordinates into a 30 bit Morton code.
+   *
+   * @param x  the x coordinate, must be less than 1024
+   * @param y  the y coordinate, must be less than 1024
+   * @param z  the z coordinate, must be less than 1024
+   * @return   the Morton code for the coordinates
+   */
+  inline uint32_t morton3(uint32_t x, uint32_t y, uint32_t z) {
+    return (mortonSpread3(x) << 2) | (mortonSpread3(y) << 1) | mortonSpread3(z);
+  }
+
+  /**
+   * Interleaves two 16 bit coordinates into a 32 bit Morton code.
+   *
+   * @param x  the x coordinate, must be less than 65536
+   * @param y  the y coordinate, must be less than 65536
+   * @return   the Morton code for the coordinates
+   */
+  inline uint32_t morton2(uint32_t x, uint32_t y) {
+    return (mortonSpread2(y) << 1) | mortonSpread2(x);
+  }
+
+  /**
+   * Finds the distance along a Hilbert curve through a square grid. Unlike a
+   * Morton curve every step of a Hilbert curve moves to a neighboring cell.
+   *
+   * @param n  the width of the grid, must be a power of two
+   * @param x  the x coordinate, must be less than n
+   * @param y  the y coordinate, must be less than n
+   * @return   the index of the cell along the curve
+   */
+  inline uint32_t hilbert2(uint32_t n, uint32_t x, uint32_t y) {
+    uint32_t d = 0;
+
+    for(uint32_t s = n / 2; s > 0; s /= 2) {
+      uint32_t rx = (x & s) ? 1 : 0;
+      uint32_t ry = (y & s) ? 1 : 0;
+
+      d += s * s * ((3 * rx) ^ ry);
+
+      /* rotate the quadrant so the curve inside it starts in the corner */
+      if(ry == 0) {
+        if(rx == 1) {
+          x = n - 1 - x;
+          y = n - 1 - y;
+        }
+
+        uint32_t t = x;
+        x = y;
+        y = t;
+      }
+    }
+
+    return d;
+  }
+
+}
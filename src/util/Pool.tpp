@@ -0,0 +1,147 @@
+/*
+ * Pool.tpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* std includes */
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ray {
+
+  /**
+   * A simple arena for objects of a single type. Objects are placed into large
+   * chunks of memory in the order that they are created and are all destroyed
+   * together when the Pool is destroyed. Objects never move once they have
+   * been created so raw pointers to them stay valid for the life of the Pool.
+   */
+  template<typename Type>
+  class Pool {
+    public:
+
+      Pool(size_t chunk = 4096);
+      ~Pool();
+
+      Pool(const Pool& pool) = delete;
+      const Pool& operator =(const Pool& pool) = delete;
+
+      template<typename... Args>
+      Type* make(Args&&... args);
+
+      void reserve(size_t count);
+
+      /* getters */
+      inline size_t size() const { return _size; }
+
+    private:
+
+      struct chunk_t {
+        Type*  data;
+        size_t used;
+        size_t capacity;
+      };
+
+      void grow(size_t count);
+
+      std::vector<chunk_t> chunks;
+      size_t               _chunk;
+      size_t               _size;
+
+      /** slots whose constructor threw, which hold no object */
+      std::vector<Type*>   holes;
+  };
+
+  template<typename Type>
+  Pool<Type>::Pool(size_t chunk) :
+      chunks(),
+      _chunk(chunk),
+      _size(0),
+      holes() { }
+
+  /**
+   * Destroys every object that was created by the Pool and releases all of the
+   * memory that the Pool allocated.
+   */
+  template<typename Type>
+  Pool<Type>::~Pool() {
+    std::sort(holes.begin(), holes.end());
+
+    for(chunk_t& curr : chunks) {
+      for(size_t i = 0; i < curr.used; i++) {
+        if(holes.empty() || !std::binary_search(holes.begin(), holes.end(), curr.data + i))
+          curr.data[i].~Type();
+      }
+      std::free(curr.data);
+    }
+  }
+
+  /**
+   * Creates a new object inside of the Pool. The slot for the object is taken
+   * before the object is constructed so constructors are free to create more
+   * objects in the same Pool.
+   *
+   * @param args  the arguments for the constructor of the object
+   * @return      a pointer to the new object, owned by the Pool
+   */
+  template<typename Type>
+  template<typename... Args>
+  Type* Pool<Type>::make(Args&&... args) {
+    if(chunks.empty() || chunks.back().used == chunks.back().capacity)
+      grow(_chunk);
+
+    chunk_t& curr = chunks.back();
+    Type* slot = curr.data + curr.used;
+
+    curr.used++;
+    _size++;
+
+    try {
+      return new (slot) Type(std::forward<Args>(args)...);
+    } catch(...) {
+      /* the constructor may have made objects after the slot, so the slot can
+       * not be given back, it is skipped when the Pool is destroyed instead */
+      holes.push_back(slot);
+      _size--;
+      throw;
+    }
+  }
+
+  /**
+   * Makes sure that the next count objects created by the Pool are contiguous
+   * in memory.
+   *
+   * @param count  the number of objects that will be created
+   */
+  template<typename Type>
+  void Pool<Type>::reserve(size_t count) {
+    if(chunks.empty() || chunks.back().capacity - chunks.back().used < count)
+      grow(count);
+  }
+
+  /**
+   * Adds a new chunk of memory to the Pool.
+   *
+   * @param count  the minimum number of objects the chunk should hold
+   */
+  template<typename Type>
+  void Pool<Type>::grow(size_t count) {
+    chunk_t next;
+
+    next.capacity = count > _chunk ? count : _chunk;
+    next.used     = 0;
+    next.data     = static_cast<Type*>(std::malloc(next.capacity * sizeof(Type)));
+
+    if(next.data == nullptr)
+      throw std::bad_alloc();
+
+    chunks.push_back(next);
+  }
+
+}
@@ -27,7 +27,7 @@ namespace ray {
    * @param mat
    * @param idx
    */
-  RefVector::RefVector(const Matrix<double>& mat, uint16_t idx) :
+  RefVector::RefVector(const Matrix<double>& mat, uint32_t idx) :
     data(mat[idx]) { }
 
   /**
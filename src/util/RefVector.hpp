@@ -17,7 +17,7 @@ namespace ray {
     public:
 
       RefVector(const double* data);
-      RefVector(const Matrix<double>& mat, uint16_t idx);
+      RefVector(const Matrix<double>& mat, uint32_t idx);
 
       /* getters */
       inline double x() const { return data[0]; }
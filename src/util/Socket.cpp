@@ -0,0 +1,133 @@
+/*
+ * Socket.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <Socket.hpp>
+
+/* std includes */
+#include <cerrno>
+#include <cstring>
+
+/* system includes */
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace ray {
+  namespace net {
+
+    bool sendAll(int fd, const void* data, size_t size) {
+      const char* bytes = static_cast<const char*>(data);
+
+      for(size_t sent = 0; sent < size;) {
+        ssize_t count = ::send(fd, bytes + sent, size - sent, MSG_NOSIGNAL);
+        if(count <= 0)
+          return false;
+        sent += count;
+      }
+      return true;
+    }
+
+    bool sendAll(int fd, const std::string& data) {
+      return sendAll(fd, data.data(), data.size());
+    }
+
+    bool recvAll(int fd, void* data, size_t size) {
+      char* bytes = static_cast<char*>(data);
+
+      for(size_t read = 0; read < size;) {
+        ssize_t count = ::recv(fd, bytes + read, size - read, 0);
+        if(count <= 0)
+          return false;
+        read += count;
+      }
+      return true;
+    }
+
+    bool readLine(int fd, std::string& buffer, std::string& line) {
+      size_t end;
+
+      while((end = buffer.find('\n')) == std::string::npos) {
+        char chunk[4096];
+        ssize_t count = ::recv(fd, chunk, sizeof(chunk), 0);
+        if(count <= 0)
+          return false;
+        buffer.append(chunk, count);
+      }
+
+      line = buffer.substr(0, end);
+      buffer.erase(0, end + 1);
+      return true;
+    }
+
+    int connectTo(const std::string& host, const std::string& port) {
+      addrinfo hints, *addrs;
+      std::memset(&hints, 0, sizeof(hints));
+      hints.ai_family   = AF_UNSPEC;
+      hints.ai_socktype = SOCK_STREAM;
+
+      if(getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs) != 0)
+        return -1;
+
+      int fd = -1;
+      for(addrinfo* addr = addrs; addr && fd < 0; addr = addr->ai_next) {
+        fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+        if(fd >= 0 && connect(fd, addr->ai_addr, addr->ai_addrlen) < 0) {
+          close(fd);
+          fd = -1;
+        }
+      }
+      freeaddrinfo(addrs);
+
+      if(fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      }
+
+      return fd;
+    }
+
+    int connectTo(const std::string& address) {
+      size_t colon = address.rfind(':');
+      if(colon == std::string::npos)
+        return -1;
+
+      return connectTo(address.substr(0, colon), address.substr(colon + 1));
+    }
+
+    int listenOn(int port, std::string& bound) {
+      sockaddr_in addr;
+      socklen_t   length = sizeof(addr);
+      std::memset(&addr, 0, sizeof(addr));
+      addr.sin_family      = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port        = htons(port);
+
+      int listener = socket(AF_INET, SOCK_STREAM, 0);
+      if(listener < 0)
+        return -1;
+
+      int one = 1;
+      setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+      if(bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 ||
+          listen(listener, 64) < 0 ||
+          getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &length) < 0) {
+        int error = errno;
+        close(listener);
+        errno = error;
+        return -1;
+      }
+
+      bound = std::to_string(ntohs(addr.sin_port));
+      return listener;
+    }
+
+  }
+}
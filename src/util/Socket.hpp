@@ -0,0 +1,62 @@
+/*
+ * Socket.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* std includes */
+#include <cstddef>
+#include <string>
+
+namespace ray {
+  namespace net {
+
+    /**
+     * The blocking socket calls shared by the programs that talk over TCP or
+     * a unix domain socket. Every call returns false, or -1 for a socket,
+     * once the other side has gone away or the call failed, with errno set
+     * by the call that failed.
+     */
+
+    bool sendAll(int fd, const void* data, size_t size);
+    bool sendAll(int fd, const std::string& data);
+    bool recvAll(int fd, void* data, size_t size);
+
+    /**
+     * Reads the next line, without the newline. Anything read after the
+     * line is kept in the buffer for the next call, so every read of the
+     * socket has to go through the same buffer.
+     *
+     * @param fd      the socket
+     * @param buffer  what was read after the last line
+     * @param line    return for the line
+     * @return        false once the other side has closed the connection
+     */
+    bool readLine(int fd, std::string& buffer, std::string& line);
+
+    /**
+     * Connects to a host with Nagle turned off, trying each of its addresses.
+     *
+     * @param host  the name or address of the host
+     * @param port  the port or service
+     * @return      the socket, or -1
+     */
+    int connectTo(const std::string& host, const std::string& port);
+
+    /** connects to a <host>:<port> */
+    int connectTo(const std::string& address);
+
+    /**
+     * Listens for TCP connections on every address.
+     *
+     * @param port   the port to listen on, 0 for any free port
+     * @param bound  return for the port that was bound
+     * @return       the socket, or -1
+     */
+    int listenOn(int port, std::string& bound);
+
+  }
+}
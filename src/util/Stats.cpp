@@ -0,0 +1,61 @@
+/*
+ * Stats.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <Stats.hpp>
+
+namespace ray {
+
+  RayStats& RayStats::operator+=(const RayStats& rhs) {
+    primary       += rhs.primary;
+    reflection    += rhs.reflection;
+    shadow        += rhs.shadow;
+    boxTests      += rhs.boxTests;
+    triangleTests += rhs.triangleTests;
+    hits          += rhs.hits;
+    depth         += rhs.depth;
+    return *this;
+  }
+
+  /**
+   * Prints the counters along with the averages that are worked out from
+   * them.
+   */
+  std::ostream& operator<<(std::ostream& ostr, const RayStats& stats) {
+    uint64_t rays = stats.primary + stats.reflection + stats.shadow;
+    double   per  = rays ? 1.0 / double(rays) : 0.0;
+
+    ostr << "Rays: " << rays
+         << " (primary " << stats.primary
+         << ", reflection " << stats.reflection
+         << ", shadow " << stats.shadow << ")" << std::endl;
+    ostr << "Hits: " << stats.hits << std::endl;
+    ostr << "Box tests: " << stats.boxTests
+         << " (" << double(stats.boxTests) * per << " per ray)" << std::endl;
+    ostr << "Triangle tests: " << stats.triangleTests
+         << " (" << double(stats.triangleTests) * per << " per ray)" << std::endl;
+    ostr << "Traversal depth: " << double(stats.depth) * per << " on average" << std::endl;
+    ostr << "Bounces: "
+         << (stats.primary ? double(stats.reflection) / double(stats.primary) : 0.0)
+         << " per primary ray";
+
+    return ostr;
+  }
+
+#ifdef STATS
+
+  namespace stats {
+
+    thread_local RayStats counters;
+    thread_local uint32_t depth   = 0;
+    thread_local uint32_t deepest = 0;
+
+  }
+
+#endif
+
+}
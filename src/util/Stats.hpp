@@ -0,0 +1,161 @@
+/*
+ * Stats.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* std includes */
+#include <chrono>
+#include <iostream>
+#include <stdint.h>
+
+namespace ray {
+
+  /**
+   * Counts of the work done while rendering an image. The counters are only
+   * kept when the code is built with STATS defined (make DEF=-DSTATS), without
+   * it every counter stays zero and counting costs nothing.
+   */
+  struct RayStats {
+    RayStats() :
+      primary(0),
+      reflection(0),
+      shadow(0),
+      boxTests(0),
+      triangleTests(0),
+      hits(0),
+      depth(0) { }
+
+    /** the Rays traced for each kind of Ray */
+    uint64_t primary, reflection, shadow;
+
+    /** the number of Ray/Box and Ray/Triangle tests */
+    uint64_t boxTests, triangleTests;
+
+    /** the number of traced Rays that hit something */
+    uint64_t hits;
+
+    /** the sum over every traced Ray of the deepest tree node it entered */
+    uint64_t depth;
+
+    RayStats& operator+=(const RayStats& rhs);
+
+#ifdef STATS
+    static const bool enabled = true;
+#else
+    static const bool enabled = false;
+#endif
+  };
+
+  std::ostream& operator<<(std::ostream& ostr, const RayStats& stats);
+
+#ifdef STATS
+
+  namespace stats {
+
+    /** the counters of the calling thread */
+    extern thread_local RayStats counters;
+
+    /** the depth of the calling thread in the tree and the deepest it has been */
+    extern thread_local uint32_t depth, deepest;
+
+    /**
+     * Counts the work done by the calling thread for as long as it is in
+     * scope and adds it to a total when it leaves scope.
+     */
+    class scope {
+      public:
+
+        scope(RayStats& total) : total(total) { counters = RayStats(); }
+        ~scope() { total += counters; }
+
+      private:
+
+        RayStats& total;
+    };
+
+  }
+
+#define STATS_SCOPE(name, total) \
+  ray::stats::scope name(total)
+
+#define STATS_COUNT(field) \
+  do { ray::stats::counters.field++; } while(0)
+
+#define STATS_ENTER() \
+  do { if(++ray::stats::depth > ray::stats::deepest) ray::stats::deepest = ray::stats::depth; } while(0)
+
+#define STATS_LEAVE() \
+  do { ray::stats::depth--; } while(0)
+
+#define STATS_RAY(kind, hit) do {                                  \
+    ray::RayStats& _local = ray::stats::counters;                  \
+    _local.kind++;                                                 \
+    _local.hits  += (hit) ? 1 : 0;                                 \
+    _local.depth += ray::stats::deepest;                           \
+    ray::stats::deepest = 0;                                       \
+  } while(0)
+
+#else
+
+#define STATS_SCOPE(name, total) \
+  do { } while(0)
+
+#define STATS_COUNT(field) \
+  do { } while(0)
+
+#define STATS_ENTER() \
+  do { } while(0)
+
+#define STATS_LEAVE() \
+  do { } while(0)
+
+#define STATS_RAY(kind, hit) \
+  do { } while(0)
+
+#endif
+
+  namespace stats {
+
+    /**
+     * A running measure of the work done by the calling thread, used to find
+     * the cost of each pixel. With STATS it is the number of Box and Triangle
+     * tests, which is the same on every run, otherwise it is the time in
+     * nanoseconds.
+     */
+    inline uint64_t cost() {
+#ifdef STATS
+      return counters.boxTests + counters.triangleTests;
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /** the unit that cost is measured in */
+    inline const char* costUnit() {
+      return RayStats::enabled ? "tests" : "ns";
+    }
+
+    /**
+     * Adds the cost of the work done while it is in scope to a pixel. Nothing
+     * is measured when there is no pixel to add it to.
+     */
+    class cost_scope {
+      public:
+
+        cost_scope(uint64_t* cell) : cell(cell), start(cell ? cost() : 0) { }
+        ~cost_scope() { if(cell) *cell += cost() - start; }
+
+      private:
+
+        uint64_t* cell;
+        uint64_t  start;
+    };
+
+  }
+
+}
@@ -0,0 +1,142 @@
+/*
+ * Timeline.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <Timeline.hpp>
+
+/* std includes */
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ray {
+  namespace timeline {
+
+    struct event {
+      const char* name;
+      int64_t     arg;
+      uint64_t    begin, end;
+    };
+
+    /** the events of a single thread, only touched by that thread until written */
+    struct buffer {
+      uint32_t           tid;
+      bool               main;
+      std::vector<event> events;
+    };
+
+    std::atomic<bool> recording(false);
+
+    static std::chrono::steady_clock::time_point origin;
+    static std::thread::id                       starter;
+    static std::mutex                            lock;
+    static std::vector<std::unique_ptr<buffer>>  buffers;
+    static thread_local buffer*                  local = nullptr;
+
+    /**
+     * Starts recording events, any events that were already recorded are
+     * thrown away.
+     */
+    void start() {
+      std::lock_guard<std::mutex> guard(lock);
+
+      for(auto& buf : buffers)
+        buf->events.clear();
+
+      origin  = std::chrono::steady_clock::now();
+      starter = std::this_thread::get_id();
+      recording = true;
+    }
+
+    /**
+     * Stops recording events, the events that were recorded are kept until
+     * the next call to start.
+     */
+    void stop() {
+      recording = false;
+    }
+
+    uint64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - origin).count();
+    }
+
+    void record(const char* name, int64_t arg, uint64_t begin, uint64_t end) {
+      if(!local) {
+        std::lock_guard<std::mutex> guard(lock);
+
+        buffers.emplace_back(new buffer());
+        local = buffers.back().get();
+        local->tid  = buffers.size();
+        local->main = std::this_thread::get_id() == starter;
+      }
+
+      local->events.push_back(event{ name, arg, begin, end });
+    }
+
+    /**
+     * Writes every recorded event as Chrome trace event JSON. Every event is a
+     * complete event with its start and duration in microseconds. The thread
+     * that started the timeline is named main and the others are numbered in
+     * the order they first recorded an event. This must not be called while
+     * other threads are recording.
+     *
+     * @param ostr  where to write the events
+     * @return      false if the events could not be written
+     */
+    bool write(std::ostream& ostr) {
+      std::lock_guard<std::mutex> guard(lock);
+      bool first = true;
+
+      auto separate = [&]() {
+        ostr << (first ? "\n    " : ",\n    ");
+        first = false;
+      };
+
+      ostr << std::fixed << std::setprecision(3);
+      ostr << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [";
+
+      for(const auto& buf : buffers) {
+        if(buf->events.empty())
+          continue;
+
+        separate();
+        ostr << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buf->tid
+             << ", \"args\": {\"name\": \""
+             << (buf->main ? "main" : "thread " + std::to_string(buf->tid)) << "\"}}";
+
+        for(const event& e : buf->events) {
+          separate();
+          ostr << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buf->tid
+               << ", \"ts\": " << e.begin / 1000.0
+               << ", \"dur\": " << (e.end - e.begin) / 1000.0;
+          if(e.arg >= 0)
+            ostr << ", \"args\": {\"index\": " << e.arg << "}";
+          ostr << "}";
+        }
+      }
+
+      ostr << "\n  ]\n}\n";
+      return bool(ostr);
+    }
+
+    /**
+     * Writes every recorded event to a file.
+     *
+     * @param fileName  the name of the file
+     * @return          false if the file could not be written
+     */
+    bool write(const std::string& fileName) {
+      std::ofstream ostr(fileName.c_str());
+      return ostr && write(ostr);
+    }
+
+  }
+}
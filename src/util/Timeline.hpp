@@ -0,0 +1,82 @@
+/*
+ * Timeline.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* std includes */
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdint.h>
+#include <string>
+
+/* boost includes */
+#include <boost/preprocessor/cat.hpp>
+
+namespace ray {
+  namespace timeline {
+
+    /**
+     * Records when each phase of a render starts and stops on every thread so
+     * that the wall time can be looked at in a trace viewer. Nothing is
+     * recorded until start is called, before that a scope costs a single
+     * check of a flag. The events are written as Chrome trace event JSON,
+     * which chrome://tracing and Perfetto can open.
+     */
+
+#define TIMELINE_SCOPE(name) \
+  ray::timeline::scope BOOST_PP_CAT(_timeline_, __LINE__)(name)
+
+#define TIMELINE_SCOPE_ARG(name, arg) \
+  ray::timeline::scope BOOST_PP_CAT(_timeline_, __LINE__)(name, arg)
+
+    /** set while events are being recorded */
+    extern std::atomic<bool> recording;
+
+    void start();
+    void stop();
+    bool write(std::ostream& ostr);
+    bool write(const std::string& fileName);
+
+    /** the time since the timeline was started, in nanoseconds */
+    uint64_t now();
+
+    /** the milliseconds between two times */
+    inline double ms(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+      return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() / 1000.0;
+    }
+
+    /** records an event on the calling thread */
+    void record(const char* name, int64_t arg, uint64_t begin, uint64_t end);
+
+    /**
+     * Records the time between when it is made and when it leaves scope as an
+     * event on the calling thread. The name has to outlive the timeline, so it
+     * is normally a string literal.
+     */
+    class scope {
+      public:
+
+        scope(const char* name, int64_t arg = -1) :
+            name(recording.load(std::memory_order_relaxed) ? name : nullptr),
+            arg(arg),
+            begin(this->name ? now() : 0) { }
+
+        ~scope() {
+          if(name)
+            record(name, arg, begin, now());
+        }
+
+      private:
+
+        const char* name;
+        int64_t     arg;
+        uint64_t    begin;
+    };
+
+  }
+}
@@ -0,0 +1,120 @@
+/*
+ * WorkerPool.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+/* local includes */
+#include <WorkerPool.hpp>
+
+/* boost includes */
+#include <boost/bind.hpp>
+
+namespace ray {
+
+  /**
+   * Starts the threads of the pool.
+   *
+   * @param nthreads  the number of threads to start
+   */
+  WorkerPool::WorkerPool(uint8_t nthreads) :
+      threads(),
+      nthreads(nthreads),
+      running(),
+      lock(),
+      wake(),
+      done(),
+      job(nullptr),
+      error(),
+      count(0),
+      started(0),
+      finished(0),
+      stopping(false)
+  {
+    for(int i = 0; i < nthreads; i++)
+      threads.create_thread(boost::bind(&WorkerPool::work, this));
+  }
+
+  WorkerPool::~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+
+    wake.notify_all();
+    threads.join_all();
+  }
+
+  /**
+   * Runs a job once for every index from zero to count. The calling thread
+   * runs indices as well, so a pool without any threads runs everything on
+   * the caller. If a job throws, the first exception is thrown again by run
+   * once every index has finished.
+   *
+   * @param count  the number of indices
+   * @param job    the job, called with each index
+   */
+  void WorkerPool::run(uint8_t count, const std::function<void(uint8_t)>& job) {
+    std::lock_guard<std::mutex> turn(running);
+    std::unique_lock<std::mutex> guard(lock);
+
+    this->job      = &job;
+    this->error    = std::exception_ptr();
+    this->count    = count;
+    this->started  = 0;
+    this->finished = 0;
+
+    wake.notify_all();
+
+    while(started < count)
+      take(guard);
+
+    done.wait(guard, [this]() { return finished == this->count; });
+    this->job = nullptr;
+
+    if(error)
+      std::rethrow_exception(error);
+  }
+
+  /**
+   * Runs the next index of the current job. The lock is released while the
+   * job runs.
+   *
+   * @param guard  the held lock of the pool
+   */
+  void WorkerPool::take(std::unique_lock<std::mutex>& guard) {
+    uint8_t idx = started++;
+
+    guard.unlock();
+    try {
+      (*job)(idx);
+    } catch(...) {
+      guard.lock();
+      if(!error)
+        error = std::current_exception();
+      guard.unlock();
+    }
+    guard.lock();
+
+    if(++finished == count)
+      done.notify_all();
+  }
+
+  /**
+   * The loop of each thread of the pool.
+   */
+  void WorkerPool::work() {
+    std::unique_lock<std::mutex> guard(lock);
+
+    for(;;) {
+      wake.wait(guard, [this]() { return stopping || (job && started < count); });
+
+      if(stopping)
+        return;
+
+      take(guard);
+    }
+  }
+
+}
@@ -0,0 +1,72 @@
+/*
+ * WorkerPool.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: norton
+ */
+
+#pragma once
+
+/* std includes */
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+/* boost includes */
+#include <boost/thread/thread.hpp>
+
+namespace ray {
+
+  /**
+   * A set of threads that are started once and kept waiting for work. This
+   * saves the cost of starting and stopping a thread for every part of every
+   * picture when many pictures are taken in a row. Work is handed out as a
+   * job that is run once for each index in a range, on the threads of the
+   * pool and on the calling thread, and run only returns when every index
+   * has finished. Only one range is run at a time, callers on other threads
+   * wait for their turn.
+   */
+  class WorkerPool {
+    public:
+
+      typedef std::shared_ptr<WorkerPool> ptr;
+
+      WorkerPool(uint8_t nthreads = boost::thread::hardware_concurrency());
+      ~WorkerPool();
+
+      WorkerPool(const WorkerPool& pool) = delete;
+      const WorkerPool& operator =(const WorkerPool& pool) = delete;
+
+      void run(uint8_t count, const std::function<void(uint8_t)>& job);
+
+      /** the number of threads in the pool, not counting the caller of run */
+      inline uint8_t size() const { return nthreads; }
+
+    private:
+
+      void work();
+      void take(std::unique_lock<std::mutex>& guard);
+
+      boost::thread_group threads;
+      uint8_t             nthreads;
+
+      /** held by run for the whole of a range */
+      std::mutex running;
+
+      /** guards everything below */
+      std::mutex              lock;
+      std::condition_variable wake;
+      std::condition_variable done;
+
+      const std::function<void(uint8_t)>* job;
+      std::exception_ptr                  error;
+      uint8_t                             count;
+      uint8_t                             started;
+      uint8_t                             finished;
+      bool                                stopping;
+  };
+
+}